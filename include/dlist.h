@@ -3,6 +3,12 @@
 
 #include <stddef.h> /* size_t */
 
+/* ranges shorter than this are handled by the serial functions */
+#define DLIST_PARALLEL_THRESHOLD (65536)
+
+/* number of elements a worker thread takes from the range at a time */
+#define DLIST_PARALLEL_CHUNK (8192)
+
 typedef struct Node node_t;
 
 typedef struct DList dlist_t;
@@ -297,4 +303,56 @@ Space complexity: O(n).
 
 int DListMultiFind(dlist_iter_t from, dlist_iter_t to, int (*match_func)(void *data, const void *param), const void *param, dlist_t *output_list);
 
+/***********************************************************************/
+/*
+Description: parallel version of DListForEach. the range is split into chunks 
+of DLIST_PARALLEL_CHUNK elements that are handed to one worker thread per 
+online core. the threads are started on the first call and kept for the life 
+of the process. ranges shorter than DLIST_PARALLEL_THRESHOLD are handled by 
+DListForEach.
+action_func must be safe to call from several threads at once. when an action 
+fails, chunks that come after the failed one are skipped, but chunks that were 
+already taken by other workers are completed.
+Arguments:	
+from - valid iterator to first element in range
+to - valid iterator to last element in range (excluded from range)
+action_func - valid pointer to a thread-safe function that manipulates data of 
+elements
+action_param - valid pointer to parameter to be used by action_func
+Return: status of the first failed action in range order, 0 if none failed.
+if worker threads can't be created, or are busy with the range of another 
+call, the calling thread handles all the chunks.
+
+Time complexity: O(n / number of cores) for the actions, O(n) to split the range.
+Space complexity: O(n / DLIST_PARALLEL_CHUNK).
+*/
+
+int DListParallelForEach(dlist_iter_t from, dlist_iter_t to, int(*action_func)(void *data, void *param), void *action_param);
+
+/***********************************************************************/
+/*
+Description: parallel version of DListMultiFind. each chunk of the range 
+collects its matches into a list of its own, and the lists are spliced into 
+output_list in range order, so the output is identical to that of 
+DListMultiFind. ranges shorter than DLIST_PARALLEL_THRESHOLD are handled by 
+DListMultiFind.
+match_func must be safe to call from several threads at once.
+
+Arguments:
+from - valid iterator to first element in range
+to - valid iterator to last element in range (the element "to" is not included)
+match_func - valid pointer to a thread-safe function that checks if the data of 
+an elemenet matches the param.
+param - valid pointer to parameter to be used by match_func
+output_list - pointer to empty list into which the found data will be inserted
+Return: 
+1 if elements are found and saved in output list. 0 otherwise (output list is
+left empty if an allocation fails).
+
+Time complexity: O(n / number of cores) for the matches, O(n) to split the range.
+Space complexity: O(n).
+*/
+
+int DListParallelMultiFind(dlist_iter_t from, dlist_iter_t to, int (*match_func)(void *data, const void *param), const void *param, dlist_t *output_list);
+
 #endif /* __DLIST_H__ */
@@ -0,0 +1,137 @@
+#ifndef __HASH_MAP_H__
+#define __HASH_MAP_H__
+
+#include <stddef.h> /* size_t */
+
+#include "uid.h"
+
+/*
+open-addressing hash table keyed by ilrd_uid_t (Robin Hood probing with
+backward-shift removal). keys and data are stored inline in one array.
+*/
+
+typedef struct HashMap hash_map_t;
+
+/***********************************************************************/
+/*
+Description: create a hash map
+Arguments: capacity - expected number of elements, may be 0
+Return: pointer to a map, or NULL if it fails
+
+Time complexity: O(capacity).
+Space complexity: O(capacity).
+*/
+
+hash_map_t *HashMapCreate(size_t capacity);
+
+/***********************************************************************/
+/*
+Description: destroy a map. the data of the elements is not freed.
+Arguments: map - valid pointer to a map
+Return: none
+
+Time complexity: O(1).
+Space complexity: O(1).
+*/
+
+void HashMapDestroy(hash_map_t *map);
+
+/***********************************************************************/
+/*
+Description: insert an element. the map grows when it is 7/8 full.
+Arguments:
+map - valid pointer to a map
+key - UID of the element, not UIDBadUID
+data - pointer to data
+Return: 0 on success, 1 if the key is already in the map or allocation failed
+
+Time complexity: O(1) on average.
+Space complexity: O(1) on average.
+*/
+
+int HashMapInsert(hash_map_t *map, ilrd_uid_t key, void *data);
+
+/***********************************************************************/
+/*
+Description: remove an element
+Arguments:
+map - valid pointer to a map
+key - UID of the element
+Return: data of removed element, or NULL if not found
+
+Time complexity: O(1) on average.
+Space complexity: O(1).
+*/
+
+void *HashMapRemove(hash_map_t *map, ilrd_uid_t key);
+
+/***********************************************************************/
+/*
+Description: find an element
+Arguments:
+map - valid pointer to a map
+key - UID of the element
+Return: data of found element, or NULL if not found
+
+Time complexity: O(1) on average.
+Space complexity: O(1).
+*/
+
+void *HashMapFind(const hash_map_t *map, ilrd_uid_t key);
+
+/***********************************************************************/
+/*
+Description: run action function on the data of all elements, in no
+particular order. stops on the first action that does not return 0.
+the map must not be changed by the action.
+Arguments:
+map - valid pointer to a map
+action - valid pointer to function
+action_param - parameter used by the action function
+Return: status of the failed action, 0 if all succeeded
+
+Time complexity: O(capacity).
+Space complexity: O(1).
+*/
+
+int HashMapForEach(hash_map_t *map, int (*action)(void *data, void *param), void *action_param);
+
+/***********************************************************************/
+/*
+Description: remove all elements
+Arguments: map - valid pointer to a map
+Return: none
+
+Time complexity: O(capacity).
+Space complexity: O(1).
+*/
+
+void HashMapClear(hash_map_t *map);
+
+/***********************************************************************/
+/*
+Description: get number of elements in map
+Arguments: map - valid pointer to a map
+Return: number of elements
+
+Time complexity: O(1).
+Space complexity: O(1).
+*/
+
+size_t HashMapSize(const hash_map_t *map);
+
+/***********************************************************************/
+/*
+Description: check if map is empty
+Arguments: map - valid pointer to a map
+Return:
+1 if empty
+0 if not empty
+
+Time complexity: O(1).
+Space complexity: O(1).
+*/
+
+int HashMapIsEmpty(const hash_map_t *map);
+
+#endif /* __HASH_MAP_H__ */
@@ -0,0 +1,61 @@
+#ifndef __HISTOGRAM_H__
+#define __HISTOGRAM_H__
+
+/*
+histogram of durations in microseconds with log2 buckets: bucket 0 holds
+0 and 1, bucket i holds [2^i, 2^(i+1)). plain data, so it can live in
+shared memory.
+*/
+
+#define HISTOGRAM_BUCKETS (32)
+
+typedef struct Histogram
+{
+	unsigned long counts[HISTOGRAM_BUCKETS];
+	unsigned long count;
+	unsigned long sum_us;
+	unsigned long max_us;
+} histogram_t;
+
+/***********************************************************************/
+/*
+Description: add a value. values beyond the last bucket go to it.
+Arguments:
+hist - valid pointer to a histogram, zero-filled when empty
+value_us - duration in microseconds
+Return: none
+
+Time complexity: O(1).
+Space complexity: O(1).
+*/
+
+void HistogramAdd(histogram_t *hist, unsigned long value_us);
+
+/***********************************************************************/
+/*
+Description: estimate a percentile, as the upper bound of the bucket that
+holds it
+Arguments:
+hist - valid pointer to a histogram
+percent - 0 to 100
+Return: estimated value in microseconds, 0 if the histogram is empty
+
+Time complexity: O(HISTOGRAM_BUCKETS).
+Space complexity: O(1).
+*/
+
+unsigned long HistogramPercentile(const histogram_t *hist, double percent);
+
+/***********************************************************************/
+/*
+Description: get the mean of the values
+Arguments: hist - valid pointer to a histogram
+Return: mean in microseconds, 0 if the histogram is empty
+
+Time complexity: O(1).
+Space complexity: O(1).
+*/
+
+unsigned long HistogramMean(const histogram_t *hist);
+
+#endif /* __HISTOGRAM_H__ */
@@ -0,0 +1,162 @@
+#ifndef __KEY_LIST_H__
+#define __KEY_LIST_H__
+
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* int64_t */
+
+/*
+sorted container that keeps a 64-bit key inline next to each data pointer.
+entries are stored in contiguous blocks of KEYLIST_BLOCK_SIZE keys, so
+searches compare keys directly (SSE2, or AVX2 when the CPU has it) instead
+of calling a compare function on every element.
+entries with equal keys are kept in insertion order.
+*/
+
+#define KEYLIST_BLOCK_SIZE (64)
+
+typedef struct KeyList key_list_t;
+
+typedef int64_t klist_key_t;
+
+/***********************************************************************/
+/*
+Description: create a key list
+Arguments: none
+Return: pointer to a list, or NULL if it fails
+
+Time complexity: O(1).
+Space complexity: O(1).
+*/
+
+key_list_t *KeyListCreate(void);
+
+/***********************************************************************/
+/*
+Description: destroy a list
+Arguments: list - valid pointer to a list
+Return: none
+
+Time complexity: O(n / KEYLIST_BLOCK_SIZE).
+Space complexity: O(1).
+*/
+
+void KeyListDestroy(key_list_t *list);
+
+/***********************************************************************/
+/*
+Description: insert element into a list, after all elements with the same key
+Arguments:
+list - valid pointer to a list
+key - sort key of the element
+data - pointer to data
+Return: 0 on success, 1 on allocation failure
+
+Time complexity: O(log n + KEYLIST_BLOCK_SIZE + n / KEYLIST_BLOCK_SIZE).
+Space complexity: O(1).
+*/
+
+int KeyListInsert(key_list_t *list, klist_key_t key, void *data);
+
+/***********************************************************************/
+/*
+Description: remove the element that holds "data" under "key"
+Arguments:
+list - valid pointer to a list
+key - sort key of the element
+data - data of the element
+Return: 0 if the element was removed, 1 if it was not found
+
+Time complexity: O(log n + KEYLIST_BLOCK_SIZE).
+Space complexity: O(1).
+*/
+
+int KeyListRemove(key_list_t *list, klist_key_t key, void *data);
+
+/***********************************************************************/
+/*
+Description: find the first element (in insertion order) that has "key"
+Arguments:
+list - valid pointer to a list
+key - key to look for
+Return: data of found element, or NULL if none found
+
+Time complexity: O(log n).
+Space complexity: O(1).
+*/
+
+void *KeyListFind(const key_list_t *list, klist_key_t key);
+
+/***********************************************************************/
+/*
+Description: get the element with the smallest key.
+Behavior is undefined if list is empty.
+Arguments:
+list - valid pointer to a list
+key - pointer to store the key in, may be NULL
+Return: data of first element
+
+Time complexity: O(1).
+Space complexity: O(1).
+*/
+
+void *KeyListPeekFront(const key_list_t *list, klist_key_t *key);
+
+/***********************************************************************/
+/*
+Description: remove the element with the smallest key.
+Behavior is undefined if list is empty.
+Arguments:
+list - valid pointer to a list
+key - pointer to store the key in, may be NULL
+Return: data of removed element
+
+Time complexity: O(KEYLIST_BLOCK_SIZE).
+Space complexity: O(1).
+*/
+
+void *KeyListPopFront(key_list_t *list, klist_key_t *key);
+
+/***********************************************************************/
+/*
+Description: run action function on all elements in key order. stops on the
+first action that does not return 0.
+changing the keys is not possible through the action.
+Arguments:
+list - valid pointer to a list
+action - valid pointer to function
+action_param - parameter used by the action function
+Return: status of the failed action, 0 if all succeeded
+
+Time complexity: O(n).
+Space complexity: O(1).
+*/
+
+int KeyListForEach(key_list_t *list, int (*action)(void *data, void *param), void *action_param);
+
+/***********************************************************************/
+/*
+Description: get number of elements in list
+Arguments: list - valid pointer to a list
+Return: number of elements
+
+Time complexity: O(1).
+Space complexity: O(1).
+*/
+
+size_t KeyListSize(const key_list_t *list);
+
+/***********************************************************************/
+/*
+Description: check if list is empty
+Arguments: list - valid pointer to a list
+Return:
+1 if empty
+0 if not empty
+
+Time complexity: O(1).
+Space complexity: O(1).
+*/
+
+int KeyListIsEmpty(const key_list_t *list);
+
+#endif /* __KEY_LIST_H__ */
@@ -0,0 +1,160 @@
+#ifndef __LF_LIST_H__
+#define __LF_LIST_H__
+
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* int64_t */
+
+/*
+lock-free sorted list (Harris / Michael) that can be shared between threads
+without a lock. elements are sorted by a 64-bit key, elements with equal keys
+are kept in insertion order.
+removed nodes are freed through hazard pointers, so every thread that uses the
+list works through a handle it gets from LFListAttach.
+*/
+
+/* maximum number of threads attached to a list at the same time */
+#define LFLIST_MAX_THREADS (32)
+
+typedef struct LFList lf_list_t;
+
+typedef struct LFHandle lf_handle_t;
+
+typedef int64_t lflist_key_t;
+
+/***********************************************************************/
+/*
+Description: create a lock-free sorted list
+Arguments: none
+Return: pointer to a list, or NULL if it fails
+
+Time complexity: O(1).
+Space complexity: O(LFLIST_MAX_THREADS ^ 2).
+*/
+
+lf_list_t *LFListCreate(void);
+
+/***********************************************************************/
+/*
+Description: destroy a list. no thread may use the list during or after this call.
+Arguments: list - valid pointer to a list
+Return: none
+
+Time complexity: O(n).
+Space complexity: O(1).
+*/
+
+void LFListDestroy(lf_list_t *list);
+
+/***********************************************************************/
+/*
+Description: get a handle through which the calling thread uses the list.
+a handle must be used by one thread at a time.
+Arguments: list - valid pointer to a list
+Return: pointer to a handle, or NULL if LFLIST_MAX_THREADS handles are in use
+
+Time complexity: O(LFLIST_MAX_THREADS).
+Space complexity: O(1).
+*/
+
+lf_handle_t *LFListAttach(lf_list_t *list);
+
+/***********************************************************************/
+/*
+Description: give back a handle. nodes it removed that are still in use by
+other threads are freed by the next thread that gets the handle, or by
+LFListDestroy.
+Arguments: handle - valid handle
+Return: none
+
+Time complexity: O(1).
+Space complexity: O(1).
+*/
+
+void LFListDetach(lf_handle_t *handle);
+
+/***********************************************************************/
+/*
+Description: insert element into the list, after all elements with the same key
+Arguments:
+handle - valid handle
+key - sort key of the element
+data - pointer to data
+Return: 0 on success, 1 on allocation failure
+
+Time complexity: O(n).
+Space complexity: O(1).
+*/
+
+int LFListInsert(lf_handle_t *handle, lflist_key_t key, void *data);
+
+/***********************************************************************/
+/*
+Description: remove the element that holds "data" under "key"
+Arguments:
+handle - valid handle
+key - sort key of the element
+data - data of the element
+Return: 0 if the element was removed, 1 if it was not found
+
+Time complexity: O(n).
+Space complexity: O(1).
+*/
+
+int LFListRemove(lf_handle_t *handle, lflist_key_t key, void *data);
+
+/***********************************************************************/
+/*
+Description: find the first element that has "key"
+Arguments:
+handle - valid handle
+key - key to look for
+Return: data of found element, or NULL if none found
+
+Time complexity: O(n).
+Space complexity: O(1).
+*/
+
+void *LFListFind(lf_handle_t *handle, lflist_key_t key);
+
+/***********************************************************************/
+/*
+Description: remove the element with the smallest key
+Arguments:
+handle - valid handle
+key - pointer to store the key in, may be NULL
+Return: data of removed element, or NULL if the list is empty
+
+Time complexity: O(1).
+Space complexity: O(1).
+*/
+
+void *LFListPopFront(lf_handle_t *handle, lflist_key_t *key);
+
+/***********************************************************************/
+/*
+Description: get number of elements in list. while other threads change the
+list the result is only a snapshot.
+Arguments: list - valid pointer to a list
+Return: number of elements
+
+Time complexity: O(1).
+Space complexity: O(1).
+*/
+
+size_t LFListSize(const lf_list_t *list);
+
+/***********************************************************************/
+/*
+Description: check if list is empty
+Arguments: list - valid pointer to a list
+Return:
+1 if empty
+0 if not empty
+
+Time complexity: O(1).
+Space complexity: O(1).
+*/
+
+int LFListIsEmpty(const lf_list_t *list);
+
+#endif /* __LF_LIST_H__ */
@@ -0,0 +1,68 @@
+#ifndef __PID_WATCH_H__
+#define __PID_WATCH_H__
+
+#include <sys/types.h> /* pid_t */
+
+/*
+exit notification for any process (not only children) through Linux pidfds.
+a pidfd becomes readable the moment its process exits.
+*/
+
+/*
+Name: PidWatchOpen
+Description:
+Get a pollable file descriptor for a process.
+Arguments:
+pid - process to watch
+Return: pidfd, or -1 if the process does not exist or pidfds are not
+supported by the kernel (errno is ENOSYS)
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+int PidWatchOpen(pid_t pid);
+
+/*
+Name: PidWatchWait
+Description:
+Wait until the watched process exits. If it is a child of the caller, it is
+reaped.
+Arguments:
+pidfd - descriptor from PidWatchOpen
+pid - the watched process
+timeout_ms - max time to wait, -1 to wait without a limit
+Return: 1 if the process exited, 0 on timeout, -1 on error
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+int PidWatchWait(int pidfd, pid_t pid, int timeout_ms);
+
+/*
+Name: PidWatchGetPid
+Description:
+Find the process of a pidfd, for a pidfd received from another process.
+Arguments:
+pidfd - a pidfd
+Return: pid of the process, 0 if fd is not a pidfd or its process exited
+and was reaped
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+pid_t PidWatchGetPid(int pidfd);
+
+/*
+Name: PidWatchClose
+Description:
+Close a descriptor from PidWatchOpen.
+Arguments:
+pidfd - descriptor from PidWatchOpen
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+void PidWatchClose(int pidfd);
+
+#endif /* __PID_WATCH_H__ */
@@ -97,6 +97,24 @@ Space complexity: O(1).
 
 void *PQErase(pq_t *pq, int (*is_match)(const void *, const void *), void *param);
 
+/*****************************************************************************/
+/*
+Description: Erase every element that matches, in one pass over the queue.
+Arguments:
+pq - valid pointer to a priority queue
+is_match - valid pointer to a match function
+param - parameter for is_match
+erase_data - called with the data of every erased element, may be NULL
+
+Return: number of erased elements
+
+Time complexity: O(n).
+Space complexity: O(1).
+*/
+
+size_t PQEraseAll(pq_t *pq, int (*is_match)(const void *, const void *), void *param,
+				  void (*erase_data)(void *));
+
 /*****************************************************************************/
 /*
 Description: Empty the queue.
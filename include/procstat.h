@@ -0,0 +1,102 @@
+#ifndef __PROC_STAT_H__
+#define __PROC_STAT_H__
+
+#include <sys/types.h> /* pid_t */
+#include <stddef.h>    /* size_t */
+
+/*
+scheduler state of a process or of one of its threads, from
+/proc/<pid>/stat and /proc/<pid>/task/<tid>/stat, and where in the kernel a
+thread waits, from /proc/<pid>/task/<tid>/wchan.
+the resources a process holds come from /proc/<pid>/statm, /proc/<pid>/fd
+and /proc/<pid>/stat.
+*/
+
+typedef struct ProcStat
+{
+    char state;             /* R running, S sleeping, D disk sleep, ... */
+    unsigned long utime_ms; /* cpu time in user mode */
+    unsigned long stime_ms; /* cpu time in kernel mode */
+} proc_stat_t;
+
+/* resources a process holds */
+typedef struct ProcUsage
+{
+    unsigned long rss_kb;  /* resident memory */
+    unsigned long n_fds;   /* open file descriptors */
+    unsigned long n_threads;
+} proc_usage_t;
+
+/*
+Name: ProcStatRead
+Description:
+Read the state of a process or of a thread.
+Arguments:
+pid - process id
+tid - thread id, 0 for the whole process
+stat - filled on success
+Return: 0 on success, -1 if the process or thread does not exist
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+int ProcStatRead(pid_t pid, pid_t tid, proc_stat_t *stat);
+
+/*
+Name: ProcStatReadUsage
+Description:
+Read the memory, file descriptors and threads a process holds.
+Arguments:
+pid - process id
+usage - filled on success
+Return: 0 on success, -1 if the process does not exist
+Time complexity: O(n) for n open file descriptors
+Space complexity: O(1)
+*/
+
+int ProcStatReadUsage(pid_t pid, proc_usage_t *usage);
+
+/*
+Name: ProcStatListThreads
+Description:
+List the threads of a process.
+Arguments:
+pid - process id
+tids - filled with thread ids
+max_tids - size of tids
+Return: number of threads listed, 0 if the process does not exist
+Time complexity: O(n)
+Space complexity: O(1)
+*/
+
+size_t ProcStatListThreads(pid_t pid, pid_t *tids, size_t max_tids);
+
+/*
+Name: ProcStatReadWchan
+Description:
+Read the kernel function a thread sleeps in.
+Arguments:
+pid - process id
+tid - thread id
+wchan - filled with the name, empty if the thread runs or the name is hidden
+size - size of wchan
+Return: 0 on success, -1 if the thread does not exist
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+int ProcStatReadWchan(pid_t pid, pid_t tid, char *wchan, size_t size);
+
+/*
+Name: ProcStatGetTid
+Description:
+Get the kernel id of the calling thread, as used in /proc/<pid>/task.
+Arguments: none
+Return: thread id
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+pid_t ProcStatGetTid(void);
+
+#endif /* __PROC_STAT_H__ */
@@ -0,0 +1,119 @@
+#ifndef __RESTART_POLICY_H__
+#define __RESTART_POLICY_H__
+
+#include <stddef.h> /* size_t */
+
+/*
+when to restart a process that keeps crashing. the first crash after a
+stable run restarts at once; every further crash doubles the delay, up to
+a cap. too many crashes within a sliding window open a circuit breaker:
+the next restart waits for a cool-down and is a trial, and the breaker
+closes once the process runs for a whole window.
+a run is stable if it lasted at least a window.
+*/
+
+#define RESTART_HISTORY (32)
+
+#define RESTART_DEFAULT_WINDOW_MS (60000)
+#define RESTART_DEFAULT_MAX_CRASHES (10)
+#define RESTART_DEFAULT_BASE_DELAY_MS (1000)
+#define RESTART_DEFAULT_MAX_DELAY_MS (60000)
+#define RESTART_DEFAULT_COOL_DOWN_MS (300000)
+
+typedef struct RestartPolicy
+{
+    size_t window_ms;     /* sliding window for counting crashes */
+    size_t max_crashes;   /* crashes in a window that open the breaker, up to
+                             RESTART_HISTORY */
+    size_t base_delay_ms; /* delay after the second crash in a row */
+    size_t max_delay_ms;  /* cap of the delay */
+    size_t cool_down_ms;  /* delay while the breaker is open */
+} restart_policy_t;
+
+typedef struct RestartState
+{
+    unsigned long total_crashes;
+    size_t consecutive;    /* crashes since the last stable run */
+    long last_restart_ms;
+    long next_restart_ms;  /* the earliest time for the next restart */
+    int is_open;           /* circuit breaker */
+    size_t head;
+    size_t n_recent;
+    long crash_times[RESTART_HISTORY]; /* ms, ring of the last crashes */
+} restart_state_t;
+
+/*
+Name: RestartPolicySetDefaults
+Description:
+Give the zero fields of a policy their default values.
+Arguments:
+policy - policy to complete
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+void RestartPolicySetDefaults(restart_policy_t *policy);
+
+/*
+Name: RestartPolicyIsStable
+Description:
+Tell whether a process that is still running has run for a whole window
+since its last restart, after crashes that were not forgotten yet.
+Arguments:
+policy - policy with no zero fields
+state - restart state
+now_ms - current time, on a monotonic clock
+Return: 1 if the run is stable and the state should be reset, 0 otherwise
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+int RestartPolicyIsStable(const restart_policy_t *policy, const restart_state_t *state,
+                          long now_ms);
+
+/*
+Name: RestartPolicyOnStable
+Description:
+Forget the crashes in a row and close the breaker, after a stable run.
+Arguments:
+state - restart state
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+void RestartPolicyOnStable(restart_state_t *state);
+
+/*
+Name: RestartPolicyOnCrash
+Description:
+Record a crash and decide when to restart. Zero-filled state is a valid
+initial state.
+Arguments:
+policy - policy with no zero fields
+state - restart state
+now_ms - time of the crash, on a monotonic clock
+Return: the earliest time for the restart (also in next_restart_ms)
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+long RestartPolicyOnCrash(const restart_policy_t *policy, restart_state_t *state,
+                          long now_ms);
+
+/*
+Name: RestartPolicyOnRestart
+Description:
+Record that the process was restarted.
+Arguments:
+state - restart state
+now_ms - time of the restart
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+void RestartPolicyOnRestart(restart_state_t *state, long now_ms);
+
+#endif /* __RESTART_POLICY_H__ */
@@ -58,23 +58,58 @@ Time complexity: O(n).
 Space complexity: O(1).
 */
 
-uid_t SchedulerAddTask(scheduler_t *scheduler, int (*op_func)(void *), 
+ilrd_uid_t SchedulerAddTask(scheduler_t *scheduler, int (*op_func)(void *), 
 					   		void *op_param, size_t delay_in_sec, 
 					 		size_t interval_in_sec, void (*task_cleanup)(void *), 
 					  		void *cleanup_param);
 					   
 /*****************************************************************************/
 /*
-Description: Remove a task.
+Description: Add task to the scheduler, with delay and interval in milliseconds. 
+Arguments: 
+	*scheduler 		- valid scheduler pointer
+	*op_func 		- valid operation function pointer
+	*param 			- valid pointer to operation function parameter 
+	delay_in_ms		- in how much time should task be executed
+	interval_in_ms  - time interval between task executions
+	*task_cleanup   - valid pointer to task clean up function
+	*cleanup_param  - valid pointer to cleanup function parameter
+Return: UID of created task. return BadUID on failure.
+Time complexity: O(n).
+Space complexity: O(1).
+*/
+
+ilrd_uid_t SchedulerAddTaskMs(scheduler_t *scheduler, int (*op_func)(void *), 
+					   	 void *op_param, size_t delay_in_ms, 
+					 	 size_t interval_in_ms, void (*task_cleanup)(void *), 
+					  	 void *cleanup_param);
+
+/*****************************************************************************/
+/*
+Description: Remove a task. A waiting task is only marked as cancelled, and is
+			 destroyed when it reaches the front of the queue.
 Arguments: 
 	*scheduler - valid scheduler pointer
 	uid   - UID of task to be removed
 Return: SUCCESS / ERROR.
-Time complexity: O(n).
+Time complexity: O(1).
 Space complexity: O(1).
 */
 
-int SchedulerRemoveTask(scheduler_t *scheduler, uid_t uid);
+int SchedulerRemoveTask(scheduler_t *scheduler, ilrd_uid_t uid);
+
+/*****************************************************************************/
+/*
+Description: Check if a task is in the scheduler (waiting or running).
+Arguments: 
+	*scheduler - valid scheduler pointer
+	uid   - UID of task
+Return: TRUE (1) / FALSE (0).
+Time complexity: O(1).
+Space complexity: O(1).
+*/
+
+int SchedulerHasTask(const scheduler_t *scheduler, ilrd_uid_t uid);
 
 /*****************************************************************************/
 /*
@@ -91,7 +126,35 @@ int SchedulerRun(scheduler_t *scheduler);
 
 /*****************************************************************************/
 /*
-Description: Stop the scheduler.
+Description: Run every task whose time has come, without waiting for the 
+			 rest. For callers that wait for the next task in their own event
+			 loop, with SchedulerGetNextTime.
+Arguments: 
+	*scheduler - valid scheduler pointer
+Return: SUCCESS / ERROR if a task could not be queued again.
+Time complexity: O(k * n) for k due tasks.
+Space complexity: O(1).
+*/
+
+int SchedulerRunDue(scheduler_t *scheduler);
+
+/*****************************************************************************/
+/*
+Description: Get the time the next task should run.
+Arguments: 
+	*scheduler - valid scheduler pointer
+Return: Time in ms on the clock of TaskTimeNow, -1 if there are no tasks.
+Time complexity: O(n).
+Space complexity: O(1).
+*/
+
+time_t SchedulerGetNextTime(scheduler_t *scheduler);
+
+/*****************************************************************************/
+/*
+Description: Stop the scheduler. A running scheduler stops after the
+current task, or at once if it is waiting for the next one and its sleep is
+interrupted by a signal. Safe to call from a signal handler.
 Arguments: 
 	*scheduler - valid scheduler pointer
 Return: Void.
@@ -107,7 +170,7 @@ Description: Get the size of a scheduler.
 Arguments: 
 	*scheduler - valid scheduler pointer
 Return: Number of tasks currently in scheduler.
-Time complexity: O(n).
+Time complexity: O(1).
 Space complexity: O(1).
 */
 
@@ -104,6 +104,23 @@ Space complexity: O(1).
 
 int SortListForEach(sort_iter_t from, sort_iter_t to, action_t action, void *action_param);
 
+/***********************************************************************/
+/*
+Description: parallel version of SortListForEach, see DListParallelForEach.
+un-sorting list by changing data is undefined. 
+Arguments: 
+from - valid iterator to first element in range
+to - valid iterator to last element in range ('to' is not included in the range)
+action - valid pointer to a thread-safe function of type action_t
+action_param - valid pointer to data used by the action function
+Return: status of the first failed action in range order, 0 if none failed.
+
+Time complexity: O(n / number of cores) for the actions, O(n) to split the range.
+Space complexity: O(n / DLIST_PARALLEL_CHUNK).
+*/
+
+int SortListParallelForEach(sort_iter_t from, sort_iter_t to, action_t action, void *action_param);
+
 /***********************************************************************/
 /*
 Description: get number of elements in list
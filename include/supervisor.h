@@ -0,0 +1,240 @@
+#ifndef __SUPERVISOR_H__
+#define __SUPERVISOR_H__
+
+#include <stddef.h>    /* size_t */
+#include <stdatomic.h> /* atomic_int */
+
+#include "wdchannel.h"
+
+/*
+one supervisor process watching many client processes, instead of a
+watchdog process per client. clients register in a shared-memory registry
+and beat their own slot; the supervisor checks every client from a single
+timer wheel, gets exit notifications from pidfds in a single epoll loop,
+and revives dead or hung clients through a queue with a concurrency cap.
+clients check the supervisor's heartbeat in turn and restart it.
+the supervisor can also run as a long-running daemon that owns its registry.
+clients then register over a unix socket and hand it a pidfd and a memfd
+with their heartbeat, and the daemon is kept alive by the init system.
+*/
+
+#define WD_SUPERVISOR_MAX_CLIENTS (4096)
+#define WD_SUPERVISOR_PATH_SIZE (232) /* keeps a slot at 5 cache lines */
+#define WD_SUPERVISOR_TICK_MS (10)
+#define WD_SUPERVISOR_MAX_REVIVES (4)
+#define WD_SUPERVISOR_SLOT_ENV ("WD_SLOT")
+#define WD_SUPERVISOR_EXEC_PATH ("./supervisor_op.out")
+#define WD_DAEMON_NAME_SIZE (100) /* fits an abstract unix socket address */
+
+enum WD_SLOT_STATE
+{
+    WD_SLOT_FREE = 0,
+    WD_SLOT_CLAIMED,
+    WD_SLOT_ACTIVE,
+    WD_SLOT_REVIVING
+};
+
+typedef struct WDClientSlot
+{
+    wd_side_t client;
+    atomic_int state;
+    atomic_int pid;
+    unsigned long check_interval_ms;
+    unsigned long miss_threshold;
+    char path[WD_SUPERVISOR_PATH_SIZE];
+} wd_client_slot_t;
+
+typedef struct WDRegistry
+{
+    wd_side_t supervisor;
+    atomic_ulong generation; /* advanced on every attach and release */
+    atomic_int supervisor_pid;
+    char pad[WD_CACHE_LINE - sizeof(atomic_ulong) - sizeof(atomic_int)];
+    wd_client_slot_t slots[WD_SUPERVISOR_MAX_CLIENTS];
+} wd_registry_t;
+
+/*
+Name: WDRegistryOpen
+Description:
+Attach to the registry with the given name, creating it if needed.
+Arguments:
+name - shm object name ("/name")
+Return: pointer to the mapped registry, NULL on failure
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+wd_registry_t *WDRegistryOpen(const char *name);
+
+/*
+Name: WDRegistryClose
+Description:
+Unmap a registry.
+Arguments:
+registry - valid registry
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+void WDRegistryClose(wd_registry_t *registry);
+
+/*
+Name: WDRegistryClaim
+Description:
+Take a free slot for a new client.
+Arguments:
+registry - valid registry
+Return: slot index, -1 if the registry is full
+Time complexity: O(n)
+Space complexity: O(1)
+*/
+
+int WDRegistryClaim(wd_registry_t *registry);
+
+/*
+Name: WDRegistryActivate
+Description:
+Describe the calling process in its slot and hand the slot to the
+supervisor. A client revived by the supervisor activates the slot it finds
+in WD_SUPERVISOR_SLOT_ENV.
+Arguments:
+registry - valid registry
+slot - claimed slot, or the slot of a revived client
+path - executable to run when the client is revived
+check_interval_ms - time between checks of the client's heartbeat
+miss_threshold - checks in a row without a heartbeat before a revive
+Return: 0 on success, -1 if path is too long
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+int WDRegistryActivate(wd_registry_t *registry, int slot, const char *path,
+                       size_t check_interval_ms, size_t miss_threshold);
+
+/*
+Name: WDRegistryRelease
+Description:
+Stop watching a client and free its slot.
+Arguments:
+registry - valid registry
+slot - slot of the client
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+void WDRegistryRelease(wd_registry_t *registry, int slot);
+
+/*
+Name: WDRegistryBeat
+Description:
+Advance the heartbeat counter of a client. Only the client writes it.
+Arguments:
+registry - valid registry
+slot - slot of the client
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+void WDRegistryBeat(wd_registry_t *registry, int slot);
+
+/*
+Name: WDRegistryGetSupervisorBeat
+Description:
+Read the heartbeat counter of the supervisor.
+Arguments:
+registry - valid registry
+Return: current counter value
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+unsigned long WDRegistryGetSupervisorBeat(wd_registry_t *registry);
+
+/*
+Name: SupervisorRun
+Description:
+Run the supervisor of a registry until it is signaled (SIGTERM, SIGINT) or
+it has had no clients for a few seconds. Only one supervisor runs per
+registry; another one returns at once.
+Arguments:
+name - shm object name of the registry
+max_revives - max number of clients being revived at the same time
+Return: 0 on success, -1 on failure
+Time complexity: O(1) per client check
+Space complexity: O(n)
+*/
+
+int SupervisorRun(const char *name, size_t max_revives);
+
+/*
+Name: SupervisorRunDaemon
+Description:
+Run a supervisor daemon until it is signaled (SIGTERM, SIGINT). Clients
+register with WDDaemonRegister on an abstract unix socket; registrations
+are accepted in the same epoll loop that gets the exits of the clients, and
+checked from the same timer wheel. Only processes of the daemon's effective
+user may register, since the daemon runs their path to revive them. Only one
+daemon runs per name; another one returns at once.
+Arguments:
+name - name of the socket, shorter than WD_DAEMON_NAME_SIZE
+max_revives - max number of clients being revived at the same time
+Return: 0 on success, -1 on failure
+Time complexity: O(1) per registration and per client check
+Space complexity: O(n)
+*/
+
+int SupervisorRunDaemon(const char *name, size_t max_revives);
+
+/*
+Name: WDDaemonRegister
+Description:
+Have the calling process watched by a supervisor daemon. The connection
+stays open until WDDaemonRelease; the daemon revives the process when it
+dies or its heartbeat stops, and a revived process registers again with
+the slot it finds in WD_SUPERVISOR_SLOT_ENV.
+Arguments:
+name - name of the daemon's socket
+path - executable to run when the client is revived
+check_interval_ms - time between checks of the client's heartbeat
+miss_threshold - checks in a row without a heartbeat before a revive
+slot - slot of a revived client, -1 for a new one
+beat - receives the heartbeat to advance with WDDaemonBeat
+Return: the connection, -1 on failure
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+int WDDaemonRegister(const char *name, const char *path, size_t check_interval_ms,
+                     size_t miss_threshold, int slot, wd_side_t **beat);
+
+/*
+Name: WDDaemonBeat
+Description:
+Advance the heartbeat counter of a client of a daemon.
+Arguments:
+beat - heartbeat from WDDaemonRegister
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+void WDDaemonBeat(wd_side_t *beat);
+
+/*
+Name: WDDaemonRelease
+Description:
+Stop being watched by the daemon, and close the connection.
+Arguments:
+conn - connection from WDDaemonRegister
+beat - heartbeat from WDDaemonRegister
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+void WDDaemonRelease(int conn, wd_side_t *beat);
+
+#endif /* __SUPERVISOR_H__ */
@@ -14,13 +14,14 @@ enum TASK_RETURN_STATUS
 
 typedef struct Task 
 {
-	uid_t task_id;
+	ilrd_uid_t task_id;
 	int (*op_func)(void *); 
 	void *op_param;
-	time_t time_to_run;
-	size_t interval_in_sec;
+	time_t time_to_run; /* ms, on the clock of TaskTimeNow */
+	size_t interval_in_ms;
 	void (*task_cleanup)(void *);
 	void *cleanup_param;
+	int is_cancelled;
 }task_t;
 
 /*****************************************************************************/
@@ -41,6 +42,36 @@ Space complexity: O(1).
 task_t *TaskCreate(int (*op_func)(void *), void *param, 
 				   size_t delay_in_sec, size_t interval_in_sec, 
 				   void (*task_cleanup)(void *), void *cleanup_param);
+
+/*****************************************************************************/
+/*
+Description: Create a task with a delay and interval in milliseconds.
+Arguments: 
+	*op_func 		- valid operation function pointer
+	*param 			- valid pointer to operation function parameter 
+	delay_in_ms		- in how much time should task be executed
+	interval_in_ms  - time interval between task executions
+	*task_cleanup  - valid pointer to task clean up function
+	*cleanup_param - valid pointer to cleanup function parameter
+Return: Pointer to created task.
+Time complexity: O(1).
+Space complexity: O(1).
+*/
+
+task_t *TaskCreateMs(int (*op_func)(void *), void *param, 
+				     size_t delay_in_ms, size_t interval_in_ms, 
+				     void (*task_cleanup)(void *), void *cleanup_param);
+
+/*****************************************************************************/
+/*
+Description: Get the current time of the clock tasks are scheduled by.
+Arguments: Void.
+Return: Milliseconds on the monotonic clock.
+Time complexity: O(1).
+Space complexity: O(1).
+*/
+
+time_t TaskTimeNow(void);
 				   
 /*****************************************************************************/
 /*
@@ -64,14 +95,14 @@ Time complexity: O(1).
 Space complexity: O(1).
 */		
 	
-uid_t TaskGetUID(const task_t *task); 
+ilrd_uid_t TaskGetUID(const task_t *task); 
 
 /*****************************************************************************/
 /*
 Description: Get the time when the task will run.
 Arguments:
 	*task - valid task pointer
-Return: The time when task will run.
+Return: The time when task will run, in ms on the clock of TaskTimeNow.
 Time complexity: O(1).
 Space complexity: O(1).
 */			
@@ -126,7 +157,31 @@ Time complexity: O(1).
 Space complexity: O(1).
 */	
 		
-int TaskIsMatch(const task_t *task1, uid_t uid); 
+int TaskIsMatch(const task_t *task1, ilrd_uid_t uid); 
+
+/*****************************************************************************/
+/*
+Description: Mark a task as cancelled, so it is destroyed instead of run.
+Arguments: 
+	*task - valid task pointer
+Return: Void.
+Time complexity: O(1).
+Space complexity: O(1).
+*/	
+
+void TaskCancel(task_t *task);
+
+/*****************************************************************************/
+/*
+Description: Check if a task was cancelled.
+Arguments: 
+	*task - valid task pointer
+Return: TRUE (1) if cancelled, FALSE (0) if not.
+Time complexity: O(1).
+Space complexity: O(1).
+*/	
+
+int TaskIsCancelled(const task_t *task);
 
 
 #endif /* __TASK_H__ */
@@ -0,0 +1,102 @@
+#ifndef __TIMER_WHEEL_H__
+#define __TIMER_WHEEL_H__
+
+#include <stddef.h> /* size_t */
+
+/*
+hashed timer wheel over a fixed set of timer ids (0 .. capacity - 1).
+a timer that is due in t ticks waits in bucket (now + t) % buckets with
+(t - 1) / buckets full rounds to go. adding, removing and expiring a timer
+are O(1); a tick walks one bucket.
+*/
+
+typedef struct TimerWheel timer_wheel_t;
+
+/***********************************************************************/
+/*
+Description: create a timer wheel
+Arguments:
+capacity - number of timer ids
+n_buckets - number of buckets, a revolution of the wheel in ticks
+Return: pointer to a wheel, or NULL if it fails
+
+Time complexity: O(capacity + n_buckets).
+Space complexity: O(capacity + n_buckets).
+*/
+
+timer_wheel_t *TimerWheelCreate(size_t capacity, size_t n_buckets);
+
+/***********************************************************************/
+/*
+Description: destroy a timer wheel
+Arguments: wheel - valid pointer to a wheel
+Return: none
+
+Time complexity: O(1).
+Space complexity: O(1).
+*/
+
+void TimerWheelDestroy(timer_wheel_t *wheel);
+
+/***********************************************************************/
+/*
+Description: start a timer. a pending timer is restarted.
+Arguments:
+wheel - valid pointer to a wheel
+id - timer id, less than the capacity
+ticks - ticks until the timer expires, at least 1
+Return: none
+
+Time complexity: O(1).
+Space complexity: O(1).
+*/
+
+void TimerWheelAdd(timer_wheel_t *wheel, size_t id, size_t ticks);
+
+/***********************************************************************/
+/*
+Description: cancel a timer. does nothing if it is not pending.
+Arguments:
+wheel - valid pointer to a wheel
+id - timer id, less than the capacity
+Return: none
+
+Time complexity: O(1).
+Space complexity: O(1).
+*/
+
+void TimerWheelRemove(timer_wheel_t *wheel, size_t id);
+
+/***********************************************************************/
+/*
+Description: check if a timer is pending
+Arguments:
+wheel - valid pointer to a wheel
+id - timer id, less than the capacity
+Return: 1 if pending, 0 otherwise
+
+Time complexity: O(1).
+Space complexity: O(1).
+*/
+
+int TimerWheelIsPending(const timer_wheel_t *wheel, size_t id);
+
+/***********************************************************************/
+/*
+Description: advance the wheel by one tick and expire the due timers. an
+expired timer is no longer pending when expire is called. expire may add
+or remove its own id, but no other id.
+Arguments:
+wheel - valid pointer to a wheel
+expire - function called with the id of every expired timer
+param - parameter for expire
+Return: number of expired timers
+
+Time complexity: O(timers in the bucket).
+Space complexity: O(1).
+*/
+
+size_t TimerWheelTick(timer_wheel_t *wheel, void (*expire)(size_t id, void *param),
+                      void *param);
+
+#endif /* __TIMER_WHEEL_H__ */
@@ -1,22 +1,22 @@
 #ifndef _UID_H__
 #define _UID_H__
 
-#include <time.h> /* time_t */
-#include <sys/types.h> /* pid_t */
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* uint64_t */
 
 typedef struct UID
 {
-	pid_t pid;
-	time_t time;
-	size_t counter;
-	char ip[16];
-}uid_t;
+	uint64_t host;   /* IPv4 address and pid of the creating process */
+	uint64_t serial; /* start time of the process in ms, plus a counter */
+}ilrd_uid_t;
 
-extern const uid_t UIDBadUID;
+extern const ilrd_uid_t UIDBadUID;
 
 /***********************************************************************/
 /*
-Description: Create a UID
+Description: Create a UID. the host address, pid and start time are looked 
+up on the first call (and again in a forked child), later calls only take 
+the next value of an atomic counter.
 Arguments: none
 Return: UID struct
 
@@ -24,18 +24,36 @@ Time complexity: O(1).
 Space complexity: O(1).
 */
 
-uid_t UIDCreate(void);
+ilrd_uid_t UIDCreate(void);
 
 /***********************************************************************/
 /*
-Description: 
+Description: Create n UIDs with a single update of the shared counter
 Arguments:
+uids - array of at least n UIDs
+n - number of UIDs to create
+Return: none
+
+Time complexity: O(n).
+Space complexity: O(1).
+*/
+
+void UIDCreateN(ilrd_uid_t *uids, size_t n);
+
+/***********************************************************************/
+/*
+Description: Check if two UIDs are the same
+Arguments:
+id1 - UID
+id2 - UID
 Return: 
+1 if the UIDs are the same
+0 if they are not
 
-Time complexity: O().
-Space complexity: O().
+Time complexity: O(1).
+Space complexity: O(1).
 */
 
-int UIDIsSame(uid_t id1, uid_t id2);
+int UIDIsSame(ilrd_uid_t id1, ilrd_uid_t id2);
 
 #endif /* _UID_H__ */
@@ -0,0 +1,99 @@
+#ifndef _UID64_H__
+#define _UID64_H__
+
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* uint64_t */
+
+/*
+64-bit ids that sort by creation time:
+
+ | 41 bits: ms since UID64_EPOCH_MS | 10 bits: node | 12 bits: sequence |
+
+the timestamp comes from the monotonic clock (anchored to the wall clock once).
+each thread reserves a block of sequence numbers at a time from a counter
+shared by the process, so creating an id takes no lock, and the shared cache
+line is written once per thread when the block runs out or the millisecond
+changes. when a millisecond runs out of sequence numbers the next millisecond
+is borrowed, so ids never repeat and never go backwards.
+by default each process leases a node that no other live process on the host
+holds, from a table in shared memory. ids of several hosts need a node per
+host and process, set with UID64SetNode. a forked child leases a node of its
+own, unless the node was set: then it makes no ids until it sets a new one.
+*/
+
+#define UID64_EPOCH_MS (1704067200000UL) /* 2024-01-01 00:00:00 UTC */
+#define UID64_NODE_BITS (10)
+#define UID64_SEQ_BITS (12)
+
+/* never a valid id: its time is the epoch itself */
+#define UID64_BAD_ID (0)
+
+typedef uint64_t uid64_t;
+
+/***********************************************************************/
+/*
+Description: Set the node part of the ids created by this process. by default
+it is leased from a table of the live processes on this host; set it to make
+ids that are unique across hosts. a forked child of a process that set its
+node must set another one before it makes ids.
+Arguments: node - node id, only the low UID64_NODE_BITS bits are used
+Return: none
+
+Time complexity: O(1).
+Space complexity: O(1).
+*/
+
+void UID64SetNode(unsigned int node);
+
+/***********************************************************************/
+/*
+Description: Create a time-ordered 64-bit id
+Arguments: none
+Return: id, or UID64_BAD_ID in a forked child that has yet to set its node
+
+Time complexity: O(1).
+Space complexity: O(1).
+*/
+
+uid64_t UID64Create(void);
+
+/***********************************************************************/
+/*
+Description: Create n time-ordered ids with a single reservation
+Arguments:
+ids - array of at least n ids
+n - number of ids to create
+Return: none. the ids are UID64_BAD_ID in a forked child that has yet to set
+its node.
+
+Time complexity: O(n).
+Space complexity: O(1).
+*/
+
+void UID64CreateN(uid64_t *ids, size_t n);
+
+/***********************************************************************/
+/*
+Description: Get the creation time of an id
+Arguments: id - id
+Return: milliseconds since the Unix epoch
+
+Time complexity: O(1).
+Space complexity: O(1).
+*/
+
+uint64_t UID64GetTime(uid64_t id);
+
+/***********************************************************************/
+/*
+Description: Get the node of an id
+Arguments: id - id
+Return: node id
+
+Time complexity: O(1).
+Space complexity: O(1).
+*/
+
+unsigned int UID64GetNode(uid64_t id);
+
+#endif /* _UID64_H__ */
@@ -2,6 +2,10 @@
 #define __WATCHDOG__
 
 #include <stddef.h>
+#include <stdatomic.h> /* atomic_ulong */
+
+#include "restartpolicy.h"
+#include "wdstats.h"
 
 enum
 {
@@ -10,6 +14,83 @@ enum
 	WD_FAILED_TO_CREATE_WATCHDOG
 };
 
+/* 
+resources the user process may hold. when it crosses a limit, the watchdog
+restarts it, preferably in a time window or while the application says it
+is idle.
+*/
+typedef struct WDLimits
+{
+	size_t max_rss_kb;       /* resident memory, 0 for no limit */
+	size_t max_fds;          /* open file descriptors, 0 for no limit */
+	size_t max_threads;      /* 0 for no limit */
+	size_t window_start_min; /* restart window, in minutes after local 
+	                            midnight. it may wrap past midnight */
+	size_t window_end_min;   /* equal to the start for no window */
+	size_t max_defer_ms;     /* max wait for the window or for WDSetIdle, 0
+	                            to restart at once */
+} wd_limits_t;
+
+/* timing of heartbeats and checks. WDStart uses the defaults below. */
+typedef struct WDConfig
+{
+	size_t beat_interval_ms;  /* time between heartbeats of each side */
+	size_t check_interval_ms; /* time between checks of the peer's heartbeat */
+	size_t miss_threshold;    /* checks in a row without a heartbeat before
+	                             the peer is revived */
+	int hot_standby;          /* keep an initialized instance parked in 
+	                             WDStart, to take over when the user process
+	                             dies */
+	const char *supervisor;   /* registry name of a shared supervisor, 
+	                             NULL for a watchdog process of our own */
+	restart_policy_t restart; /* backoff of restarts of a user process that 
+	                             keeps crashing, see restartpolicy.h */
+	int event_loop;           /* no scheduler thread in the user process: the
+	                             application polls WDGetFd and calls 
+	                             WDProcessEvents */
+	int threadless;           /* WD_THREADLESS_OFF, or no thread or timer at
+	                             all in the user process: the application 
+	                             calls WDReportProgress, and the watchdog 
+	                             samples it */
+	size_t kick_window_ms;    /* max time between two WDKick calls once the
+	                             first one is made, 0 to ignore kicks */
+	size_t spin_window_ms;    /* a registered thread that makes no progress 
+	                             for this long while it keeps a cpu busy 
+	                             spins, 0 to ignore */
+	size_t d_state_ms;        /* a thread of the user process that sleeps 
+	                             uninterruptibly (D state) for this long is 
+	                             blocked, 0 to ignore */
+	int hang_action;          /* WD_THREAD_RESTART, or WD_THREAD_REPORT to 
+	                             print the state of every thread of the user
+	                             process, when a thread spins or is blocked */
+	wd_limits_t limits;       /* restarts of a user process that leaks */
+	const char *supervisor_daemon; /* name of a running supervisor daemon, 
+	                                  NULL for none. used over supervisor */
+} wd_config_t;
+
+/* what the watchdog does when a registered thread misses its deadline */
+enum WD_THREAD_ACTION
+{
+	WD_THREAD_RESTART = 0, /* kill the user process, it is then revived */
+	WD_THREAD_REPORT       /* print the state of the thread to stderr */
+};
+
+/* how the watchdog judges a threadless user process */
+enum WD_THREADLESS
+{
+	WD_THREADLESS_OFF = 0,
+	WD_THREADLESS_PROGRESS, /* no progress for miss_threshold checks is a 
+	                           hang */
+	WD_THREADLESS_IDLE_OK   /* unless, per /proc/<pid>/stat, the process 
+	                           sleeps and used no cpu since the last check, 
+	                           e.g. while it waits for work */
+};
+
+#define WD_MAX_PROBES (16)
+#define WD_DEFAULT_BEAT_INTERVAL_MS (1000)
+#define WD_DEFAULT_CHECK_INTERVAL_MS (2000)
+#define WD_DEFAULT_MISS_THRESHOLD (1)
+
 /*
 Name: WDStart
 Description: 
@@ -23,12 +104,284 @@ Space complexity: O(1)
 
 int WDStart(char **path);
 
+/*
+Name: WDStartEx
+Description: 
+Start a watchdog with the given timing. A dead peer is detected after about
+check_interval_ms * miss_threshold, so a check interval of a few beat 
+intervals and a small threshold detect a failure within tens of ms.
+Zero fields take the default value.
+With hot_standby set, the watchdog keeps a second instance of the program
+that runs until its WDStartEx call and waits there. When the user process
+dies, the standby returns from WDStartEx and takes its place, so the restart
+does not pay for the program's initialization. A new standby is started 
+in the background.
+With supervisor set, the process is watched by the supervisor process of
+that registry (see supervisor.h) instead of a watchdog process of its own.
+The supervisor is started if it is not running, and the timing fields apply
+to this process's heartbeat; hot_standby is not used.
+With supervisor_daemon set, the process registers with that supervisor
+daemon (see SupervisorRunDaemon) the same way. The daemon is not started 
+or restarted by its clients, and WDStartEx fails if it is not running.
+Arguments:
+exe_path - path to an executable file
+config - timing configuration, NULL for the defaults
+Return: status
+Time complexity: O(1)
+Space complexity: O(1)  
+*/ 
+
+int WDStartEx(char **path, const wd_config_t *config);
+
+/*
+Name: WDThreadRegister
+Description: 
+Watch the calling thread. The thread calls WDThreadKick whenever it makes
+progress; if it does not for deadline_ms, the watchdog process takes the
+action. Deadlines are checked every beat interval. Call after WDStart, not
+in supervisor mode.
+Arguments:
+deadline_ms - max time between two kicks
+action - WD_THREAD_RESTART / WD_THREAD_REPORT
+Return: handle for WDThreadKick, -1 if no slot is left
+Time complexity: O(1)
+Space complexity: O(1)  
+*/
+
+int WDThreadRegister(size_t deadline_ms, int action);
+
+/*
+Name: WDThreadKick
+Description: 
+Report progress of a registered thread. Costs a relaxed load and store.
+Arguments:
+thread - handle from WDThreadRegister
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)  
+*/
+
+void WDThreadKick(int thread);
+
+/*
+Name: WDThreadUnregister
+Description: 
+Stop watching a thread, e.g. before it exits or blocks on purpose.
+Arguments:
+thread - handle from WDThreadRegister
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)  
+*/
+
+void WDThreadUnregister(int thread);
+
+/*
+Name: WDAddHealthProbe
+Description: 
+Have the scheduler of the watchdog library call a health check of the 
+application periodically, so that a process that is alive but slow or 
+broken is restarted too. A call fails if the probe returns nonzero or takes
+longer than the budget; after max_breaches failures in a row, the watchdog
+restarts the user process. Call before WDStart, in every run of the user
+process; probes are not run with a supervisor or in threadless mode.
+A probe runs on the thread that sends heartbeats, so keep it short.
+Arguments:
+probe - health check, returns 0 if healthy
+param - argument of probe
+interval_ms - time between calls
+budget_ms - max duration of a healthy call
+max_breaches - failures in a row that fail the process
+Return: handle of the probe, -1 if there are WD_MAX_PROBES probes or the 
+watchdog already started
+Time complexity: O(1)
+Space complexity: O(1)  
+*/
+
+int WDAddHealthProbe(int (*probe)(void *param), void *param, size_t interval_ms,
+                     size_t budget_ms, size_t max_breaches);
+
+/*
+Name: WDGetProbeStats
+Description: 
+Get the call counts and the latency histogram of a health probe in this 
+process.
+Arguments:
+probe - handle from WDAddHealthProbe
+stats - filled with a copy of the statistics
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)  
+*/
+
+void WDGetProbeStats(int probe, wd_probe_stats_t *stats);
+
+extern atomic_ulong *wd_kick_counter;
+
+/*
+Name: WDKick
+Description: 
+Tell the watchdog that the main loop of the user process makes progress, 
+e.g. once per request. One relaxed increment of a counter on a cache line 
+of its own in shared memory, so it costs about as much as a store: no 
+function call, system call or locked instruction. Kicks from several 
+threads may overwrite each other, but the counter still moves.
+The watchdog restarts the process if, after the first kick, kick_window_ms
+passes without one.
+Arguments: none
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)  
+*/
+
+#define WDKick() \
+	atomic_store_explicit(wd_kick_counter, \
+	                      atomic_load_explicit(wd_kick_counter, memory_order_relaxed) + 1, \
+	                      memory_order_relaxed)
+
+/*
+Name: WDReportProgress
+Description: 
+Tell the watchdog that a threadless user process makes progress. One store
+to shared memory, no system call. Call at least once per check interval, 
+e.g. for every unit of work.
+Arguments: none
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)  
+*/
+
+void WDReportProgress(void);
+
+/*
+Name: WDSetIdle
+Description: 
+Tell the watchdog whether the user process is idle, e.g. between batches of
+work, so that a restart for a crossed resource limit is cheap now.
+Arguments:
+is_idle - 1 when idle, 0 when busy again
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)  
+*/
+
+void WDSetIdle(int is_idle);
+
+/*
+Name: WDGetFd
+Description: 
+Get the fd that becomes readable when heartbeats or checks are due, in 
+event-loop mode. Add it to the application's poll, select or epoll set, and
+call WDProcessEvents when it is readable.
+Arguments: none
+Return: the fd, -1 if the watchdog is not in event-loop mode
+Time complexity: O(1)
+Space complexity: O(1)  
+*/
+
+int WDGetFd(void);
+
+/*
+Name: WDProcessEvents
+Description: 
+Send the heartbeats and run the checks and health probes that are due, in
+event-loop mode, and set the fd of WDGetFd for the next ones. Call from one
+thread only. Late calls delay the heartbeats, so they count against the 
+check interval like a hung process.
+Arguments: none
+Return: 0 on success, -1 on failure or if not in event-loop mode
+Time complexity: O(k * n) for k due tasks of n
+Space complexity: O(1)  
+*/
+
+int WDProcessEvents(void);
+
+/*
+Name: WDGetStats
+Description: 
+Get the outage statistics of both processes: restart and missed check
+counts, the times of the last heartbeat, detection, revive and first
+heartbeat after the revive, and histograms of the time between them. Does
+not wait for the scheduler thread.
+Arguments:
+stats - filled with a copy of the statistics
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)  
+*/
+
+void WDGetStats(wd_stats_t *stats);
+
+/*
+Name: WDGetRestartState
+Description: 
+Get the crash and restart history of the user process, as kept by the
+watchdog: total crashes, crashes in a row, the time of the next allowed 
+restart and whether the circuit breaker is open.
+Arguments:
+state - filled with a copy of the state
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)  
+*/
+
+void WDGetRestartState(restart_state_t *state);
+
+/*
+Name: WDGetSpawnLatency
+Description: 
+Get the time the user process was stalled by the last spawn of the watchdog
+process, at start or at a revive.
+Arguments: none
+Return: latency in microseconds, -1 if this process has not spawned a 
+watchdog
+Time complexity: O(1)
+Space complexity: O(1)  
+*/
+
+long WDGetSpawnLatency(void);
+
+/*
+Name: WDRegisterPersistentRegion
+Description: 
+Map a region of shared memory that survives crashes of the user process, 
+e.g. for caches that are slow to rebuild. A revived process that registers
+the same name gets the data its predecessor left; a region registered with
+another size starts over zero-filled. Registering a name again in the same
+process returns the same region. The region is removed by WDStop.
+Call after WDStart, with no supervisor.
+The data may be in the middle of an update when the process crashed, so 
+keep it in a form the revived process can validate.
+Arguments:
+name - name of the region, without '/'
+size - size of the region
+Return: address of the region, NULL on failure
+Time complexity: O(1) for a warm region, O(size) for a new one
+Space complexity: O(1)  
+*/
+
+void *WDRegisterPersistentRegion(const char *name, size_t size);
+
+/*
+Name: WDGetRegionGeneration
+Description: 
+Tell a warm region from a new one.
+Arguments:
+region - address from WDRegisterPersistentRegion
+Return: 1 for a region created by this process, higher for a region left by
+earlier processes
+Time complexity: O(1)
+Space complexity: O(1)  
+*/
+
+unsigned long WDGetRegionGeneration(const void *region);
+
 /*
 Name: WDStop
 Description: 
-Stop the watchdog
+Stop the watchdog. Same as WDStopMs(timeout * 1000).
 Arguments:
-timeout - max time to wait for graceful exit 
+timeout - max time to wait for graceful exit, in seconds
 Return: none
 Time complexity: O(1)
 Space complexity: O(1)  
@@ -36,4 +389,19 @@ Space complexity: O(1)
 
 void WDStop(size_t timeout);
 
+/*
+Name: WDStopMs
+Description: 
+Stop the watchdog. The watchdog process is asked to stop once and this
+call sleeps until it acknowledges, typically within a few ms. If it does 
+not acknowledge in time, it is killed.
+Arguments:
+timeout_ms - max time to wait for graceful exit, in ms
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)  
+*/
+
+void WDStopMs(size_t timeout_ms);
+
 #endif /* __WATCHDOG__ */
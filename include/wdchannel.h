@@ -0,0 +1,569 @@
+#ifndef __WD_CHANNEL_H__
+#define __WD_CHANNEL_H__
+
+#include <stdatomic.h> /* atomic_ulong */
+#include <sys/types.h> /* pid_t */
+#include <stddef.h>    /* size_t */
+#include <semaphore.h> /* sem_t */
+
+#include "restartpolicy.h"
+#include "wdstats.h"
+
+/*
+shared-memory channel between a user process and its watchdog. the segment
+is created by the first user process and attached by every process of the
+pair, including revived ones, under the same name.
+each side owns a heartbeat sequence counter on a cache line of its own: a
+beat is one relaxed store, and the other side checks that it moved. the
+user process kicks a third such counter from its own main loop.
+a process that starts or revives its peer waits on a process-shared
+semaphore in the channel until the peer runs, so pairs never share an IPC
+name.
+the channel also names the standby instance of the user process, if any,
+has a flag the user process raises when its health probes fail, one it
+raises while it is idle and may be restarted at little cost,
+and has a slot for every thread of the user process that reports progress.
+to stop, the user process posts a request word and waits on a futex for the
+watchdog's acknowledgment.
+the restart state of the user process and the outage statistics of both
+sides live here too, so that a revived process continues them. each is
+written by one process under a sequence lock, and read as a consistent copy
+without blocking the writer.
+finally, the channel lists the persistent regions of the user process, so
+that they are removed when the pair stops.
+*/
+
+#define WD_CACHE_LINE (64)
+#define WD_MAX_THREADS (64)
+#define WD_MAX_REGIONS (16)
+#define WD_REGION_NAME_SIZE (64)
+
+enum WD_SIDE
+{
+    WD_SIDE_USER = 0,
+    WD_SIDE_WATCHDOG = 1
+};
+
+typedef struct WDSide
+{
+    atomic_ulong beat;
+    char pad[WD_CACHE_LINE - sizeof(atomic_ulong)];
+} wd_side_t;
+
+enum WD_THREAD_STATE
+{
+    WD_THREAD_FREE = 0,
+    WD_THREAD_CLAIMED,
+    WD_THREAD_ACTIVE
+};
+
+typedef struct WDThreadSlot
+{
+    atomic_ulong progress;
+    atomic_ulong serial; /* advanced on every registration */
+    atomic_int state;
+    atomic_int tid;
+    unsigned long deadline_ms;
+    int action;
+    char pad[WD_CACHE_LINE - 2 * sizeof(atomic_ulong) - 2 * sizeof(atomic_int) - 
+             sizeof(unsigned long) - sizeof(int)];
+} wd_thread_slot_t;
+
+enum WD_REGION_STATE
+{
+    WD_REGION_FREE = 0,
+    WD_REGION_CLAIMED,
+    WD_REGION_ACTIVE
+};
+
+typedef struct WDRegionSlot
+{
+    atomic_int state;
+    char name[WD_REGION_NAME_SIZE]; /* shm object name */
+} wd_region_slot_t;
+
+typedef struct WDChannel
+{
+    wd_side_t sides[2];
+    wd_side_t kick; /* progress of the user process's main loop, see WDKick */
+    atomic_int standby_pid;
+    atomic_int stop_request;
+    atomic_int stop_ack; /* futex word */
+    atomic_int is_unhealthy;
+    atomic_int is_idle;
+    char pad[WD_CACHE_LINE - 5 * sizeof(atomic_int)];
+    sem_t ready;   /* posted by a process of the pair once it runs */
+    sem_t standby; /* posted to promote the standby */
+    wd_thread_slot_t threads[WD_MAX_THREADS];
+    atomic_ulong restart_seq; /* odd while the state is written */
+    restart_state_t restart;
+    atomic_ulong stats_seq[2];
+    wd_side_stats_t stats[2]; /* outages of each side, kept by the other */
+    wd_region_slot_t regions[WD_MAX_REGIONS];
+} wd_channel_t;
+
+/*
+Name: WDChannelOpen
+Description:
+Attach to the channel with the given name, creating it if needed.
+Arguments:
+name - shm object name ("/name")
+Return: pointer to the mapped channel, NULL on failure
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+wd_channel_t *WDChannelOpen(const char *name);
+
+/*
+Name: WDChannelInit
+Description:
+Clear a channel, e.g. one left by a crashed pair with the same name, and
+set up its semaphores. Called by the first user process, before it starts
+any other process of the pair.
+Arguments:
+channel - valid channel
+Return: 0 on success, -1 on failure
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+int WDChannelInit(wd_channel_t *channel);
+
+/*
+Name: WDChannelClose
+Description:
+Unmap a channel. The shm object stays until WDChannelUnlink.
+Arguments:
+channel - valid channel
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+void WDChannelClose(wd_channel_t *channel);
+
+/*
+Name: WDChannelUnlink
+Description:
+Remove the shm object of a channel.
+Arguments:
+name - shm object name
+Return: 0 on success, -1 on failure
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+int WDChannelUnlink(const char *name);
+
+/*
+Name: WDChannelBeat
+Description:
+Advance the heartbeat counter of one side. Only that side writes it.
+Arguments:
+channel - valid channel
+side - WD_SIDE_USER / WD_SIDE_WATCHDOG
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+void WDChannelBeat(wd_channel_t *channel, int side);
+
+/*
+Name: WDChannelGetBeat
+Description:
+Read the heartbeat counter of one side.
+Arguments:
+channel - valid channel
+side - WD_SIDE_USER / WD_SIDE_WATCHDOG
+Return: current counter value
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+unsigned long WDChannelGetBeat(wd_channel_t *channel, int side);
+
+/*
+Name: WDChannelSetStandby
+Description:
+Record the pid of the standby user process. The spawned process sets it
+before exec, so it can tell it is the standby when it reaches WDStart.
+Arguments:
+channel - valid channel
+pid - standby pid, 0 for none
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+void WDChannelSetStandby(wd_channel_t *channel, pid_t pid);
+
+/*
+Name: WDChannelGetStandby
+Description:
+Read the pid of the standby user process.
+Arguments:
+channel - valid channel
+Return: standby pid, 0 for none
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+pid_t WDChannelGetStandby(wd_channel_t *channel);
+
+/*
+Name: WDChannelSetUnhealthy
+Description:
+Raise or clear the flag that tells the watchdog the user process failed its
+health probes.
+Arguments:
+channel - valid channel
+is_unhealthy - 1 to raise, 0 to clear
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+void WDChannelSetUnhealthy(wd_channel_t *channel, int is_unhealthy);
+
+/*
+Name: WDChannelIsUnhealthy
+Description:
+Check whether the user process failed its health probes.
+Arguments:
+channel - valid channel
+Return: 1 if it failed, 0 otherwise
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+int WDChannelIsUnhealthy(wd_channel_t *channel);
+
+/*
+Name: WDChannelSetIdle
+Description:
+Tell the watchdog whether the user process is idle.
+Arguments:
+channel - valid channel
+is_idle - 1 if idle, 0 if busy
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+void WDChannelSetIdle(wd_channel_t *channel, int is_idle);
+
+/*
+Name: WDChannelIsIdle
+Description:
+Check whether the user process said it is idle.
+Arguments:
+channel - valid channel
+Return: 1 if idle, 0 otherwise
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+int WDChannelIsIdle(wd_channel_t *channel);
+
+/*
+Name: WDChannelPostReady
+Description:
+Tell the process that started this one that it runs.
+Arguments:
+channel - valid channel
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+void WDChannelPostReady(wd_channel_t *channel);
+
+/*
+Name: WDChannelWaitReady
+Description:
+Wait until a started process runs, for at most timeout_ms. A timeout of 0
+only takes a ready post that is already there.
+Arguments:
+channel - valid channel
+timeout_ms - max time to wait
+Return: 0 on success, -1 on timeout
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+int WDChannelWaitReady(wd_channel_t *channel, size_t timeout_ms);
+
+/*
+Name: WDChannelPromoteStandby
+Description:
+Let the standby return from its wait.
+Arguments:
+channel - valid channel
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+void WDChannelPromoteStandby(wd_channel_t *channel);
+
+/*
+Name: WDChannelWaitPromotion
+Description:
+Park the standby until it is promoted. Signals do not end the wait.
+Arguments:
+channel - valid channel
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+void WDChannelWaitPromotion(wd_channel_t *channel);
+
+/*
+Name: WDChannelRequestStop
+Description:
+Ask the watchdog process to stop.
+Arguments:
+channel - valid channel
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+void WDChannelRequestStop(wd_channel_t *channel);
+
+/*
+Name: WDChannelIsStopRequested
+Description:
+Check if the user process asked to stop.
+Arguments:
+channel - valid channel
+Return: 1 if a stop was requested, 0 otherwise
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+int WDChannelIsStopRequested(wd_channel_t *channel);
+
+/*
+Name: WDChannelAckStop
+Description:
+Tell the user process that the watchdog stopped, and wake it up.
+Arguments:
+channel - valid channel
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+void WDChannelAckStop(wd_channel_t *channel);
+
+/*
+Name: WDChannelWaitStopAck
+Description:
+Block until the watchdog acknowledges the stop, or until the timeout.
+Arguments:
+channel - valid channel
+timeout_ms - max time to wait
+Return: 0 if acknowledged, -1 on timeout
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+int WDChannelWaitStopAck(wd_channel_t *channel, size_t timeout_ms);
+
+/*
+Name: WDChannelRecordCrash
+Description:
+Record a crash of the user process in the restart state. Called by the
+watchdog process only.
+Arguments:
+channel - valid channel
+policy - restart policy with no zero fields
+now_ms - time of the crash, on a monotonic clock
+Return: the earliest time to restart the user process
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+long WDChannelRecordCrash(wd_channel_t *channel, const restart_policy_t *policy,
+                          long now_ms);
+
+/*
+Name: WDChannelRecordRestart
+Description:
+Record a restart of the user process. Called by the watchdog process only.
+Arguments:
+channel - valid channel
+now_ms - time of the restart
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+void WDChannelRecordRestart(wd_channel_t *channel, long now_ms);
+
+/*
+Name: WDChannelRecordRunning
+Description:
+Record that the user process still runs. Once it ran for a whole window
+since its last restart, its crashes in a row are forgotten and the breaker
+closes. Called by the watchdog process only.
+Arguments:
+channel - valid channel
+policy - restart policy with no zero fields
+now_ms - current time
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+void WDChannelRecordRunning(wd_channel_t *channel, const restart_policy_t *policy,
+                            long now_ms);
+
+/*
+Name: WDChannelGetRestartState
+Description:
+Copy the restart state of the user process.
+Arguments:
+channel - valid channel
+state - filled with a consistent copy
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+void WDChannelGetRestartState(wd_channel_t *channel, restart_state_t *state);
+
+/*
+Name: WDChannelStatsBegin
+Description:
+Start an update of the outage statistics of a side. Only the other side
+writes them.
+Arguments:
+channel - valid channel
+side - WD_SIDE_USER / WD_SIDE_WATCHDOG
+Return: the statistics to update
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+wd_side_stats_t *WDChannelStatsBegin(wd_channel_t *channel, int side);
+
+/*
+Name: WDChannelStatsEnd
+Description:
+Publish an update started with WDChannelStatsBegin.
+Arguments:
+channel - valid channel
+side - WD_SIDE_USER / WD_SIDE_WATCHDOG
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+void WDChannelStatsEnd(wd_channel_t *channel, int side);
+
+/*
+Name: WDChannelGetStats
+Description:
+Copy the outage statistics of a side.
+Arguments:
+channel - valid channel
+side - WD_SIDE_USER / WD_SIDE_WATCHDOG
+stats - filled with a consistent copy
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+void WDChannelGetStats(wd_channel_t *channel, int side, wd_side_stats_t *stats);
+
+/*
+Name: WDChannelAddThread
+Description:
+Take a thread slot and publish its deadline.
+Arguments:
+channel - valid channel
+tid - thread id of the caller
+deadline_ms - max time between two kicks of the thread
+action - what the watchdog does when the deadline passes
+Return: slot index, -1 if all slots are taken
+Time complexity: O(WD_MAX_THREADS)
+Space complexity: O(1)
+*/
+
+int WDChannelAddThread(wd_channel_t *channel, pid_t tid, unsigned long deadline_ms,
+                       int action);
+
+/*
+Name: WDChannelRemoveThread
+Description:
+Free a thread slot.
+Arguments:
+channel - valid channel
+thread - slot index from WDChannelAddThread
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+void WDChannelRemoveThread(wd_channel_t *channel, int thread);
+
+/*
+Name: WDChannelClearThreads
+Description:
+Free all thread slots, e.g. the slots of a user process that died.
+Arguments:
+channel - valid channel
+Return: none
+Time complexity: O(WD_MAX_THREADS)
+Space complexity: O(1)
+*/
+
+void WDChannelClearThreads(wd_channel_t *channel);
+
+/*
+Name: WDChannelKickThread
+Description:
+Advance the progress counter of a thread. Only that thread writes it.
+Arguments:
+channel - valid channel
+thread - slot index from WDChannelAddThread
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+void WDChannelKickThread(wd_channel_t *channel, int thread);
+
+/*
+Name: WDChannelAddRegion
+Description:
+List a persistent region, unless it is listed already.
+Arguments:
+channel - valid channel
+name - shm object name of the region, shorter than WD_REGION_NAME_SIZE
+Return: slot index, -1 if all slots are taken
+Time complexity: O(WD_MAX_REGIONS)
+Space complexity: O(1)
+*/
+
+int WDChannelAddRegion(wd_channel_t *channel, const char *name);
+
+/*
+Name: WDChannelUnlinkRegions
+Description:
+Unlink the shm objects of all listed regions and free their slots.
+Arguments:
+channel - valid channel
+Return: none
+Time complexity: O(WD_MAX_REGIONS)
+Space complexity: O(1)
+*/
+
+void WDChannelUnlinkRegions(wd_channel_t *channel);
+
+#endif /* __WD_CHANNEL_H__ */
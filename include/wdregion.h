@@ -0,0 +1,69 @@
+#ifndef __WD_REGION_H__
+#define __WD_REGION_H__
+
+#include <stdatomic.h> /* atomic_ulong */
+#include <stddef.h>    /* size_t */
+
+/*
+persistent regions of a user process: named shm objects that outlive a
+crash, so that a revived process finds the data its predecessor left.
+each region starts with a header that tells a warm region from a new or
+incompatible one, and counts the processes that attached to it.
+*/
+
+#define WD_REGION_MAGIC (0x57445247UL) /* "WDRG" */
+#define WD_REGION_VERSION (1)
+#define WD_REGION_HEADER_SIZE (64)     /* keeps the data on a cache line */
+
+typedef struct WDRegionHeader
+{
+    unsigned long magic;
+    unsigned long version;    /* of this header */
+    atomic_ulong generation;  /* 1 for a new region, advanced on every attach */
+    size_t size;              /* of the data */
+    char pad[WD_REGION_HEADER_SIZE - 3 * sizeof(unsigned long) - sizeof(size_t)];
+} wd_region_header_t;
+
+/*
+Name: WDRegionOpen
+Description:
+Map the region with the given name, creating it if needed. A region with a
+bad header or of another size is cleared and starts a new generation.
+Arguments:
+name - shm object name ("/name")
+size - size of the data
+Return: address of the data, NULL on failure
+Time complexity: O(1) for a warm region, O(size) for a new one
+Space complexity: O(1)
+*/
+
+void *WDRegionOpen(const char *name, size_t size);
+
+/*
+Name: WDRegionClose
+Description:
+Unmap a region. The shm object stays until it is unlinked.
+Arguments:
+data - address from WDRegionOpen
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+void WDRegionClose(void *data);
+
+/*
+Name: WDRegionGetGeneration
+Description:
+Get the generation of a region: 1 if this process created it, higher if it
+was inherited from an earlier process.
+Arguments:
+data - address from WDRegionOpen
+Return: generation
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+unsigned long WDRegionGetGeneration(const void *data);
+
+#endif /* __WD_REGION_H__ */
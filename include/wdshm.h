@@ -0,0 +1,39 @@
+#ifndef __WD_SHM_H__
+#define __WD_SHM_H__
+
+#include <stddef.h> /* size_t */
+
+/*
+named shared memory objects of the watchdog. an object is created
+zero-filled by the first process that opens it, and attached by the rest.
+*/
+
+/*
+Name: WDShmOpen
+Description:
+Map the shm object with the given name, creating it if needed.
+Arguments:
+name - shm object name ("/name")
+size - size of the mapping
+Return: address of the mapping, NULL on failure
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+void *WDShmOpen(const char *name, size_t size);
+
+/*
+Name: WDShmClose
+Description:
+Unmap an object. The shm object stays until it is unlinked.
+Arguments:
+addr - address from WDShmOpen
+size - size passed to WDShmOpen
+Return: none
+Time complexity: O(1)
+Space complexity: O(1)
+*/
+
+void WDShmClose(void *addr, size_t size);
+
+#endif /* __WD_SHM_H__ */
@@ -0,0 +1,42 @@
+#ifndef __WD_STATS_H__
+#define __WD_STATS_H__
+
+#include "histogram.h"
+
+/*
+outage statistics of one process of the pair, kept by the other process.
+times are in microseconds on CLOCK_MONOTONIC, 0 if the event did not
+happen yet.
+*/
+
+typedef struct WDSideStats
+{
+    unsigned long restarts;      /* revives of the process */
+    unsigned long missed_checks; /* checks that found no new heartbeat */
+    long last_beat_us;           /* last heartbeat seen */
+    long last_detect_us;         /* last time it was found dead or hung */
+    long last_revive_us;         /* last time it was revived */
+    long last_healthy_us;        /* first heartbeat after the last revive */
+    histogram_t beat_to_detect;    /* last heartbeat -> detection */
+    histogram_t detect_to_revive;  /* detection -> new process is up */
+    histogram_t revive_to_healthy; /* new process is up -> its first heartbeat
+                                      is seen */
+} wd_side_stats_t;
+
+typedef struct WDStats
+{
+    wd_side_stats_t user;     /* outages of the user process */
+    wd_side_stats_t watchdog; /* outages of the watchdog process */
+} wd_stats_t;
+
+/* calls of a health probe of the user process, kept by that process */
+typedef struct WDProbeStats
+{
+    unsigned long calls;
+    unsigned long failures;    /* calls that reported a failure */
+    unsigned long breaches;    /* calls that took longer than the budget */
+    unsigned long consecutive; /* failures and breaches in a row */
+    histogram_t latency;       /* duration of a call */
+} wd_probe_stats_t;
+
+#endif /* __WD_STATS_H__ */
@@ -1,5 +1,10 @@
+#define _POSIX_C_SOURCE 200112L /* sysconf */
 #include <assert.h> /* assert */
 #include <stdlib.h> /* malloc, free */
+#include <string.h> /* memcpy */
+#include <pthread.h> /* pthread_create, pthread_cond_wait */
+#include <unistd.h> /* sysconf */
+#include <stdatomic.h> /* atomic_size_t */
 
 #include "dlist.h"
 
@@ -24,6 +29,53 @@ struct DList
 	node_t tail;
 };
 
+#define MAX_WORKERS (64)
+/* chunks in a range of DLIST_PARALLEL_THRESHOLD elements */
+#define THRESHOLD_CHUNKS ((DLIST_PARALLEL_THRESHOLD + DLIST_PARALLEL_CHUNK - 1) / DLIST_PARALLEL_CHUNK)
+
+typedef struct ParallelJob
+{
+	/* chunk i is the range [bounds[i], bounds[i + 1]) */
+	node_t **bounds;
+	size_t n_chunks;
+	atomic_size_t next_chunk;
+	
+	/* ForEach: index of the first chunk whose action failed */
+	atomic_size_t failed_chunk;
+	int (*action_func)(void *data, void *param);
+	void *action_param;
+	int *chunk_status;
+	
+	/* MultiFind: matches of each chunk, in range order */
+	int (*match_func)(void *data, const void *param);
+	const void *param;
+	dlist_t **chunk_found;
+	atomic_int alloc_failed;
+} parallel_job_t;
+
+/* helper threads that stay for the life of the process and work on one job at
+   a time, next to the thread that calls a parallel function */
+typedef struct WorkerPool
+{
+	/* held by the thread whose job the pool works on */
+	pthread_mutex_t job_lock;
+	
+	pthread_mutex_t lock;
+	pthread_cond_t job_ready;
+	pthread_cond_t job_done;
+	parallel_job_t *job;
+	/* counts the jobs, so a thread takes each job once */
+	size_t generation;
+	size_t n_threads;
+	/* one per online core, counting the calling thread */
+	size_t max_threads;
+	/* threads still working on the current job */
+	size_t n_busy;
+} worker_pool_t;
+
+static worker_pool_t pool;
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+
 static node_t *EndOfList(node_t *runner);
 static void PointNodeToNext(node_t *curr_node, node_t *next_node);
 static void PointNodeToPrev(node_t *curr_node, node_t *prev_node);
@@ -324,8 +376,7 @@ int DListMultiFind(dlist_iter_t from, dlist_iter_t to, int (*match_func)(void *d
 	
 	while(to != runner)
 	{
-		found = match_func(runner->data, param);
-		if(TRUE == found)
+		if(TRUE == match_func(runner->data, param))
 		{
 			status = DListPushBack(output_list, runner->data); 
 			if(DListEnd(output_list) == status)
@@ -333,8 +384,10 @@ int DListMultiFind(dlist_iter_t from, dlist_iter_t to, int (*match_func)(void *d
 				/* malloc failed */
 				ClearList(output_list);
 				
-				return (FAILURE);
+				return (FALSE);
 			}
+			
+			found = TRUE;
 		}
 		
 		runner = runner->next;
@@ -374,3 +427,394 @@ dlist_iter_t DListSplice(dlist_iter_t where, dlist_iter_t from, dlist_iter_t to)
 
 	return (from);
 }
+
+
+static size_t SplitRange(node_t *from, node_t *to, node_t ***bounds)
+{
+	node_t *first_bounds[THRESHOLD_CHUNKS];
+	size_t capacity = 2 * THRESHOLD_CHUNKS;
+	size_t n_chunks = 0;
+	size_t count = 0;
+	node_t **tmp = NULL;
+	
+	*bounds = NULL;
+	
+	/* a short range is handled by the caller, so stop at the threshold to 
+	   find out, and keep the bounds seen on the way */
+	for(count = 0; count < DLIST_PARALLEL_THRESHOLD && to != from; ++count)
+	{
+		if(0 == count % DLIST_PARALLEL_CHUNK)
+		{
+			first_bounds[n_chunks] = from;
+			++n_chunks;
+		}
+		
+		from = from->next;
+	}
+	
+	if(count < DLIST_PARALLEL_THRESHOLD)
+	{
+		return (0);
+	}
+	
+	*bounds = (node_t **)malloc(capacity * sizeof(node_t *));
+	if(NULL == *bounds)
+	{
+		return (0);
+	}
+	
+	memcpy(*bounds, first_bounds, n_chunks * sizeof(node_t *));
+	
+	/* record the first node of every other chunk, and "to" as the last bound */
+	for(; to != from; ++count)
+	{
+		if(0 == count % DLIST_PARALLEL_CHUNK)
+		{
+			if(n_chunks + 1 == capacity)
+			{
+				capacity *= 2;
+				tmp = (node_t **)realloc(*bounds, capacity * sizeof(node_t *));
+				if(NULL == tmp)
+				{
+					free(*bounds);
+					*bounds = NULL;
+					
+					return (0);
+				}
+				
+				*bounds = tmp;
+			}
+			
+			(*bounds)[n_chunks] = from;
+			++n_chunks;
+		}
+		
+		from = from->next;
+	}
+	
+	(*bounds)[n_chunks] = to;
+	
+	return (n_chunks);
+}
+
+static void ForEachChunk(parallel_job_t *job, size_t chunk)
+{
+	node_t *runner = job->bounds[chunk];
+	node_t *end = job->bounds[chunk + 1];
+	size_t failed = 0;
+	int status = SUCCESS;
+	
+	while(end != runner)
+	{
+		status = job->action_func(runner->data, job->action_param);
+		if(SUCCESS != status)
+		{
+			job->chunk_status[chunk] = status;
+			
+			/* keep the lowest failed chunk */
+			failed = atomic_load(&job->failed_chunk);
+			while(chunk < failed && 
+				  !atomic_compare_exchange_weak(&job->failed_chunk, &failed, chunk))
+			{
+			}
+			
+			return;
+		}
+		
+		runner = runner->next;
+	}
+}
+
+static void MultiFindChunk(parallel_job_t *job, size_t chunk)
+{
+	node_t *runner = job->bounds[chunk];
+	node_t *end = job->bounds[chunk + 1];
+	dlist_t *found = NULL;
+	
+	while(end != runner)
+	{
+		if(TRUE == job->match_func(runner->data, job->param))
+		{
+			if(NULL == found)
+			{
+				found = DListCreate();
+				job->chunk_found[chunk] = found;
+			}
+			
+			if(NULL == found || DListEnd(found) == DListPushBack(found, runner->data))
+			{
+				atomic_store(&job->alloc_failed, TRUE);
+				
+				return;
+			}
+		}
+		
+		runner = runner->next;
+	}
+}
+
+static void *ParallelWorker(void *arg)
+{
+	parallel_job_t *job = (parallel_job_t *)arg;
+	size_t chunk = 0;
+	
+	for(;;)
+	{
+		chunk = atomic_fetch_add(&job->next_chunk, 1);
+		if(chunk >= job->n_chunks)
+		{
+			break;
+		}
+		
+		if(NULL != job->action_func)
+		{
+			/* chunks after a failed one are not needed */
+			if(chunk > atomic_load(&job->failed_chunk))
+			{
+				break;
+			}
+			
+			ForEachChunk(job, chunk);
+		}
+		else
+		{
+			if(atomic_load(&job->alloc_failed))
+			{
+				break;
+			}
+			
+			MultiFindChunk(job, chunk);
+		}
+	}
+	
+	return (NULL);
+}
+
+static void InitPool(void)
+{
+	long n_cores = sysconf(_SC_NPROCESSORS_ONLN);
+	
+	pthread_mutex_init(&pool.job_lock, NULL);
+	pthread_mutex_init(&pool.lock, NULL);
+	pthread_cond_init(&pool.job_ready, NULL);
+	pthread_cond_init(&pool.job_done, NULL);
+	pool.job = NULL;
+	pool.generation = 0;
+	pool.n_threads = 0;
+	pool.n_busy = 0;
+	
+	pool.max_threads = (n_cores < 1 ? 0 : (size_t)n_cores - 1);
+	if(pool.max_threads > MAX_WORKERS - 1)
+	{
+		pool.max_threads = MAX_WORKERS - 1;
+	}
+}
+
+static void InitPoolOnce(void)
+{
+	InitPool();
+	
+	/* a forked child has none of the threads: start over, and start new 
+	   threads on its first job */
+	pthread_atfork(NULL, NULL, &InitPool);
+}
+
+static void *PoolThread(void *arg)
+{
+	/* the generation of the last job, passed in by the thread that started us */
+	size_t generation = (size_t)arg;
+	parallel_job_t *job = NULL;
+	
+	pthread_mutex_lock(&pool.lock);
+	
+	for(;;)
+	{
+		while(generation == pool.generation)
+		{
+			pthread_cond_wait(&pool.job_ready, &pool.lock);
+		}
+		
+		generation = pool.generation;
+		job = pool.job;
+		pthread_mutex_unlock(&pool.lock);
+		
+		ParallelWorker(job);
+		
+		pthread_mutex_lock(&pool.lock);
+		--pool.n_busy;
+		if(0 == pool.n_busy)
+		{
+			pthread_cond_signal(&pool.job_done);
+		}
+	}
+	
+	return (NULL);
+}
+
+/* start the threads that are missing. the first call starts them all. */
+static void GrowPool(void)
+{
+	pthread_attr_t attr;
+	pthread_t thread;
+	
+	if(pool.n_threads >= pool.max_threads || 0 != pthread_attr_init(&attr))
+	{
+		return;
+	}
+	
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	
+	/* no job is posted while we hold the job lock, so pool.generation is the 
+	   last job the new threads must not take */
+	while(pool.n_threads < pool.max_threads && 
+		  0 == pthread_create(&thread, &attr, PoolThread, (void *)pool.generation))
+	{
+		++pool.n_threads;
+	}
+	
+	pthread_attr_destroy(&attr);
+}
+
+static void RunParallelJob(parallel_job_t *job)
+{
+	pthread_once(&pool_once, &InitPoolOnce);
+	
+	/* the pool is busy with the job of another thread, or of an action that 
+	   called us: this thread does the job on its own */
+	if(0 != pthread_mutex_trylock(&pool.job_lock))
+	{
+		ParallelWorker(job);
+		
+		return;
+	}
+	
+	GrowPool();
+	
+	pthread_mutex_lock(&pool.lock);
+	pool.job = job;
+	pool.n_busy = pool.n_threads;
+	++pool.generation;
+	pthread_cond_broadcast(&pool.job_ready);
+	pthread_mutex_unlock(&pool.lock);
+	
+	/* the calling thread is one of the workers */
+	ParallelWorker(job);
+	
+	pthread_mutex_lock(&pool.lock);
+	while(0 != pool.n_busy)
+	{
+		pthread_cond_wait(&pool.job_done, &pool.lock);
+	}
+	pool.job = NULL;
+	pthread_mutex_unlock(&pool.lock);
+	
+	pthread_mutex_unlock(&pool.job_lock);
+}
+
+int DListParallelForEach(dlist_iter_t from, dlist_iter_t to, int(*action_func)(void *data, void *param), void *action_param)
+{
+	parallel_job_t job;
+	int status = SUCCESS;
+	
+	assert(NULL != from);
+	assert(NULL != to);
+	assert(NULL != action_func);
+	
+	job.n_chunks = SplitRange(from, to, &job.bounds);
+	if(0 == job.n_chunks)
+	{
+		return (DListForEach(from, to, action_func, action_param));
+	}
+	
+	job.chunk_status = (int *)calloc(job.n_chunks, sizeof(int));
+	if(NULL == job.chunk_status)
+	{
+		free(job.bounds);
+		
+		return (DListForEach(from, to, action_func, action_param));
+	}
+	
+	atomic_init(&job.next_chunk, 0);
+	atomic_init(&job.failed_chunk, job.n_chunks);
+	atomic_init(&job.alloc_failed, FALSE);
+	job.action_func = action_func;
+	job.action_param = action_param;
+	job.match_func = NULL;
+	job.param = NULL;
+	job.chunk_found = NULL;
+	
+	RunParallelJob(&job);
+	
+	if(atomic_load(&job.failed_chunk) < job.n_chunks)
+	{
+		status = job.chunk_status[atomic_load(&job.failed_chunk)];
+	}
+	
+	free(job.chunk_status);
+	free(job.bounds);
+	
+	return (status);
+}
+
+int DListParallelMultiFind(dlist_iter_t from, dlist_iter_t to, int (*match_func)(void *data, const void *param), const void *param, dlist_t *output_list)
+{
+	parallel_job_t job;
+	size_t i = 0;
+	
+	assert(NULL != from);
+	assert(NULL != to);
+	assert(NULL != match_func);
+	assert(NULL != output_list);
+	
+	job.n_chunks = SplitRange(from, to, &job.bounds);
+	if(0 == job.n_chunks)
+	{
+		return (DListMultiFind(from, to, match_func, param, output_list));
+	}
+	
+	job.chunk_found = (dlist_t **)calloc(job.n_chunks, sizeof(dlist_t *));
+	if(NULL == job.chunk_found)
+	{
+		free(job.bounds);
+		
+		return (DListMultiFind(from, to, match_func, param, output_list));
+	}
+	
+	atomic_init(&job.next_chunk, 0);
+	atomic_init(&job.failed_chunk, job.n_chunks);
+	atomic_init(&job.alloc_failed, FALSE);
+	job.action_func = NULL;
+	job.action_param = NULL;
+	job.chunk_status = NULL;
+	job.match_func = match_func;
+	job.param = param;
+	
+	RunParallelJob(&job);
+	
+	/* merge the matches of every chunk in range order */
+	for(i = 0; i < job.n_chunks; ++i)
+	{
+		if(NULL != job.chunk_found[i])
+		{
+			if(!atomic_load(&job.alloc_failed) && !DListIsEmpty(job.chunk_found[i]))
+			{
+				DListSplice(DListEnd(output_list), DListBegin(job.chunk_found[i]), 
+							DListEnd(job.chunk_found[i]));
+			}
+			
+			DListDestroy(job.chunk_found[i]);
+		}
+	}
+	
+	free(job.chunk_found);
+	free(job.bounds);
+	
+	if(atomic_load(&job.alloc_failed))
+	{
+		ClearList(output_list);
+		
+		return (FALSE);
+	}
+	
+	return (!DListIsEmpty(output_list));
+}
@@ -0,0 +1,287 @@
+#include <assert.h> /* assert */
+#include <stdlib.h> /* malloc, calloc, free */
+#include <string.h> /* memset */
+
+#include "hashmap.h"
+
+enum
+{
+	SUCCESS = 0,
+	FAILURE = 1,
+	TRUE = 1,
+	FALSE = 0
+};
+
+#define MIN_CAPACITY (16)
+
+typedef struct Slot
+{
+	ilrd_uid_t key;
+	void *data;
+	/* distance from the home slot + 1, 0 marks an empty slot */
+	size_t dist;
+} slot_t;
+
+struct HashMap
+{
+	slot_t *slots;
+	size_t mask;
+	size_t size;
+};
+
+static size_t Hash(ilrd_uid_t key)
+{
+	uint64_t hash = key.host ^ (key.serial * (uint64_t)0x9E3779B97F4A7C15UL);
+
+	hash ^= hash >> 32;
+	hash *= (uint64_t)0xD6E8FEB86659FD93UL;
+	hash ^= hash >> 32;
+
+	return ((size_t)hash);
+}
+
+static size_t Capacity(const hash_map_t *map)
+{
+	return (map->mask + 1);
+}
+
+/* index of the slot that holds key, or the capacity if it is not found */
+static size_t FindSlot(const hash_map_t *map, ilrd_uid_t key)
+{
+	size_t idx = Hash(key) & map->mask;
+	size_t dist = 1;
+
+	/* an element further from its home slot than the slot's element would
+	   have taken that slot */
+	while(map->slots[idx].dist >= dist)
+	{
+		if(UIDIsSame(map->slots[idx].key, key))
+		{
+			return (idx);
+		}
+
+		idx = (idx + 1) & map->mask;
+		++dist;
+	}
+
+	return (Capacity(map));
+}
+
+static void PlaceEntry(hash_map_t *map, slot_t entry)
+{
+	size_t idx = Hash(entry.key) & map->mask;
+	slot_t tmp;
+
+	entry.dist = 1;
+
+	for(;;)
+	{
+		if(0 == map->slots[idx].dist)
+		{
+			map->slots[idx] = entry;
+			++map->size;
+
+			return;
+		}
+
+		/* take the slot from an element that is closer to its home */
+		if(map->slots[idx].dist < entry.dist)
+		{
+			tmp = map->slots[idx];
+			map->slots[idx] = entry;
+			entry = tmp;
+		}
+
+		idx = (idx + 1) & map->mask;
+		++entry.dist;
+	}
+}
+
+static int Resize(hash_map_t *map, size_t new_capacity)
+{
+	slot_t *old_slots = map->slots;
+	size_t old_capacity = Capacity(map);
+	size_t i = 0;
+
+	map->slots = (slot_t *)calloc(new_capacity, sizeof(slot_t));
+	if(NULL == map->slots)
+	{
+		map->slots = old_slots;
+
+		return (FAILURE);
+	}
+
+	map->mask = new_capacity - 1;
+	map->size = 0;
+
+	for(i = 0; i < old_capacity; ++i)
+	{
+		if(0 != old_slots[i].dist)
+		{
+			PlaceEntry(map, old_slots[i]);
+		}
+	}
+
+	free(old_slots);
+
+	return (SUCCESS);
+}
+
+hash_map_t *HashMapCreate(size_t capacity)
+{
+	hash_map_t *map = NULL;
+	size_t slots = MIN_CAPACITY;
+
+	/* keep the load under 7/8 for the expected number of elements */
+	while(slots / 8 * 7 < capacity)
+	{
+		slots *= 2;
+	}
+
+	map = (hash_map_t *)malloc(sizeof(hash_map_t));
+	if(NULL == map)
+	{
+		return (NULL);
+	}
+
+	map->slots = (slot_t *)calloc(slots, sizeof(slot_t));
+	if(NULL == map->slots)
+	{
+		free(map);
+
+		return (NULL);
+	}
+
+	map->mask = slots - 1;
+	map->size = 0;
+
+	return (map);
+}
+
+void HashMapDestroy(hash_map_t *map)
+{
+	assert(NULL != map);
+
+	free(map->slots);
+	free(map);
+}
+
+int HashMapInsert(hash_map_t *map, ilrd_uid_t key, void *data)
+{
+	slot_t entry;
+
+	assert(NULL != map);
+	assert(!UIDIsSame(key, UIDBadUID));
+
+	if(Capacity(map) != FindSlot(map, key))
+	{
+		return (FAILURE);
+	}
+
+	if((map->size + 1) * 8 > Capacity(map) * 7 &&
+	   SUCCESS != Resize(map, Capacity(map) * 2))
+	{
+		return (FAILURE);
+	}
+
+	entry.key = key;
+	entry.data = data;
+	entry.dist = 1;
+
+	PlaceEntry(map, entry);
+
+	return (SUCCESS);
+}
+
+void *HashMapRemove(hash_map_t *map, ilrd_uid_t key)
+{
+	size_t idx = 0;
+	size_t next = 0;
+	void *data = NULL;
+
+	assert(NULL != map);
+
+	idx = FindSlot(map, key);
+	if(Capacity(map) == idx)
+	{
+		return (NULL);
+	}
+
+	data = map->slots[idx].data;
+
+	/* shift the following elements of the cluster one slot back */
+	next = (idx + 1) & map->mask;
+	while(1 < map->slots[next].dist)
+	{
+		map->slots[idx] = map->slots[next];
+		--map->slots[idx].dist;
+
+		idx = next;
+		next = (next + 1) & map->mask;
+	}
+
+	map->slots[idx].dist = 0;
+	--map->size;
+
+	return (data);
+}
+
+void *HashMapFind(const hash_map_t *map, ilrd_uid_t key)
+{
+	size_t idx = 0;
+
+	assert(NULL != map);
+
+	idx = FindSlot(map, key);
+	if(Capacity(map) == idx)
+	{
+		return (NULL);
+	}
+
+	return (map->slots[idx].data);
+}
+
+int HashMapForEach(hash_map_t *map, int (*action)(void *data, void *param), void *action_param)
+{
+	size_t i = 0;
+	int status = SUCCESS;
+
+	assert(NULL != map);
+	assert(NULL != action);
+
+	for(i = 0; i < Capacity(map); ++i)
+	{
+		if(0 != map->slots[i].dist)
+		{
+			status = action(map->slots[i].data, action_param);
+			if(SUCCESS != status)
+			{
+				return (status);
+			}
+		}
+	}
+
+	return (status);
+}
+
+void HashMapClear(hash_map_t *map)
+{
+	assert(NULL != map);
+
+	memset(map->slots, 0, Capacity(map) * sizeof(slot_t));
+	map->size = 0;
+}
+
+size_t HashMapSize(const hash_map_t *map)
+{
+	assert(NULL != map);
+
+	return (map->size);
+}
+
+int HashMapIsEmpty(const hash_map_t *map)
+{
+	assert(NULL != map);
+
+	return (0 == map->size);
+}
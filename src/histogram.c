@@ -0,0 +1,77 @@
+#include <assert.h> /* assert */
+#include <stddef.h> /* NULL */
+
+#include "histogram.h"
+
+static unsigned int BucketOf(unsigned long value)
+{
+	unsigned int bucket = 0;
+
+	while(1 < value && HISTOGRAM_BUCKETS - 1 > bucket)
+	{
+		value >>= 1;
+		++bucket;
+	}
+
+	return (bucket);
+}
+
+void HistogramAdd(histogram_t *hist, unsigned long value_us)
+{
+	assert(NULL != hist);
+
+	++hist->counts[BucketOf(value_us)];
+	++hist->count;
+	hist->sum_us += value_us;
+
+	if(value_us > hist->max_us)
+	{
+		hist->max_us = value_us;
+	}
+}
+
+unsigned long HistogramPercentile(const histogram_t *hist, double percent)
+{
+	unsigned long rank = 0;
+	unsigned long seen = 0;
+	unsigned int i = 0;
+
+	assert(NULL != hist);
+	assert(0 <= percent && 100 >= percent);
+
+	if(0 == hist->count)
+	{
+		return (0);
+	}
+
+	/* the value at this 1-based position in sorted order */
+	rank = (unsigned long)(percent / 100 * hist->count + 0.5);
+	if(0 == rank)
+	{
+		rank = 1;
+	}
+
+	for(i = 0; HISTOGRAM_BUCKETS - 1 > i; ++i)
+	{
+		seen += hist->counts[i];
+		if(seen >= rank)
+		{
+			break;
+		}
+	}
+
+	/* the max is a tighter bound for the last buckets */
+	if(HISTOGRAM_BUCKETS - 1 == i || (2UL << i) - 1 > hist->max_us)
+	{
+		return (hist->max_us);
+	}
+
+	return ((2UL << i) - 1);
+}
+
+unsigned long HistogramMean(const histogram_t *hist)
+{
+	assert(NULL != hist);
+
+	return (0 == hist->count ? 0 : hist->sum_us / hist->count);
+}
@@ -0,0 +1,535 @@
+#include <assert.h> /* assert */
+#include <stdlib.h> /* malloc, realloc, free */
+#include <string.h> /* memmove, memcpy */
+
+/* the AVX2 kernel is built for its own target and picked at run time, so the
+   rest of the file does not need -mavx2 and runs on any x86-64 */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KEYLIST_AVX2
+#include <immintrin.h> /* _mm256_cmpgt_epi64, _mm_cmpgt_epi32 */
+#elif defined(__SSE2__)
+#include <emmintrin.h> /* _mm_cmpgt_epi32 */
+#endif
+
+#include "keylist.h"
+
+enum
+{
+	SUCCESS = 0,
+	FAILURE = 1,
+	TRUE = 1,
+	FALSE = 0
+};
+
+/* binary search narrows a range down to this many keys before the SIMD scan */
+#define SCAN_WIDTH (32)
+
+#define INITIAL_BLOCKS (8)
+
+/* number of keys smaller than key, in an array of n keys */
+typedef size_t (*scan_less_t)(const klist_key_t *keys, size_t n, klist_key_t key);
+
+typedef struct KeyBlock
+{
+	klist_key_t keys[KEYLIST_BLOCK_SIZE];
+	void *data[KEYLIST_BLOCK_SIZE];
+	size_t count;
+} key_block_t;
+
+struct KeyList
+{
+	key_block_t **blocks;
+	/* fences[i] is the last (largest) key of blocks[i] */
+	klist_key_t *fences;
+	size_t n_blocks;
+	size_t capacity;
+	size_t size;
+	/* compare kernel picked for this CPU when the list is created */
+	scan_less_t scan_less;
+};
+
+/******************************* compare kernels ******************************/
+
+static size_t ScanLessScalar(const klist_key_t *keys, size_t n, klist_key_t key)
+{
+	size_t count = 0;
+	size_t i = 0;
+
+	for(i = 0; i < n; ++i)
+	{
+		count += (keys[i] < key);
+	}
+
+	return (count);
+}
+
+#if defined(__SSE2__)
+
+/* SSE2 has no 64-bit compare: compare the high halves as signed, and when
+   they are equal take the borrow of the 64-bit subtraction */
+static __m128i CmpGt64(__m128i a, __m128i b)
+{
+	__m128i res = _mm_and_si128(_mm_cmpeq_epi32(a, b), _mm_sub_epi64(b, a));
+
+	res = _mm_or_si128(res, _mm_cmpgt_epi32(a, b));
+
+	return (_mm_shuffle_epi32(res, _MM_SHUFFLE(3, 3, 1, 1)));
+}
+
+static size_t ScanLessSse2(const klist_key_t *keys, size_t n, klist_key_t key)
+{
+	__m128i key_vec = _mm_set1_epi64x(key);
+	int mask = 0;
+	size_t count = 0;
+	size_t i = 0;
+
+	for(i = 0; i + 2 <= n; i += 2)
+	{
+		mask = _mm_movemask_pd(_mm_castsi128_pd(
+			   CmpGt64(key_vec, _mm_loadu_si128((const __m128i *)(keys + i)))));
+		count += (mask & 1) + (mask >> 1);
+	}
+
+	return (count + ScanLessScalar(keys + i, n - i, key));
+}
+
+#endif
+
+#if defined(KEYLIST_AVX2)
+
+__attribute__((target("avx2")))
+static size_t ScanLessAvx2(const klist_key_t *keys, size_t n, klist_key_t key)
+{
+	__m256i key_vec = _mm256_set1_epi64x(key);
+	__m256i less = _mm256_setzero_si256();
+	size_t count = 0;
+	size_t i = 0;
+
+	for(i = 0; i + 4 <= n; i += 4)
+	{
+		/* key > keys[i] is keys[i] < key */
+		less = _mm256_cmpgt_epi64(key_vec, _mm256_loadu_si256((const __m256i *)(keys + i)));
+		count += __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(less)));
+	}
+
+	return (count + ScanLessScalar(keys + i, n - i, key));
+}
+
+#endif
+
+/* the widest kernel the CPU we run on has */
+static scan_less_t PickScanLess(void)
+{
+#if defined(KEYLIST_AVX2)
+	if(__builtin_cpu_supports("avx2"))
+	{
+		return (&ScanLessAvx2);
+	}
+#endif
+
+#if defined(__SSE2__)
+	return (&ScanLessSse2);
+#else
+	return (&ScanLessScalar);
+#endif
+}
+
+/* number of keys smaller than key, in a sorted array */
+static size_t CountLess(const key_list_t *list, const klist_key_t *keys, size_t n,
+						klist_key_t key)
+{
+	size_t low = 0;
+	size_t high = n;
+	size_t mid = 0;
+
+	while(high - low > SCAN_WIDTH)
+	{
+		mid = low + (high - low) / 2;
+
+		if(keys[mid] < key)
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+
+	return (low + list->scan_less(keys + low, high - low, key));
+}
+
+/* number of keys smaller than or equal to key, in a sorted array */
+static size_t CountLessEqual(const key_list_t *list, const klist_key_t *keys, size_t n,
+							 klist_key_t key)
+{
+	if(INT64_MAX == key)
+	{
+		return (n);
+	}
+
+	return (CountLess(list, keys, n, key + 1));
+}
+
+/******************************************************************************/
+
+static void UpdateFence(key_list_t *list, size_t block)
+{
+	key_block_t *blk = list->blocks[block];
+
+	list->fences[block] = blk->keys[blk->count - 1];
+}
+
+static int GrowBlocks(key_list_t *list)
+{
+	size_t new_capacity = list->capacity * 2;
+	key_block_t **blocks = NULL;
+	klist_key_t *fences = NULL;
+
+	blocks = (key_block_t **)realloc(list->blocks, new_capacity * sizeof(key_block_t *));
+	if(NULL == blocks)
+	{
+		return (FAILURE);
+	}
+	list->blocks = blocks;
+
+	fences = (klist_key_t *)realloc(list->fences, new_capacity * sizeof(klist_key_t));
+	if(NULL == fences)
+	{
+		return (FAILURE);
+	}
+	list->fences = fences;
+
+	list->capacity = new_capacity;
+
+	return (SUCCESS);
+}
+
+/* place a new empty block at index "where" */
+static key_block_t *AddBlock(key_list_t *list, size_t where)
+{
+	key_block_t *block = NULL;
+
+	if(list->n_blocks == list->capacity && SUCCESS != GrowBlocks(list))
+	{
+		return (NULL);
+	}
+
+	block = (key_block_t *)malloc(sizeof(key_block_t));
+	if(NULL == block)
+	{
+		return (NULL);
+	}
+	block->count = 0;
+
+	memmove(list->blocks + where + 1, list->blocks + where,
+			(list->n_blocks - where) * sizeof(key_block_t *));
+	memmove(list->fences + where + 1, list->fences + where,
+			(list->n_blocks - where) * sizeof(klist_key_t));
+
+	list->blocks[where] = block;
+	++list->n_blocks;
+
+	return (block);
+}
+
+static void RemoveBlock(key_list_t *list, size_t where)
+{
+	free(list->blocks[where]);
+
+	memmove(list->blocks + where, list->blocks + where + 1,
+			(list->n_blocks - where - 1) * sizeof(key_block_t *));
+	memmove(list->fences + where, list->fences + where + 1,
+			(list->n_blocks - where - 1) * sizeof(klist_key_t));
+
+	--list->n_blocks;
+}
+
+/* move the upper half of a full block into a new block after it */
+static int SplitBlock(key_list_t *list, size_t block)
+{
+	key_block_t *lower = list->blocks[block];
+	key_block_t *upper = NULL;
+	size_t half = KEYLIST_BLOCK_SIZE / 2;
+
+	upper = AddBlock(list, block + 1);
+	if(NULL == upper)
+	{
+		return (FAILURE);
+	}
+
+	memcpy(upper->keys, lower->keys + half, (lower->count - half) * sizeof(klist_key_t));
+	memcpy(upper->data, lower->data + half, (lower->count - half) * sizeof(void *));
+	upper->count = lower->count - half;
+	lower->count = half;
+
+	UpdateFence(list, block);
+	UpdateFence(list, block + 1);
+
+	return (SUCCESS);
+}
+
+static void InsertInBlock(key_block_t *block, size_t pos, klist_key_t key, void *data)
+{
+	memmove(block->keys + pos + 1, block->keys + pos, (block->count - pos) * sizeof(klist_key_t));
+	memmove(block->data + pos + 1, block->data + pos, (block->count - pos) * sizeof(void *));
+
+	block->keys[pos] = key;
+	block->data[pos] = data;
+	++block->count;
+}
+
+static void RemoveFromBlock(key_block_t *block, size_t pos)
+{
+	memmove(block->keys + pos, block->keys + pos + 1, (block->count - pos - 1) * sizeof(klist_key_t));
+	memmove(block->data + pos, block->data + pos + 1, (block->count - pos - 1) * sizeof(void *));
+
+	--block->count;
+}
+
+key_list_t *KeyListCreate(void)
+{
+	key_list_t *list = NULL;
+
+	list = (key_list_t *)malloc(sizeof(key_list_t));
+	if(NULL == list)
+	{
+		return (NULL);
+	}
+
+	list->blocks = (key_block_t **)malloc(INITIAL_BLOCKS * sizeof(key_block_t *));
+	list->fences = (klist_key_t *)malloc(INITIAL_BLOCKS * sizeof(klist_key_t));
+	if(NULL == list->blocks || NULL == list->fences)
+	{
+		free(list->blocks);
+		free(list->fences);
+		free(list);
+
+		return (NULL);
+	}
+
+	list->n_blocks = 0;
+	list->capacity = INITIAL_BLOCKS;
+	list->size = 0;
+	list->scan_less = PickScanLess();
+
+	return (list);
+}
+
+void KeyListDestroy(key_list_t *list)
+{
+	size_t i = 0;
+
+	assert(NULL != list);
+
+	for(i = 0; i < list->n_blocks; ++i)
+	{
+		free(list->blocks[i]);
+	}
+
+	free(list->blocks);
+	free(list->fences);
+	free(list);
+}
+
+int KeyListInsert(key_list_t *list, klist_key_t key, void *data)
+{
+	size_t block = 0;
+	size_t pos = 0;
+	key_block_t *blk = NULL;
+
+	assert(NULL != list);
+
+	if(0 == list->n_blocks)
+	{
+		if(NULL == AddBlock(list, 0))
+		{
+			return (FAILURE);
+		}
+	}
+
+	/* first block whose last key is greater than key, or the last block.
+	   a new first block is empty and has no fence yet, so it is the one. */
+	if(0 != list->blocks[0]->count)
+	{
+		block = CountLessEqual(list, list->fences, list->n_blocks, key);
+		if(block == list->n_blocks)
+		{
+			--block;
+		}
+	}
+
+	if(KEYLIST_BLOCK_SIZE == list->blocks[block]->count)
+	{
+		if(SUCCESS != SplitBlock(list, block))
+		{
+			return (FAILURE);
+		}
+
+		if(list->fences[block] <= key)
+		{
+			++block;
+		}
+	}
+
+	blk = list->blocks[block];
+	pos = CountLessEqual(list, blk->keys, blk->count, key);
+
+	InsertInBlock(blk, pos, key, data);
+	UpdateFence(list, block);
+	++list->size;
+
+	return (SUCCESS);
+}
+
+int KeyListRemove(key_list_t *list, klist_key_t key, void *data)
+{
+	size_t block = 0;
+	size_t pos = 0;
+	key_block_t *blk = NULL;
+
+	assert(NULL != list);
+
+	/* first block whose last key is not smaller than key */
+	block = CountLess(list, list->fences, list->n_blocks, key);
+	if(block == list->n_blocks)
+	{
+		return (FAILURE);
+	}
+
+	blk = list->blocks[block];
+	pos = CountLess(list, blk->keys, blk->count, key);
+
+	/* walk the entries with an equal key until data matches */
+	while(key == blk->keys[pos] && data != blk->data[pos])
+	{
+		++pos;
+
+		if(pos == blk->count)
+		{
+			++block;
+			if(block == list->n_blocks)
+			{
+				return (FAILURE);
+			}
+
+			blk = list->blocks[block];
+			pos = 0;
+		}
+	}
+
+	if(key != blk->keys[pos])
+	{
+		return (FAILURE);
+	}
+
+	RemoveFromBlock(blk, pos);
+	--list->size;
+
+	if(0 == blk->count)
+	{
+		RemoveBlock(list, block);
+	}
+	else
+	{
+		UpdateFence(list, block);
+	}
+
+	return (SUCCESS);
+}
+
+void *KeyListFind(const key_list_t *list, klist_key_t key)
+{
+	size_t block = 0;
+	size_t pos = 0;
+	key_block_t *blk = NULL;
+
+	assert(NULL != list);
+
+	block = CountLess(list, list->fences, list->n_blocks, key);
+	if(block == list->n_blocks)
+	{
+		return (NULL);
+	}
+
+	blk = list->blocks[block];
+	pos = CountLess(list, blk->keys, blk->count, key);
+
+	if(key != blk->keys[pos])
+	{
+		return (NULL);
+	}
+
+	return (blk->data[pos]);
+}
+
+void *KeyListPeekFront(const key_list_t *list, klist_key_t *key)
+{
+	assert(NULL != list);
+	assert(!KeyListIsEmpty(list));
+
+	if(NULL != key)
+	{
+		*key = list->blocks[0]->keys[0];
+	}
+
+	return (list->blocks[0]->data[0]);
+}
+
+void *KeyListPopFront(key_list_t *list, klist_key_t *key)
+{
+	void *data = NULL;
+
+	assert(NULL != list);
+	assert(!KeyListIsEmpty(list));
+
+	data = KeyListPeekFront(list, key);
+
+	RemoveFromBlock(list->blocks[0], 0);
+	--list->size;
+
+	if(0 == list->blocks[0]->count)
+	{
+		RemoveBlock(list, 0);
+	}
+
+	return (data);
+}
+
+int KeyListForEach(key_list_t *list, int (*action)(void *data, void *param), void *action_param)
+{
+	size_t block = 0;
+	size_t pos = 0;
+	int status = SUCCESS;
+
+	assert(NULL != list);
+	assert(NULL != action);
+
+	for(block = 0; block < list->n_blocks; ++block)
+	{
+		for(pos = 0; pos < list->blocks[block]->count; ++pos)
+		{
+			status = action(list->blocks[block]->data[pos], action_param);
+			if(SUCCESS != status)
+			{
+				return (status);
+			}
+		}
+	}
+
+	return (status);
+}
+
+size_t KeyListSize(const key_list_t *list)
+{
+	assert(NULL != list);
+
+	return (list->size);
+}
+
+int KeyListIsEmpty(const key_list_t *list)
+{
+	assert(NULL != list);
+
+	return (0 == list->size);
+}
@@ -0,0 +1,529 @@
+#include <assert.h>    /* assert */
+#include <stdlib.h>    /* malloc, free, qsort, bsearch */
+#include <stdatomic.h> /* atomic_uintptr_t */
+
+#include "lflist.h"
+
+enum
+{
+	SUCCESS = 0,
+	FAILURE = 1,
+	TRUE = 1,
+	FALSE = 0
+};
+
+#define CACHE_LINE (64)
+
+/* hazard pointer slots of every handle */
+enum HAZARD_SLOT
+{
+	HP_PREV = 0,
+	HP_CUR = 1,
+	HAZARDS_PER_THREAD = 2
+};
+
+#define MAX_HAZARDS (LFLIST_MAX_THREADS * HAZARDS_PER_THREAD)
+
+/* a handle frees its retired nodes once it has this many */
+#define RETIRE_THRESHOLD (2 * MAX_HAZARDS)
+
+/* the lowest bit of a next pointer marks its node as logically removed */
+#define MARK ((uintptr_t)1)
+
+typedef struct LFNode lf_node_t;
+
+struct LFNode
+{
+	lflist_key_t key;
+	size_t seq;
+	void *data;
+	atomic_uintptr_t next;
+};
+
+struct LFHandle
+{
+	atomic_uintptr_t hazards[HAZARDS_PER_THREAD];
+	atomic_int in_use;
+	lf_list_t *list;
+	size_t n_retired;
+	lf_node_t *retired[RETIRE_THRESHOLD];
+	char pad[CACHE_LINE];
+};
+
+struct LFList
+{
+	atomic_uintptr_t head;
+	atomic_size_t seq;
+	atomic_size_t size;
+	lf_handle_t handles[LFLIST_MAX_THREADS];
+};
+
+/* what a search is looking for */
+enum SEARCH_MODE
+{
+	BY_SEQ,   /* position of (key, seq), for inserting */
+	BY_KEY,   /* first element with key */
+	BY_DATA,  /* element with key and data */
+	FIRST     /* first element in list */
+};
+
+typedef struct Target
+{
+	int mode;
+	lflist_key_t key;
+	size_t seq;
+	void *data;
+} target_t;
+
+typedef struct Position
+{
+	atomic_uintptr_t *prev;
+	lf_node_t *cur;
+	uintptr_t next;
+} position_t;
+
+static int IsMarked(uintptr_t ptr)
+{
+	return (0 != (ptr & MARK));
+}
+
+static lf_node_t *ToNode(uintptr_t ptr)
+{
+	return ((lf_node_t *)(ptr & ~MARK));
+}
+
+/********************************* hazard pointers ****************************/
+
+static void Protect(lf_handle_t *handle, int slot, lf_node_t *node)
+{
+	atomic_store(&handle->hazards[slot], (uintptr_t)node);
+}
+
+static void ClearHazards(lf_handle_t *handle)
+{
+	int i = 0;
+
+	for(i = 0; i < HAZARDS_PER_THREAD; ++i)
+	{
+		atomic_store(&handle->hazards[i], (uintptr_t)0);
+	}
+}
+
+static int ComparePtr(const void *ptr1, const void *ptr2)
+{
+	uintptr_t p1 = *(const uintptr_t *)ptr1;
+	uintptr_t p2 = *(const uintptr_t *)ptr2;
+
+	return ((p1 > p2) - (p1 < p2));
+}
+
+/* free every retired node that no thread holds a hazard pointer to */
+static void Scan(lf_handle_t *handle)
+{
+	uintptr_t hazards[MAX_HAZARDS];
+	size_t n_hazards = 0;
+	size_t kept = 0;
+	size_t i = 0;
+	int j = 0;
+	uintptr_t ptr = 0;
+	lf_list_t *list = handle->list;
+
+	for(i = 0; i < LFLIST_MAX_THREADS; ++i)
+	{
+		for(j = 0; j < HAZARDS_PER_THREAD; ++j)
+		{
+			ptr = atomic_load(&list->handles[i].hazards[j]);
+			if(0 != ptr)
+			{
+				hazards[n_hazards] = ptr;
+				++n_hazards;
+			}
+		}
+	}
+
+	qsort(hazards, n_hazards, sizeof(uintptr_t), ComparePtr);
+
+	for(i = 0; i < handle->n_retired; ++i)
+	{
+		ptr = (uintptr_t)handle->retired[i];
+
+		if(NULL == bsearch(&ptr, hazards, n_hazards, sizeof(uintptr_t), ComparePtr))
+		{
+			free(handle->retired[i]);
+		}
+		else
+		{
+			handle->retired[kept] = handle->retired[i];
+			++kept;
+		}
+	}
+
+	handle->n_retired = kept;
+}
+
+static void Retire(lf_handle_t *handle, lf_node_t *node)
+{
+	handle->retired[handle->n_retired] = node;
+	++handle->n_retired;
+
+	if(RETIRE_THRESHOLD == handle->n_retired)
+	{
+		Scan(handle);
+	}
+}
+
+/******************************************************************************/
+
+static int GoesBefore(const lf_node_t *node, const target_t *target)
+{
+	switch(target->mode)
+	{
+		case BY_SEQ:
+			return (node->key < target->key ||
+					(node->key == target->key && node->seq < target->seq));
+
+		case BY_KEY:
+			return (node->key < target->key);
+
+		case BY_DATA:
+			return (node->key < target->key ||
+					(node->key == target->key && node->data != target->data));
+
+		default:
+			return (FALSE);
+	}
+}
+
+static int IsFound(const lf_node_t *node, const target_t *target)
+{
+	switch(target->mode)
+	{
+		case BY_KEY:
+			return (node->key == target->key);
+
+		case BY_DATA:
+			return (node->key == target->key && node->data == target->data);
+
+		default:
+			return (TRUE);
+	}
+}
+
+/* find the first node that does not go before target, unlinking removed nodes
+   on the way. on return the current node (if any) is protected by HP_CUR and
+   the node that holds pos->prev by HP_PREV */
+static int Search(lf_handle_t *handle, const target_t *target, position_t *pos)
+{
+	lf_list_t *list = handle->list;
+	atomic_uintptr_t *prev = NULL;
+	lf_node_t *cur = NULL;
+	uintptr_t next = 0;
+	uintptr_t expected = 0;
+
+try_again:
+	prev = &list->head;
+	cur = ToNode(atomic_load(prev));
+
+	for(;;)
+	{
+		if(NULL == cur)
+		{
+			pos->prev = prev;
+			pos->cur = NULL;
+			pos->next = 0;
+
+			return (FALSE);
+		}
+
+		Protect(handle, HP_CUR, cur);
+
+		/* cur may have been unlinked before it was protected */
+		if(atomic_load(prev) != (uintptr_t)cur)
+		{
+			goto try_again;
+		}
+
+		next = atomic_load(&cur->next);
+
+		if(IsMarked(next))
+		{
+			/* cur was removed, finish unlinking it */
+			expected = (uintptr_t)cur;
+			if(!atomic_compare_exchange_strong(prev, &expected, (uintptr_t)ToNode(next)))
+			{
+				goto try_again;
+			}
+
+			Retire(handle, cur);
+			cur = ToNode(next);
+
+			continue;
+		}
+
+		if(!GoesBefore(cur, target))
+		{
+			pos->prev = prev;
+			pos->cur = cur;
+			pos->next = next;
+
+			return (IsFound(cur, target));
+		}
+
+		/* cur is already protected by HP_CUR, so no fence is needed here */
+		atomic_store_explicit(&handle->hazards[HP_PREV], (uintptr_t)cur, memory_order_release);
+		prev = &cur->next;
+		cur = ToNode(next);
+	}
+}
+
+/* mark pos->cur as removed and try to unlink it */
+static int Delete(lf_handle_t *handle, position_t *pos)
+{
+	lf_node_t *cur = pos->cur;
+	uintptr_t next = pos->next;
+	uintptr_t expected = (uintptr_t)cur;
+	target_t target = {0};
+
+	if(!atomic_compare_exchange_strong(&cur->next, &next, next | MARK))
+	{
+		/* cur was changed or removed by another thread */
+		return (FAILURE);
+	}
+
+	atomic_fetch_sub(&handle->list->size, 1);
+
+	if(atomic_compare_exchange_strong(pos->prev, &expected, next))
+	{
+		Retire(handle, cur);
+	}
+	else
+	{
+		/* let a search unlink it */
+		target.mode = BY_SEQ;
+		target.key = cur->key;
+		target.seq = cur->seq;
+		Search(handle, &target, pos);
+	}
+
+	return (SUCCESS);
+}
+
+lf_list_t *LFListCreate(void)
+{
+	lf_list_t *list = NULL;
+	size_t i = 0;
+
+	list = (lf_list_t *)malloc(sizeof(lf_list_t));
+	if(NULL == list)
+	{
+		return (NULL);
+	}
+
+	atomic_init(&list->head, (uintptr_t)0);
+	atomic_init(&list->seq, 0);
+	atomic_init(&list->size, 0);
+
+	for(i = 0; i < LFLIST_MAX_THREADS; ++i)
+	{
+		atomic_init(&list->handles[i].hazards[HP_PREV], (uintptr_t)0);
+		atomic_init(&list->handles[i].hazards[HP_CUR], (uintptr_t)0);
+		atomic_init(&list->handles[i].in_use, FALSE);
+		list->handles[i].list = list;
+		list->handles[i].n_retired = 0;
+	}
+
+	return (list);
+}
+
+void LFListDestroy(lf_list_t *list)
+{
+	lf_node_t *runner = NULL;
+	lf_node_t *node_to_free = NULL;
+	size_t i = 0;
+	size_t j = 0;
+
+	assert(NULL != list);
+
+	/* linked nodes and retired nodes are disjoint */
+	runner = ToNode(atomic_load(&list->head));
+	while(NULL != runner)
+	{
+		node_to_free = runner;
+		runner = ToNode(atomic_load(&runner->next));
+		free(node_to_free);
+	}
+
+	for(i = 0; i < LFLIST_MAX_THREADS; ++i)
+	{
+		for(j = 0; j < list->handles[i].n_retired; ++j)
+		{
+			free(list->handles[i].retired[j]);
+		}
+	}
+
+	free(list);
+}
+
+lf_handle_t *LFListAttach(lf_list_t *list)
+{
+	size_t i = 0;
+	int expected = FALSE;
+
+	assert(NULL != list);
+
+	for(i = 0; i < LFLIST_MAX_THREADS; ++i)
+	{
+		expected = FALSE;
+		if(atomic_compare_exchange_strong(&list->handles[i].in_use, &expected, TRUE))
+		{
+			return (&list->handles[i]);
+		}
+	}
+
+	return (NULL);
+}
+
+void LFListDetach(lf_handle_t *handle)
+{
+	assert(NULL != handle);
+
+	ClearHazards(handle);
+
+	if(0 != handle->n_retired)
+	{
+		Scan(handle);
+	}
+
+	atomic_store(&handle->in_use, FALSE);
+}
+
+int LFListInsert(lf_handle_t *handle, lflist_key_t key, void *data)
+{
+	lf_node_t *node = NULL;
+	target_t target = {0};
+	position_t pos = {0};
+	uintptr_t expected = 0;
+
+	assert(NULL != handle);
+
+	node = (lf_node_t *)malloc(sizeof(lf_node_t));
+	if(NULL == node)
+	{
+		return (FAILURE);
+	}
+
+	node->key = key;
+	node->seq = atomic_fetch_add(&handle->list->seq, 1);
+	node->data = data;
+
+	target.mode = BY_SEQ;
+	target.key = key;
+	target.seq = node->seq;
+
+	do
+	{
+		Search(handle, &target, &pos);
+
+		atomic_init(&node->next, (uintptr_t)pos.cur);
+		expected = (uintptr_t)pos.cur;
+	}
+	while(!atomic_compare_exchange_strong(pos.prev, &expected, (uintptr_t)node));
+
+	atomic_fetch_add(&handle->list->size, 1);
+	ClearHazards(handle);
+
+	return (SUCCESS);
+}
+
+int LFListRemove(lf_handle_t *handle, lflist_key_t key, void *data)
+{
+	target_t target = {0};
+	position_t pos = {0};
+	int status = FAILURE;
+
+	assert(NULL != handle);
+
+	target.mode = BY_DATA;
+	target.key = key;
+	target.data = data;
+
+	while(Search(handle, &target, &pos))
+	{
+		if(SUCCESS == Delete(handle, &pos))
+		{
+			status = SUCCESS;
+			break;
+		}
+	}
+
+	ClearHazards(handle);
+
+	return (status);
+}
+
+void *LFListFind(lf_handle_t *handle, lflist_key_t key)
+{
+	target_t target = {0};
+	position_t pos = {0};
+	void *data = NULL;
+
+	assert(NULL != handle);
+
+	target.mode = BY_KEY;
+	target.key = key;
+
+	if(Search(handle, &target, &pos))
+	{
+		data = pos.cur->data;
+	}
+
+	ClearHazards(handle);
+
+	return (data);
+}
+
+void *LFListPopFront(lf_handle_t *handle, lflist_key_t *key)
+{
+	target_t target = {0};
+	position_t pos = {0};
+	void *data = NULL;
+
+	assert(NULL != handle);
+
+	target.mode = FIRST;
+
+	while(Search(handle, &target, &pos))
+	{
+		/* read the node before it can be retired */
+		data = pos.cur->data;
+		if(NULL != key)
+		{
+			*key = pos.cur->key;
+		}
+
+		if(SUCCESS == Delete(handle, &pos))
+		{
+			break;
+		}
+
+		data = NULL;
+	}
+
+	ClearHazards(handle);
+
+	return (data);
+}
+
+size_t LFListSize(const lf_list_t *list)
+{
+	assert(NULL != list);
+
+	return (atomic_load(&((lf_list_t *)list)->size));
+}
+
+int LFListIsEmpty(const lf_list_t *list)
+{
+	assert(NULL != list);
+
+	return (0 == LFListSize(list));
+}
@@ -0,0 +1,84 @@
+#define _GNU_SOURCE     /* syscall */
+#include <sys/types.h>  /* pid_t */
+#include <sys/wait.h>   /* waitpid */
+#include <sys/syscall.h> /* SYS_pidfd_open */
+#include <unistd.h>     /* syscall, close */
+#include <poll.h>       /* poll */
+#include <stdio.h>      /* fopen, sscanf */
+#include <errno.h>      /* errno */
+
+#include "pidwatch.h"
+
+#define FDINFO_PATH_SIZE (64)
+#define FDINFO_LINE_SIZE (128)
+
+int PidWatchOpen(pid_t pid)
+{
+#ifdef SYS_pidfd_open
+    return ((int)syscall(SYS_pidfd_open, pid, 0));
+#else
+    (void)pid;
+    errno = ENOSYS;
+
+    return (-1);
+#endif
+}
+
+int PidWatchWait(int pidfd, pid_t pid, int timeout_ms)
+{
+    struct pollfd pfd = {0};
+    int status = 0;
+
+    pfd.fd = pidfd;
+    pfd.events = POLLIN;
+
+    do
+    {
+        status = poll(&pfd, 1, timeout_ms);
+    }
+    while (-1 == status && EINTR == errno);
+
+    if (1 != status)
+    {
+        return (status);
+    }
+
+    /* does nothing (ECHILD) if pid is not our child */
+    waitpid(pid, NULL, WNOHANG);
+
+    return (1);
+}
+
+pid_t PidWatchGetPid(int pidfd)
+{
+    char path[FDINFO_PATH_SIZE] = {'\0'};
+    char line[FDINFO_LINE_SIZE] = {'\0'};
+    FILE *fdinfo = NULL;
+    int pid = 0;
+
+    sprintf(path, "/proc/self/fdinfo/%d", pidfd);
+
+    fdinfo = fopen(path, "r");
+    if (NULL == fdinfo)
+    {
+        return (0);
+    }
+
+    /* only a pidfd has a "Pid:" line */
+    while (NULL != fgets(line, sizeof(line), fdinfo))
+    {
+        if (1 == sscanf(line, "Pid: %d", &pid))
+        {
+            break;
+        }
+    }
+
+    fclose(fdinfo);
+
+    return (0 < pid ? (pid_t)pid : 0);
+}
+
+void PidWatchClose(int pidfd)
+{
+    close(pidfd);
+}
@@ -116,6 +116,38 @@ void *PQErase(pq_t *pq, int (*is_match)(const void *, const void *), void *param
 	return (data_of_item_to_erase);
 }
 
+size_t PQEraseAll(pq_t *pq, int (*is_match)(const void *, const void *), void *param,
+				  void (*erase_data)(void *))
+{
+	sort_iter_t iter = {0};
+	void *data = NULL;
+	size_t n_erased = 0;
+	
+	assert(pq);
+	assert(is_match);
+	
+	iter = SortListBegin(pq->pqueue);
+	while(!SortListIsEqual(iter, SortListEnd(pq->pqueue)))
+	{
+		data = SortListGetData(iter);
+		if(!is_match(data, param))
+		{
+			iter = SortListNext(iter);
+			continue;
+		}
+		
+		iter = SortListRemove(iter);
+		++n_erased;
+		
+		if(NULL != erase_data)
+		{
+			erase_data(data);
+		}
+	}
+	
+	return (n_erased);
+}
+
 int PQEnqueue(pq_t *pq, void *data)
 {
 	sort_iter_t insert_result = {0};
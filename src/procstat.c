@@ -0,0 +1,216 @@
+#define _GNU_SOURCE            /* syscall */
+#include <sys/syscall.h> /* SYS_gettid */
+#include <unistd.h>    /* sysconf, syscall */
+#include <stdio.h>     /* fopen, sprintf */
+#include <string.h>    /* strrchr, strchr, strcmp */
+#include <stdlib.h>    /* atoi */
+#include <dirent.h>    /* opendir */
+#include <assert.h>    /* assert */
+
+#include "procstat.h"
+
+#define PATH_SIZE (64)
+#define LINE_SIZE (1024)
+
+int ProcStatRead(pid_t pid, pid_t tid, proc_stat_t *stat)
+{
+    char path[PATH_SIZE] = {'\0'};
+    char line[LINE_SIZE] = {'\0'};
+    char *fields = NULL;
+    unsigned long utime = 0;
+    unsigned long stime = 0;
+    long ticks_per_sec = sysconf(_SC_CLK_TCK);
+    FILE *file = NULL;
+
+    assert(stat);
+
+    if (0 == tid)
+    {
+        sprintf(path, "/proc/%d/stat", (int)pid);
+    }
+    else
+    {
+        sprintf(path, "/proc/%d/task/%d/stat", (int)pid, (int)tid);
+    }
+
+    file = fopen(path, "r");
+    if (NULL == file)
+    {
+        return (-1);
+    }
+
+    fields = fgets(line, LINE_SIZE, file);
+    fclose(file);
+
+    /* the command name in parentheses may contain spaces */
+    if (NULL == fields || NULL == (fields = strrchr(line, ')')))
+    {
+        return (-1);
+    }
+
+    /* state ppid pgrp session tty_nr tpgid flags minflt cminflt majflt cmajflt utime stime */
+    if (3 != sscanf(fields + 1, " %c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+                    &stat->state, &utime, &stime))
+    {
+        return (-1);
+    }
+
+    stat->utime_ms = utime * 1000 / ticks_per_sec;
+    stat->stime_ms = stime * 1000 / ticks_per_sec;
+
+    return (0);
+}
+
+static long CountEntries(const char *path)
+{
+    struct dirent *entry = NULL;
+    long n_entries = 0;
+    DIR *dir = opendir(path);
+
+    if (NULL == dir)
+    {
+        return (-1);
+    }
+
+    while (NULL != (entry = readdir(dir)))
+    {
+        n_entries += ('.' != entry->d_name[0]);
+    }
+
+    closedir(dir);
+
+    return (n_entries);
+}
+
+int ProcStatReadUsage(pid_t pid, proc_usage_t *usage)
+{
+    char path[PATH_SIZE] = {'\0'};
+    char line[LINE_SIZE] = {'\0'};
+    char *fields = NULL;
+    unsigned long rss_pages = 0;
+    long n_fds = 0;
+    FILE *file = NULL;
+
+    assert(usage);
+
+    /* size resident ... in pages */
+    sprintf(path, "/proc/%d/statm", (int)pid);
+    file = fopen(path, "r");
+    if (NULL == file)
+    {
+        return (-1);
+    }
+    if (1 != fscanf(file, "%*u %lu", &rss_pages))
+    {
+        fclose(file);
+        return (-1);
+    }
+    fclose(file);
+
+    sprintf(path, "/proc/%d/stat", (int)pid);
+    file = fopen(path, "r");
+    if (NULL == file)
+    {
+        return (-1);
+    }
+    fields = fgets(line, LINE_SIZE, file);
+    fclose(file);
+
+    if (NULL == fields || NULL == (fields = strrchr(line, ')')))
+    {
+        return (-1);
+    }
+
+    /* num_threads is the 18th field after the command name */
+    if (1 != sscanf(fields + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %*u %*u "
+                    "%*d %*d %*d %*d %lu", &usage->n_threads))
+    {
+        return (-1);
+    }
+
+    sprintf(path, "/proc/%d/fd", (int)pid);
+    n_fds = CountEntries(path);
+    if (-1 == n_fds)
+    {
+        return (-1);
+    }
+
+    usage->rss_kb = rss_pages * (unsigned long)(sysconf(_SC_PAGESIZE) / 1024);
+    usage->n_fds = (unsigned long)n_fds;
+
+    return (0);
+}
+
+size_t ProcStatListThreads(pid_t pid, pid_t *tids, size_t max_tids)
+{
+    char path[PATH_SIZE] = {'\0'};
+    struct dirent *entry = NULL;
+    size_t n_tids = 0;
+    DIR *dir = NULL;
+
+    assert(tids);
+
+    sprintf(path, "/proc/%d/task", (int)pid);
+
+    dir = opendir(path);
+    if (NULL == dir)
+    {
+        return (0);
+    }
+
+    while (n_tids < max_tids && NULL != (entry = readdir(dir)))
+    {
+        /* skip . and .. */
+        if ('.' != entry->d_name[0])
+        {
+            tids[n_tids++] = (pid_t)atoi(entry->d_name);
+        }
+    }
+
+    closedir(dir);
+
+    return (n_tids);
+}
+
+int ProcStatReadWchan(pid_t pid, pid_t tid, char *wchan, size_t size)
+{
+    char path[PATH_SIZE] = {'\0'};
+    FILE *file = NULL;
+    char *end = NULL;
+
+    assert(wchan);
+    assert(0 < size);
+
+    sprintf(path, "/proc/%d/task/%d/wchan", (int)pid, (int)tid);
+
+    file = fopen(path, "r");
+    if (NULL == file)
+    {
+        return (-1);
+    }
+
+    if (NULL == fgets(wchan, (int)size, file))
+    {
+        wchan[0] = '\0';
+    }
+    fclose(file);
+
+    end = strchr(wchan, '\n');
+    if (NULL != end)
+    {
+        *end = '\0';
+    }
+
+    /* "0" for a running thread, or a name hidden from us */
+    if (0 == strcmp(wchan, "0"))
+    {
+        wchan[0] = '\0';
+    }
+
+    return (0);
+}
+
+pid_t ProcStatGetTid(void)
+{
+    return ((pid_t)syscall(SYS_gettid));
+}
@@ -0,0 +1,129 @@
+#include <assert.h> /* assert */
+
+#include "restartpolicy.h"
+
+void RestartPolicySetDefaults(restart_policy_t *policy)
+{
+    assert(policy);
+
+    if (0 == policy->window_ms)
+    {
+        policy->window_ms = RESTART_DEFAULT_WINDOW_MS;
+    }
+    if (0 == policy->max_crashes)
+    {
+        policy->max_crashes = RESTART_DEFAULT_MAX_CRASHES;
+    }
+    if (RESTART_HISTORY < policy->max_crashes)
+    {
+        policy->max_crashes = RESTART_HISTORY;
+    }
+    if (0 == policy->base_delay_ms)
+    {
+        policy->base_delay_ms = RESTART_DEFAULT_BASE_DELAY_MS;
+    }
+    if (0 == policy->max_delay_ms)
+    {
+        policy->max_delay_ms = RESTART_DEFAULT_MAX_DELAY_MS;
+    }
+    if (0 == policy->cool_down_ms)
+    {
+        policy->cool_down_ms = RESTART_DEFAULT_COOL_DOWN_MS;
+    }
+}
+
+static long Backoff(const restart_policy_t *policy, size_t consecutive)
+{
+    size_t delay = policy->base_delay_ms;
+    size_t i = 0;
+
+    /* no delay for the first crash after a stable run */
+    if (1 >= consecutive)
+    {
+        return (0);
+    }
+
+    for (i = 2; i < consecutive && delay < policy->max_delay_ms; ++i)
+    {
+        delay *= 2;
+    }
+
+    return ((long)(delay < policy->max_delay_ms ? delay : policy->max_delay_ms));
+}
+
+static int IsWindowFull(const restart_policy_t *policy, const restart_state_t *state,
+                        long now_ms)
+{
+    size_t oldest = 0;
+
+    if (state->n_recent < policy->max_crashes)
+    {
+        return (0);
+    }
+
+    /* the max_crashes-th latest crash is within the window */
+    oldest = (state->head + RESTART_HISTORY - policy->max_crashes) % RESTART_HISTORY;
+
+    return (now_ms - state->crash_times[oldest] < (long)policy->window_ms);
+}
+
+int RestartPolicyIsStable(const restart_policy_t *policy, const restart_state_t *state,
+                          long now_ms)
+{
+    assert(policy);
+    assert(state);
+
+    return (0 != state->consecutive &&
+            now_ms - state->last_restart_ms >= (long)policy->window_ms);
+}
+
+void RestartPolicyOnStable(restart_state_t *state)
+{
+    assert(state);
+
+    state->consecutive = 0;
+    state->is_open = 0;
+}
+
+long RestartPolicyOnCrash(const restart_policy_t *policy, restart_state_t *state,
+                          long now_ms)
+{
+    assert(policy);
+    assert(state);
+
+    if (RestartPolicyIsStable(policy, state, now_ms))
+    {
+        /* the last run was stable */
+        RestartPolicyOnStable(state);
+    }
+
+    ++state->total_crashes;
+    ++state->consecutive;
+
+    state->crash_times[state->head] = now_ms;
+    state->head = (state->head + 1) % RESTART_HISTORY;
+    if (RESTART_HISTORY > state->n_recent)
+    {
+        ++state->n_recent;
+    }
+
+    /* a failed trial keeps the breaker open */
+    if (state->is_open || IsWindowFull(policy, state, now_ms))
+    {
+        state->is_open = 1;
+        state->next_restart_ms = now_ms + (long)policy->cool_down_ms;
+    }
+    else
+    {
+        state->next_restart_ms = now_ms + Backoff(policy, state->consecutive);
+    }
+
+    return (state->next_restart_ms);
+}
+
+void RestartPolicyOnRestart(restart_state_t *state, long now_ms)
+{
+    assert(state);
+
+    state->last_restart_ms = now_ms;
+}
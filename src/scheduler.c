@@ -1,45 +1,66 @@
 #include <assert.h> /* assert */
 #include <stdlib.h> /* malloc, free */
 #include <string.h> /* strcpy */
-#include <unistd.h> /* sleep */
+#include <time.h> /* nanosleep */
+#include <signal.h> /* sig_atomic_t */
 
 #include <scheduler.h>
+#include "hashmap.h"
 
 struct Scheduler
 {
 	pq_t *pq;
+	hash_map_t *tasks; /* every task that was not removed, by UID */
 	task_t *current_task;
-	int is_stopped;
+	volatile sig_atomic_t is_stopped; /* may be set by a signal handler */
 	int to_remove;
+	size_t n_cancelled; /* removed tasks that still wait in the queue */
 };
 
 size_t SchedulerSize(const scheduler_t *scheduler)
 {
 	assert(scheduler);
 	
-	if(NULL != scheduler->current_task)
-	{
-		return (PQSize(scheduler->pq) + 1);
-	}
-	
-	return (PQSize(scheduler->pq));
+	return (HashMapSize(scheduler->tasks));
 }
 
 int SchedulerIsEmpty(const scheduler_t *scheduler)
 {
 	assert(scheduler);
 	
-	if(NULL == scheduler->current_task && PQIsEmpty(scheduler->pq))
-	{
-		return (TRUE);
-	}
+	return (HashMapIsEmpty(scheduler->tasks));
+}
+
+int SchedulerHasTask(const scheduler_t *scheduler, ilrd_uid_t uid)
+{
+	assert(scheduler);
 	
-	return (FALSE);
+	return (NULL != HashMapFind(scheduler->tasks, uid));
 }
 
 static int CompareTime(const void *task1, const void *task2)
 {
-	return (((task_t*)task2)->time_to_run - ((task_t*)task1)->time_to_run);
+	time_t time1 = ((task_t*)task1)->time_to_run;
+	time_t time2 = ((task_t*)task2)->time_to_run;
+	
+	return ((time2 > time1) - (time2 < time1));
+}
+
+static void SleepUntil(scheduler_t *scheduler, time_t time_to_run)
+{
+	struct timespec remaining = {0};
+	time_t now = TaskTimeNow();
+	
+	/* a signal that stops the scheduler cuts the sleep short */
+	while(now < time_to_run && !scheduler->is_stopped)
+	{
+		remaining.tv_sec = (time_to_run - now) / 1000;
+		remaining.tv_nsec = ((time_to_run - now) % 1000) * 1000000;
+		
+		nanosleep(&remaining, NULL);
+		
+		now = TaskTimeNow();
+	}
 }
 
 scheduler_t *SchedulerCreate(void)
@@ -58,8 +79,18 @@ scheduler_t *SchedulerCreate(void)
 		return (NULL);
 	}
 	
+	scheduler->tasks = HashMapCreate(0);
+	if(NULL == scheduler->tasks)
+	{
+		PQDestroy(scheduler->pq);
+		free(scheduler);
+		
+		return (NULL);
+	}
+	
 	scheduler->is_stopped = 0;
 	scheduler->to_remove = 0;
+	scheduler->n_cancelled = 0;
 	scheduler->current_task = NULL;
 	
 	return (scheduler);
@@ -71,11 +102,21 @@ void SchedulerClear(scheduler_t *scheduler)
 	
 	assert(scheduler);
 	
-	while (!SchedulerIsEmpty(scheduler))
+	/* cancelled tasks are still in the queue, so empty it rather than the map */
+	while (!PQIsEmpty(scheduler->pq))
 	{
 		task_to_remove = PQDequeue(scheduler->pq);
 		TaskDestroy(task_to_remove);
 	}
+	
+	HashMapClear(scheduler->tasks);
+	scheduler->n_cancelled = 0;
+	
+	/* the running task is destroyed when it returns */
+	if(NULL != scheduler->current_task)
+	{
+		scheduler->to_remove = 1;
+	}
 }
 
 void SchedulerDestroy(scheduler_t *scheduler)
@@ -85,47 +126,71 @@ void SchedulerDestroy(scheduler_t *scheduler)
 	SchedulerClear(scheduler);
 	
 	PQDestroy(scheduler->pq);
+	HashMapDestroy(scheduler->tasks);
 	free(scheduler);
 }
 
-static int IsMatch(const void *task1, const void *uid)
-{	
-	uid_t uid1 = TaskGetUID((task_t*)task1);
-	uid_t uid2 = *(uid_t*)uid;
-	 
-	return (UIDIsSame(uid1, uid2)); 
+static int IsCancelled(const void *task, const void *param)
+{
+	(void)param;
+	
+	return (TaskIsCancelled((const task_t *)task));
+}
+
+static void DestroyTask(void *task)
+{
+	TaskDestroy((task_t *)task);
 }
 
-int SchedulerRemoveTask(scheduler_t *scheduler, uid_t uid)
+int SchedulerRemoveTask(scheduler_t *scheduler, ilrd_uid_t uid)
 {
-	void *item_to_erase = NULL;
+	task_t *task_to_remove = NULL;
 	
 	assert(scheduler);
 	
+	task_to_remove = HashMapRemove(scheduler->tasks, uid);
+	if(NULL == task_to_remove)
+	{
+		return (ERROR);
+	}
+	
 	/* check if task tries to destroy itself */
-	if(NULL != scheduler->current_task && IsMatch(scheduler->current_task, &uid))
+	if(task_to_remove == scheduler->current_task)
 	{
 		scheduler->to_remove = 1;
 		
 		return (SUCCESS);
 	}
 	
-	/* find task in queue */
-	item_to_erase = PQErase(scheduler->pq, IsMatch, &uid);
-	if(NULL == item_to_erase)
+	/* the task is destroyed when it reaches the front of the queue */
+	TaskCancel(task_to_remove);
+	++scheduler->n_cancelled;
+	
+	/* unless far-off removed tasks make up more than half the queue */
+	if(scheduler->n_cancelled > HashMapSize(scheduler->tasks))
 	{
-		return (ERROR);
+		PQEraseAll(scheduler->pq, &IsCancelled, NULL, &DestroyTask);
+		scheduler->n_cancelled = 0;
 	}
 	
-	TaskDestroy(item_to_erase); 
-	
 	return (SUCCESS); 
+}
 
-uid_t SchedulerAddTask(scheduler_t *scheduler, int (*op_func)(void *), 
+ilrd_uid_t SchedulerAddTask(scheduler_t *scheduler, int (*op_func)(void *), 
 					   		void *op_param, size_t delay_in_sec, 
 					 		size_t interval_in_sec, void (*task_cleanup)(void *), 
 					  		void *cleanup_param)
 					  		
+{
+	return (SchedulerAddTaskMs(scheduler, op_func, op_param, delay_in_sec * 1000, 
+							   interval_in_sec * 1000, task_cleanup, cleanup_param));
+}
+
+ilrd_uid_t SchedulerAddTaskMs(scheduler_t *scheduler, int (*op_func)(void *), 
+					   	 void *op_param, size_t delay_in_ms, 
+					 	 size_t interval_in_ms, void (*task_cleanup)(void *), 
+					  	 void *cleanup_param)
+					  		
 {
 	task_t *task = NULL;
 	
@@ -133,15 +198,23 @@ uid_t SchedulerAddTask(scheduler_t *scheduler, int (*op_func)(void *),
 	assert(op_func);
 	
 	/* create task and add it to queue */
-	task = TaskCreate(op_func, op_param, delay_in_sec, interval_in_sec, task_cleanup, 
-		              cleanup_param);
+	task = TaskCreateMs(op_func, op_param, delay_in_ms, interval_in_ms, task_cleanup, 
+		                cleanup_param);
 	if(NULL == task)
 	{
 		return (UIDBadUID);
 	}	
 	
+	if(0 != HashMapInsert(scheduler->tasks, TaskGetUID(task), task))
+	{
+		TaskDestroy(task);
+		
+		return (UIDBadUID);
+	}
+	
 	if(0 != PQEnqueue(scheduler->pq, task))
 	{
+		HashMapRemove(scheduler->tasks, TaskGetUID(task));
 		TaskDestroy(task);
 		
 		return (UIDBadUID);
@@ -157,9 +230,83 @@ void SchedulerStop(scheduler_t *scheduler)
 	scheduler->is_stopped = 1;
 }
 
-int SchedulerRun(scheduler_t *scheduler)
+/* run the dequeued current task, and queue it again unless it is done */
+static int RunCurrentTask(scheduler_t *scheduler)
 {
 	int task_status = 0;
+	int enqueue_status = SUCCESS;
+	
+	task_status = TaskRun(scheduler->current_task);
+	if(DO_NOT_REPEAT == task_status || scheduler->to_remove)
+	{
+		if(!scheduler->to_remove)
+		{
+			HashMapRemove(scheduler->tasks, TaskGetUID(scheduler->current_task));
+		}
+		
+		TaskDestroy(scheduler->current_task);
+	}
+	else
+	{
+		TaskUpdateTimeToRun(scheduler->current_task);
+		
+		enqueue_status = PQEnqueue(scheduler->pq, scheduler->current_task);
+	}
+	
+	scheduler->current_task = NULL;
+	
+	return (SUCCESS == enqueue_status ? SUCCESS : ERROR);
+}
+
+/* destroy the cancelled tasks at the front of the queue */
+static void DropCancelled(scheduler_t *scheduler)
+{
+	while(!PQIsEmpty(scheduler->pq) && TaskIsCancelled(PQPeek(scheduler->pq)))
+	{
+		TaskDestroy(PQDequeue(scheduler->pq));
+		--scheduler->n_cancelled;
+	}
+}
+
+int SchedulerRunDue(scheduler_t *scheduler)
+{
+	assert(scheduler);
+	
+	DropCancelled(scheduler);
+	
+	while(!PQIsEmpty(scheduler->pq) && 
+	      TaskGetTimeToRun(PQPeek(scheduler->pq)) <= TaskTimeNow())
+	{
+		scheduler->to_remove = 0;
+		scheduler->current_task = PQDequeue(scheduler->pq);
+		
+		if(SUCCESS != RunCurrentTask(scheduler))
+		{
+			return (ERROR);
+		}
+		
+		DropCancelled(scheduler);
+	}
+	
+	return (SUCCESS);
+}
+
+time_t SchedulerGetNextTime(scheduler_t *scheduler)
+{
+	assert(scheduler);
+	
+	DropCancelled(scheduler);
+	
+	if(PQIsEmpty(scheduler->pq))
+	{
+		return (-1);
+	}
+	
+	return (TaskGetTimeToRun(PQPeek(scheduler->pq)));
+}
+
+int SchedulerRun(scheduler_t *scheduler)
+{
 	int enqueue_status = 0;
 		
 	assert(scheduler);
@@ -175,28 +322,35 @@ int SchedulerRun(scheduler_t *scheduler)
 		
 		scheduler->current_task = PQDequeue(scheduler->pq);
 		
-		if(time(0) < TaskGetTimeToRun(scheduler->current_task))
-		{
-			while(0 != sleep(TaskGetTimeToRun(scheduler->current_task) - time(0)));
-		}
-		
-		task_status = TaskRun(scheduler->current_task);
-		if(DO_NOT_REPEAT == task_status || scheduler->to_remove)
+		if(TaskIsCancelled(scheduler->current_task))
 		{
 			TaskDestroy(scheduler->current_task);
-		}
-		else
-		{
-			TaskUpdateTimeToRun(scheduler->current_task);
+			scheduler->current_task = NULL;
+			--scheduler->n_cancelled;
 			
-			enqueue_status = PQEnqueue(scheduler->pq, scheduler->current_task);
-			if(SUCCESS != enqueue_status)
+			if(SchedulerIsEmpty(scheduler))
 			{
-				return (ERROR);
+				return (SUCCESS);
 			}
+			
+			continue;
+		}
+		
+		SleepUntil(scheduler, TaskGetTimeToRun(scheduler->current_task));
+		
+		if(scheduler->is_stopped)
+		{
+			/* stopped while waiting. the task keeps its time to run. */
+			enqueue_status = PQEnqueue(scheduler->pq, scheduler->current_task);
+			scheduler->current_task = NULL;
+			
+			return (SUCCESS == enqueue_status ? STOPPED : ERROR);
 		}
 		
-		scheduler->current_task = NULL;
+		if(SUCCESS != RunCurrentTask(scheduler))
+		{
+			return (ERROR);
+		}
 		
 		if(SchedulerIsEmpty(scheduler))
 		{
@@ -190,6 +190,18 @@ int SortListForEach(sort_iter_t from, sort_iter_t to, action_t action, void *act
 	return (DListForEach(dlist_from, dlist_to, action, action_param));
 }
 
+int SortListParallelForEach(sort_iter_t from, sort_iter_t to, action_t action, void *action_param)
+{
+	assert(NULL != action);
+	assert(NULL != from.list);
+	assert(NULL != to.list);
+	#ifndef NDEBUG
+	assert(from.list == to.list);
+	#endif /* NDEBUG */
+	
+	return (DListParallelForEach(GetDListIter(from), GetDListIter(to), action, action_param));
+}
+
 static dlist_iter_t FindFunc(dlist_iter_t from, dlist_iter_t to, compare_t compare, void *param)
 {
 	dlist_iter_t runner = from;
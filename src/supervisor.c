@@ -0,0 +1,1340 @@
+#define _GNU_SOURCE           /* flock, memfd_create, SO_PEERCRED */
+#include <sys/types.h>        /* pid_t */
+#include <sys/mman.h>         /* shm_open, memfd_create */
+#include <sys/stat.h>         /* modes */
+#include <sys/file.h>         /* flock */
+#include <sys/epoll.h>        /* epoll_create1 */
+#include <sys/timerfd.h>      /* timerfd_create */
+#include <sys/socket.h>       /* socket, SCM_RIGHTS */
+#include <sys/un.h>           /* sockaddr_un */
+#include <sys/time.h>         /* timeval */
+#include <sys/resource.h>     /* setrlimit */
+#include <stddef.h>           /* offsetof */
+#include <fcntl.h>            /* O constants */
+#include <unistd.h>           /* read, close */
+#include <signal.h>           /* sigaction, kill */
+#include <spawn.h>            /* posix_spawn */
+#include <stdint.h>           /* uint64_t */
+#include <stdlib.h>           /* calloc, setenv */
+#include <string.h>           /* strlen, strcpy */
+#include <stdio.h>            /* perror, sprintf */
+#include <errno.h>            /* errno */
+#include <assert.h>           /* assert */
+
+#include "supervisor.h"
+#include "timerwheel.h"
+#include "pidwatch.h"
+#include "wdshm.h"
+
+#define TICK_EVENT (WD_SUPERVISOR_MAX_CLIENTS)
+#define LISTEN_EVENT (WD_SUPERVISOR_MAX_CLIENTS + 1)
+#define CONN_EVENT (2 * WD_SUPERVISOR_MAX_CLIENTS) /* + slot */
+#define PENDING_EVENT (3 * WD_SUPERVISOR_MAX_CLIENTS) /* + pending index */
+#define MAX_PENDING (WD_SUPERVISOR_MAX_CLIENTS)
+#define PENDING_WHEEL_BUCKETS (64)
+#define WHEEL_BUCKETS (1024)
+#define MAX_EVENTS (64)
+#define REVIVE_TIMEOUT_MS (10000)
+#define IDLE_EXIT_MS (5000)
+#define SLOT_STR_SIZE (16)
+#define LISTEN_BACKLOG (512)
+#define REQUEST_TIMEOUT_MS (100)
+#define RELEASE_REQUEST ('R')
+
+extern char **environ;
+
+typedef struct Client
+{
+    pid_t pid;
+    int pidfd;
+    unsigned long last_beat;
+    size_t misses;
+    size_t revive_deadline; /* tick by which a revived client must attach */
+    int is_reviving;
+    int is_queued;
+    int is_tracked;
+    int conn;               /* daemon clients only, -1 otherwise */
+    int given_pidfd;        /* pidfd from a registration, not watched yet */
+    wd_side_t *beat_map;    /* heartbeat of a daemon client */
+} client_t;
+
+/* sent by a client of a daemon, with its pidfd and its heartbeat memfd */
+typedef struct DaemonRequest
+{
+    int slot;               /* -1 for a new client */
+    unsigned long check_interval_ms;
+    unsigned long miss_threshold;
+    char path[WD_SUPERVISOR_PATH_SIZE];
+} daemon_request_t;
+
+/* a connection to a daemon whose request is not read in full yet */
+typedef struct Pending
+{
+    int conn;
+    int fds[2];             /* pidfd, heartbeat memfd, -1 until they come */
+    size_t n_read;
+    struct ucred cred;
+    daemon_request_t request;
+} pending_t;
+
+typedef struct Supervisor
+{
+    wd_registry_t *registry;
+    timer_wheel_t *wheel;
+    timer_wheel_t *pending_wheel; /* daemon only, request deadlines */
+    int epfd;
+    int timerfd;
+    int listen_fd;          /* daemon only */
+    int is_daemon;
+    size_t now;
+    unsigned long generation;
+    size_t n_tracked;
+    size_t idle_ticks;
+    size_t max_revives;
+    size_t n_reviving;
+    size_t queue[WD_SUPERVISOR_MAX_CLIENTS];
+    size_t queue_head;
+    size_t queue_size;
+    size_t next_pending;
+    pending_t *pending[MAX_PENDING];
+    client_t clients[WD_SUPERVISOR_MAX_CLIENTS];
+} supervisor_t;
+
+typedef union RightsBuf
+{
+    struct cmsghdr header;  /* alignment */
+    char buf[CMSG_SPACE(2 * sizeof(int))];
+} rights_buf_t;
+
+static volatile sig_atomic_t stop_flag = 0;
+
+/******************************* registry *******************************/
+
+static void Beat(atomic_ulong *beat)
+{
+    /* single writer, so a plain increment is enough */
+    atomic_store_explicit(beat, atomic_load_explicit(beat, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+}
+
+wd_registry_t *WDRegistryOpen(const char *name)
+{
+    return ((wd_registry_t *)WDShmOpen(name, sizeof(wd_registry_t)));
+}
+
+void WDRegistryClose(wd_registry_t *registry)
+{
+    WDShmClose(registry, sizeof(wd_registry_t));
+}
+
+int WDRegistryClaim(wd_registry_t *registry)
+{
+    int i = 0;
+    int state = WD_SLOT_FREE;
+
+    assert(registry);
+
+    for (i = 0; i < WD_SUPERVISOR_MAX_CLIENTS; ++i)
+    {
+        state = WD_SLOT_FREE;
+        if (atomic_compare_exchange_strong(&registry->slots[i].state, &state,
+                                           WD_SLOT_CLAIMED))
+        {
+            return (i);
+        }
+    }
+
+    return (-1);
+}
+
+static int Activate(wd_registry_t *registry, int slot, pid_t pid, const char *path,
+                    size_t check_interval_ms, size_t miss_threshold)
+{
+    wd_client_slot_t *client = NULL;
+
+    if (WD_SUPERVISOR_PATH_SIZE <= strlen(path))
+    {
+        return (-1);
+    }
+
+    client = &registry->slots[slot];
+    strcpy(client->path, path);
+    client->check_interval_ms = check_interval_ms;
+    client->miss_threshold = miss_threshold;
+    atomic_store(&client->pid, pid);
+
+    /* the fields above are published by the release of the state */
+    atomic_store(&client->state, WD_SLOT_ACTIVE);
+    atomic_fetch_add(&registry->generation, 1);
+
+    return (0);
+}
+
+int WDRegistryActivate(wd_registry_t *registry, int slot, const char *path,
+                       size_t check_interval_ms, size_t miss_threshold)
+{
+    assert(registry);
+    assert(path);
+
+    return (Activate(registry, slot, getpid(), path, check_interval_ms, miss_threshold));
+}
+
+void WDRegistryRelease(wd_registry_t *registry, int slot)
+{
+    assert(registry);
+
+    atomic_store(&registry->slots[slot].pid, 0);
+    atomic_store(&registry->slots[slot].state, WD_SLOT_FREE);
+    atomic_fetch_add(&registry->generation, 1);
+}
+
+void WDRegistryBeat(wd_registry_t *registry, int slot)
+{
+    assert(registry);
+
+    Beat(&registry->slots[slot].client.beat);
+}
+
+unsigned long WDRegistryGetSupervisorBeat(wd_registry_t *registry)
+{
+    assert(registry);
+
+    return (atomic_load_explicit(&registry->supervisor.beat, memory_order_relaxed));
+}
+
+/***************************** daemon client *****************************/
+
+static socklen_t DaemonAddress(const char *name, struct sockaddr_un *addr)
+{
+    size_t length = strlen(name);
+
+    if (WD_DAEMON_NAME_SIZE <= length)
+    {
+        return (0);
+    }
+
+    /* an abstract address: no file to clean up, and it goes with the daemon */
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    memcpy(addr->sun_path + 1, name, length);
+
+    return ((socklen_t)(offsetof(struct sockaddr_un, sun_path) + 1 + length));
+}
+
+static wd_side_t *CreateBeat(int *memfd)
+{
+    void *beat = MAP_FAILED;
+
+    *memfd = memfd_create("wd_beat", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (-1 == *memfd)
+    {
+        return (NULL);
+    }
+
+    /* sealed, so the daemon cannot fault on a file we shrink */
+    if (0 == ftruncate(*memfd, sizeof(wd_side_t)) &&
+        0 == fcntl(*memfd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL))
+    {
+        beat = mmap(NULL, sizeof(wd_side_t), PROT_READ | PROT_WRITE, MAP_SHARED, 
+                    *memfd, 0);
+    }
+
+    if (MAP_FAILED == beat)
+    {
+        close(*memfd);
+        *memfd = -1;
+
+        return (NULL);
+    }
+
+    return ((wd_side_t *)beat);
+}
+
+static int SendRequest(int conn, daemon_request_t *request, int fds[2])
+{
+    rights_buf_t rights;
+    struct msghdr msg = {0};
+    struct iovec iov = {0};
+    struct cmsghdr *cmsg = NULL;
+
+    memset(&rights, 0, sizeof(rights));
+
+    iov.iov_base = request;
+    iov.iov_len = sizeof(*request);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = rights.buf;
+    msg.msg_controllen = sizeof(rights.buf);
+
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(2 * sizeof(int));
+    memcpy(CMSG_DATA(cmsg), fds, 2 * sizeof(int));
+
+    return ((ssize_t)sizeof(*request) == sendmsg(conn, &msg, MSG_NOSIGNAL) ? 0 : -1);
+}
+
+int WDDaemonRegister(const char *name, const char *path, size_t check_interval_ms,
+                     size_t miss_threshold, int slot, wd_side_t **beat)
+{
+    daemon_request_t request;
+    struct sockaddr_un addr;
+    socklen_t addr_size = 0;
+    int fds[2] = {-1, -1}; /* pidfd, heartbeat memfd */
+    int conn = -1;
+    int reply = -1;
+
+    assert(name);
+    assert(path);
+    assert(beat);
+
+    addr_size = DaemonAddress(name, &addr);
+    if (0 == addr_size || WD_SUPERVISOR_PATH_SIZE <= strlen(path))
+    {
+        return (-1);
+    }
+
+    memset(&request, 0, sizeof(request));
+    request.slot = slot;
+    request.check_interval_ms = check_interval_ms;
+    request.miss_threshold = miss_threshold;
+    strcpy(request.path, path);
+
+    *beat = CreateBeat(&fds[1]);
+    fds[0] = PidWatchOpen(getpid());
+    conn = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (NULL != *beat && -1 != fds[0] && -1 != conn &&
+        0 == connect(conn, (struct sockaddr *)&addr, addr_size) &&
+        0 == SendRequest(conn, &request, fds) &&
+        (ssize_t)sizeof(reply) != recv(conn, &reply, sizeof(reply), MSG_WAITALL))
+    {
+        reply = -1;
+    }
+
+    /* the daemon has its own copies */
+    if (-1 != fds[0])
+    {
+        PidWatchClose(fds[0]);
+    }
+    if (-1 != fds[1])
+    {
+        close(fds[1]);
+    }
+
+    if (-1 == reply)
+    {
+        if (-1 != conn)
+        {
+            close(conn);
+        }
+        if (NULL != *beat)
+        {
+            munmap(*beat, sizeof(wd_side_t));
+            *beat = NULL;
+        }
+
+        return (-1);
+    }
+
+    return (conn);
+}
+
+void WDDaemonBeat(wd_side_t *beat)
+{
+    assert(beat);
+
+    Beat(&beat->beat);
+}
+
+void WDDaemonRelease(int conn, wd_side_t *beat)
+{
+    struct timeval timeout = {0};
+    char request = RELEASE_REQUEST;
+
+    assert(beat);
+
+    /* the daemon closes the connection once we are released, so our exit
+       is not taken for a crash */
+    timeout.tv_usec = REQUEST_TIMEOUT_MS * 1000;
+    setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    if (1 == send(conn, &request, 1, MSG_NOSIGNAL))
+    {
+        shutdown(conn, SHUT_WR);
+        while (0 < recv(conn, &request, 1, 0))
+        {
+        }
+    }
+
+    close(conn);
+    munmap(beat, sizeof(wd_side_t));
+}
+
+/****************************** supervisor ******************************/
+
+static void SignalHandler(int sig_num)
+{
+    (void)sig_num;
+    stop_flag = 1;
+}
+
+static unsigned long GetClientBeat(supervisor_t *sup, size_t id)
+{
+    wd_side_t *beat = sup->clients[id].beat_map;
+
+    if (NULL == beat)
+    {
+        beat = &sup->registry->slots[id].client;
+    }
+
+    return (atomic_load_explicit(&beat->beat, memory_order_relaxed));
+}
+
+static size_t CheckTicks(supervisor_t *sup, size_t id)
+{
+    size_t ticks = sup->registry->slots[id].check_interval_ms / WD_SUPERVISOR_TICK_MS;
+
+    return (0 == ticks ? 1 : ticks);
+}
+
+static void UnwatchPid(supervisor_t *sup, size_t id)
+{
+    client_t *client = &sup->clients[id];
+
+    /* closing the pidfd also removes it from the epoll set */
+    if (-1 != client->pidfd)
+    {
+        PidWatchClose(client->pidfd);
+        client->pidfd = -1;
+    }
+}
+
+static void WatchPid(supervisor_t *sup, size_t id, pid_t pid)
+{
+    client_t *client = &sup->clients[id];
+    struct epoll_event event = {0};
+
+    UnwatchPid(sup, id);
+
+    client->pid = pid;
+
+    /* a daemon client gave us its pidfd, which cannot refer to a reused pid */
+    if (-1 != client->given_pidfd && pid == atomic_load(&sup->registry->slots[id].pid))
+    {
+        client->pidfd = client->given_pidfd;
+    }
+    else
+    {
+        if (-1 != client->given_pidfd)
+        {
+            PidWatchClose(client->given_pidfd);
+        }
+
+        client->pidfd = PidWatchOpen(pid);
+    }
+
+    client->given_pidfd = -1;
+
+    /* without a pidfd, a dead client is found by its missed heartbeats */
+    if (-1 == client->pidfd)
+    {
+        return;
+    }
+
+    event.events = EPOLLIN;
+    event.data.u64 = id;
+    epoll_ctl(sup->epfd, EPOLL_CTL_ADD, client->pidfd, &event);
+}
+
+static void CloseConn(supervisor_t *sup, size_t id)
+{
+    client_t *client = &sup->clients[id];
+
+    if (-1 != client->conn)
+    {
+        close(client->conn);
+        client->conn = -1;
+    }
+}
+
+static void DropDaemonClient(supervisor_t *sup, size_t id)
+{
+    client_t *client = &sup->clients[id];
+
+    CloseConn(sup, id);
+
+    if (-1 != client->given_pidfd)
+    {
+        PidWatchClose(client->given_pidfd);
+        client->given_pidfd = -1;
+    }
+    if (NULL != client->beat_map)
+    {
+        munmap(client->beat_map, sizeof(wd_side_t));
+        client->beat_map = NULL;
+    }
+}
+
+static void Track(supervisor_t *sup, size_t id)
+{
+    client_t *client = &sup->clients[id];
+
+    client->is_tracked = 1;
+    client->misses = 0;
+    client->last_beat = GetClientBeat(sup, id);
+    ++sup->n_tracked;
+
+    WatchPid(sup, id, atomic_load(&sup->registry->slots[id].pid));
+    TimerWheelAdd(sup->wheel, id, CheckTicks(sup, id));
+}
+
+static void Untrack(supervisor_t *sup, size_t id)
+{
+    client_t *client = &sup->clients[id];
+
+    UnwatchPid(sup, id);
+    TimerWheelRemove(sup->wheel, id);
+
+    if (client->is_reviving)
+    {
+        client->is_reviving = 0;
+        --sup->n_reviving;
+    }
+
+    /* a queued entry is dropped when it is dequeued */
+    client->is_tracked = 0;
+    --sup->n_tracked;
+
+    DropDaemonClient(sup, id);
+}
+
+static void SyncClients(supervisor_t *sup)
+{
+    unsigned long generation = atomic_load(&sup->registry->generation);
+    client_t *client = NULL;
+    int state = WD_SLOT_FREE;
+    size_t id = 0;
+
+    /* the slots are scanned only when a client attaches or leaves */
+    if (generation == sup->generation)
+    {
+        return;
+    }
+
+    sup->generation = generation;
+
+    for (id = 0; id < WD_SUPERVISOR_MAX_CLIENTS; ++id)
+    {
+        client = &sup->clients[id];
+        state = atomic_load(&sup->registry->slots[id].state);
+
+        if (client->is_tracked && WD_SLOT_FREE == state)
+        {
+            Untrack(sup, id);
+        }
+        else if (!client->is_tracked && WD_SLOT_ACTIVE == state)
+        {
+            Track(sup, id);
+        }
+        else if (client->is_tracked && WD_SLOT_ACTIVE == state &&
+                 client->pid != atomic_load(&sup->registry->slots[id].pid))
+        {
+            WatchPid(sup, id, atomic_load(&sup->registry->slots[id].pid));
+        }
+    }
+}
+
+static void EnqueueRevive(supervisor_t *sup, size_t id)
+{
+    client_t *client = &sup->clients[id];
+    int state = WD_SLOT_ACTIVE;
+
+    /* a client that released its slot is not revived */
+    if (!atomic_compare_exchange_strong(&sup->registry->slots[id].state, &state,
+                                        WD_SLOT_REVIVING) &&
+        WD_SLOT_REVIVING != state)
+    {
+        return;
+    }
+
+    if (!client->is_queued)
+    {
+        client->is_queued = 1;
+        sup->queue[(sup->queue_head + sup->queue_size) % WD_SUPERVISOR_MAX_CLIENTS] = id;
+        ++sup->queue_size;
+    }
+}
+
+static void Revive(supervisor_t *sup, size_t id)
+{
+    client_t *client = &sup->clients[id];
+    char slot_str[SLOT_STR_SIZE] = {'\0'};
+    char *argv[2] = {NULL};
+    pid_t pid = 0;
+    int status = 0;
+
+    argv[0] = sup->registry->slots[id].path;
+
+    /* the supervisor has a single thread, so its environment can be changed */
+    sprintf(slot_str, "%lu", (unsigned long)id);
+    setenv(WD_SUPERVISOR_SLOT_ENV, slot_str, 1);
+    status = posix_spawn(&pid, argv[0], NULL, NULL, argv, environ);
+    unsetenv(WD_SUPERVISOR_SLOT_ENV);
+
+    /* a failed spawn is retried when the revive times out */
+    client->is_reviving = 1;
+    client->revive_deadline = sup->now + REVIVE_TIMEOUT_MS / WD_SUPERVISOR_TICK_MS;
+    ++sup->n_reviving;
+
+    if (0 != status)
+    {
+        errno = status;
+        perror("Failed to revive client");
+        return;
+    }
+
+    WatchPid(sup, id, pid);
+}
+
+static void StartRevives(supervisor_t *sup)
+{
+    size_t id = 0;
+
+    while (sup->n_reviving < sup->max_revives && 0 < sup->queue_size)
+    {
+        id = sup->queue[sup->queue_head];
+        sup->queue_head = (sup->queue_head + 1) % WD_SUPERVISOR_MAX_CLIENTS;
+        --sup->queue_size;
+
+        sup->clients[id].is_queued = 0;
+
+        if (sup->clients[id].is_tracked &&
+            WD_SLOT_REVIVING == atomic_load(&sup->registry->slots[id].state))
+        {
+            Revive(sup, id);
+        }
+    }
+}
+
+static void CheckClient(size_t id, void *param)
+{
+    supervisor_t *sup = (supervisor_t *)param;
+    client_t *client = &sup->clients[id];
+    wd_client_slot_t *slot = &sup->registry->slots[id];
+    unsigned long beat = GetClientBeat(sup, id);
+    int state = atomic_load(&slot->state);
+
+    if (WD_SLOT_FREE == state)
+    {
+        Untrack(sup, id);
+        return;
+    }
+
+    if (WD_SLOT_ACTIVE == state && client->is_reviving)
+    {
+        /* the revived client attached */
+        client->is_reviving = 0;
+        --sup->n_reviving;
+        client->last_beat = beat;
+        client->misses = 0;
+    }
+    else if (WD_SLOT_REVIVING == state)
+    {
+        if (client->is_reviving && sup->now >= client->revive_deadline)
+        {
+            /* it did not attach in time. start over. */
+            kill(client->pid, SIGKILL);
+            UnwatchPid(sup, id);
+            client->is_reviving = 0;
+            --sup->n_reviving;
+            EnqueueRevive(sup, id);
+        }
+    }
+    else if (beat != client->last_beat)
+    {
+        client->last_beat = beat;
+        client->misses = 0;
+    }
+    else if (++client->misses >= slot->miss_threshold)
+    {
+        /* the client hangs. kill it and revive it. */
+        client->misses = 0;
+        kill(client->pid, SIGKILL);
+
+        if (-1 == client->pidfd)
+        {
+            EnqueueRevive(sup, id);
+        }
+    }
+
+    TimerWheelAdd(sup->wheel, id, CheckTicks(sup, id));
+}
+
+static void OnClientExit(supervisor_t *sup, size_t id)
+{
+    client_t *client = &sup->clients[id];
+
+    /* the pidfd was closed earlier in this batch of events */
+    if (-1 == client->pidfd)
+    {
+        return;
+    }
+
+    /* reaps the client if the supervisor revived it */
+    PidWatchWait(client->pidfd, client->pid, 0);
+    UnwatchPid(sup, id);
+
+    if (client->is_reviving)
+    {
+        client->is_reviving = 0;
+        --sup->n_reviving;
+    }
+
+    EnqueueRevive(sup, id);
+}
+
+static wd_side_t *MapBeat(int memfd)
+{
+    struct stat info = {0};
+    int seals = fcntl(memfd, F_GET_SEALS);
+    void *beat = MAP_FAILED;
+
+    /* a client that could shrink the file could crash us with SIGBUS */
+    if (-1 != seals && 0 != (seals & F_SEAL_SHRINK) && 0 != (seals & F_SEAL_SEAL) &&
+        0 == fstat(memfd, &info) && (off_t)sizeof(wd_side_t) <= info.st_size)
+    {
+        beat = mmap(NULL, sizeof(wd_side_t), PROT_READ, MAP_SHARED, memfd, 0);
+    }
+
+    return (MAP_FAILED == beat ? NULL : (wd_side_t *)beat);
+}
+
+static int TakeSlot(supervisor_t *sup, int slot, pid_t pid)
+{
+    /* only the process we revived gets the slot of a dead client */
+    if (0 <= slot && WD_SUPERVISOR_MAX_CLIENTS > slot &&
+        WD_SLOT_REVIVING == atomic_load(&sup->registry->slots[slot].state) &&
+        sup->clients[slot].pid == pid)
+    {
+        return (slot);
+    }
+
+    return (WDRegistryClaim(sup->registry));
+}
+
+static void Register(supervisor_t *sup, pending_t *pending)
+{
+    daemon_request_t *request = &pending->request;
+    struct epoll_event event = {0};
+    client_t *client = NULL;
+    wd_side_t *beat = NULL;
+    int slot = -1;
+
+    request->path[WD_SUPERVISOR_PATH_SIZE - 1] = '\0';
+
+    if (pending->cred.pid == PidWatchGetPid(pending->fds[0]))
+    {
+        beat = MapBeat(pending->fds[1]);
+    }
+
+    if (NULL != beat)
+    {
+        slot = TakeSlot(sup, request->slot, pending->cred.pid);
+    }
+
+    if (-1 == slot)
+    {
+        if (NULL != beat)
+        {
+            munmap(beat, sizeof(wd_side_t));
+        }
+
+        /* the connection and the descriptors are closed with the pending entry */
+        send(pending->conn, &slot, sizeof(slot), MSG_NOSIGNAL);
+
+        return;
+    }
+
+    /* the previous process in a revived slot is gone */
+    DropDaemonClient(sup, slot);
+
+    client = &sup->clients[slot];
+    client->conn = pending->conn;
+    client->beat_map = beat;
+    pending->conn = -1;
+
+    /* we already watch a client that we revived */
+    if (client->is_tracked && client->pid == pending->cred.pid && -1 != client->pidfd)
+    {
+        PidWatchClose(pending->fds[0]);
+    }
+    else
+    {
+        client->given_pidfd = pending->fds[0];
+    }
+    pending->fds[0] = -1;
+
+    /* the path fits, and the slot is tracked on the next tick */
+    Activate(sup->registry, slot, pending->cred.pid, request->path, 
+             request->check_interval_ms,
+             0 == request->miss_threshold ? 1 : request->miss_threshold);
+
+    event.events = EPOLLIN;
+    event.data.u64 = CONN_EVENT + (size_t)slot;
+    epoll_ctl(sup->epfd, EPOLL_CTL_MOD, client->conn, &event);
+
+    send(client->conn, &slot, sizeof(slot), MSG_NOSIGNAL);
+}
+
+/* 1 once the whole request is read, 0 to wait for more, -1 on a bad request */
+static int ReadPending(pending_t *pending)
+{
+    rights_buf_t rights;
+    struct msghdr msg = {0};
+    struct iovec iov = {0};
+    struct cmsghdr *cmsg = NULL;
+    int fds[2] = {-1, -1};
+    ssize_t size = 0;
+    size_t n_fds = 0;
+
+    memset(&rights, 0, sizeof(rights));
+
+    iov.iov_base = (char *)&pending->request + pending->n_read;
+    iov.iov_len = sizeof(pending->request) - pending->n_read;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = rights.buf;
+    msg.msg_controllen = sizeof(rights.buf);
+
+    size = recvmsg(pending->conn, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+    if (-1 == size)
+    {
+        return (EAGAIN == errno || EWOULDBLOCK == errno ? 0 : -1);
+    }
+
+    cmsg = CMSG_FIRSTHDR(&msg);
+    if (NULL != cmsg && SOL_SOCKET == cmsg->cmsg_level && SCM_RIGHTS == cmsg->cmsg_type)
+    {
+        /* the buffer has room for 2, the kernel drops the rest */
+        n_fds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        n_fds = (2 < n_fds ? 2 : n_fds);
+        memcpy(fds, CMSG_DATA(cmsg), n_fds * sizeof(int));
+
+        if (-1 != pending->fds[0] || 2 != n_fds)
+        {
+            for (; 0 < n_fds; --n_fds)
+            {
+                close(fds[n_fds - 1]);
+            }
+
+            return (-1);
+        }
+
+        pending->fds[0] = fds[0];
+        pending->fds[1] = fds[1];
+    }
+
+    if (0 == size)
+    {
+        /* closed before the whole request came */
+        return (-1);
+    }
+
+    pending->n_read += (size_t)size;
+    if (sizeof(pending->request) > pending->n_read)
+    {
+        return (0);
+    }
+
+    /* the descriptors come with the first byte */
+    return (-1 == pending->fds[0] ? -1 : 1);
+}
+
+static void DropPending(supervisor_t *sup, size_t id)
+{
+    pending_t *pending = sup->pending[id];
+
+    /* closing the connection also removes it from the epoll set */
+    if (-1 != pending->conn)
+    {
+        close(pending->conn);
+    }
+    if (-1 != pending->fds[0])
+    {
+        PidWatchClose(pending->fds[0]);
+    }
+    if (-1 != pending->fds[1])
+    {
+        close(pending->fds[1]);
+    }
+
+    TimerWheelRemove(sup->pending_wheel, id);
+    free(pending);
+    sup->pending[id] = NULL;
+}
+
+static void OnPendingEvent(supervisor_t *sup, size_t id)
+{
+    int status = 0;
+
+    /* the entry was dropped earlier in this batch of events */
+    if (NULL == sup->pending[id])
+    {
+        return;
+    }
+
+    status = ReadPending(sup->pending[id]);
+    if (0 == status)
+    {
+        return;
+    }
+
+    if (1 == status)
+    {
+        Register(sup, sup->pending[id]);
+    }
+
+    DropPending(sup, id);
+}
+
+static void ExpirePending(size_t id, void *param)
+{
+    /* it connected, but did not send its request in time */
+    DropPending((supervisor_t *)param, id);
+}
+
+static void AddPending(supervisor_t *sup, int conn)
+{
+    struct ucred cred = {0};
+    socklen_t cred_size = sizeof(cred);
+    struct epoll_event event = {0};
+    pending_t *pending = NULL;
+    size_t id = sup->next_pending;
+    size_t i = 0;
+
+    /* an abstract socket has no file permissions, and we run the path a client
+       sends: only our own user may register */
+    if (0 != getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &cred_size) ||
+        geteuid() != cred.uid)
+    {
+        close(conn);
+        return;
+    }
+
+    for (i = 0; i < MAX_PENDING && NULL != sup->pending[id]; ++i)
+    {
+        id = (id + 1) % MAX_PENDING;
+    }
+
+    if (MAX_PENDING > i)
+    {
+        pending = (pending_t *)malloc(sizeof(pending_t));
+    }
+    if (NULL == pending)
+    {
+        close(conn);
+        return;
+    }
+
+    pending->conn = conn;
+    pending->fds[0] = -1;
+    pending->fds[1] = -1;
+    pending->n_read = 0;
+    pending->cred = cred;
+    sup->pending[id] = pending;
+    sup->next_pending = (id + 1) % MAX_PENDING;
+
+    event.events = EPOLLIN;
+    event.data.u64 = PENDING_EVENT + id;
+    epoll_ctl(sup->epfd, EPOLL_CTL_ADD, conn, &event);
+    TimerWheelAdd(sup->pending_wheel, id, REQUEST_TIMEOUT_MS / WD_SUPERVISOR_TICK_MS);
+
+    /* a client sends its request right after it connects */
+    OnPendingEvent(sup, id);
+}
+
+static void OnAccept(supervisor_t *sup)
+{
+    int conn = -1;
+
+    /* take all the connections that are waiting in one go. none of them can
+       hold up the loop: their requests are read as they come. */
+    for (conn = accept4(sup->listen_fd, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK);
+         -1 != conn;
+         conn = accept4(sup->listen_fd, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK))
+    {
+        AddPending(sup, conn);
+    }
+}
+
+static void OnConnEvent(supervisor_t *sup, size_t id)
+{
+    client_t *client = &sup->clients[id];
+    char request = 0;
+    ssize_t size = 0;
+
+    /* the connection was closed earlier in this batch of events */
+    if (-1 == client->conn)
+    {
+        return;
+    }
+
+    size = recv(client->conn, &request, 1, MSG_DONTWAIT);
+    if (-1 == size && (EAGAIN == errno || EWOULDBLOCK == errno))
+    {
+        /* the event was for a connection this slot had before */
+        return;
+    }
+
+    if (1 == size && RELEASE_REQUEST == request)
+    {
+        WDRegistryRelease(sup->registry, (int)id);
+
+        if (client->is_tracked)
+        {
+            Untrack(sup, id);
+        }
+        else
+        {
+            DropDaemonClient(sup, id);
+        }
+
+        return;
+    }
+
+    /* the client died. its pidfd tells us. */
+    CloseConn(sup, id);
+}
+
+static void OnTick(supervisor_t *sup)
+{
+    uint64_t expirations = 0;
+
+    if (sizeof(expirations) != read(sup->timerfd, &expirations, sizeof(expirations)))
+    {
+        return;
+    }
+
+    Beat(&sup->registry->supervisor.beat);
+    SyncClients(sup);
+
+    /* keep the wheel on time if the loop was late */
+    for (; 0 < expirations; --expirations)
+    {
+        ++sup->now;
+        TimerWheelTick(sup->wheel, &CheckClient, sup);
+
+        if (NULL != sup->pending_wheel)
+        {
+            TimerWheelTick(sup->pending_wheel, &ExpirePending, sup);
+        }
+    }
+
+    StartRevives(sup);
+
+    sup->idle_ticks = (0 == sup->n_tracked ? sup->idle_ticks + 1 : 0);
+}
+
+static int InitLoop(supervisor_t *sup)
+{
+    struct itimerspec tick = {{0}, {0}};
+    struct epoll_event event = {0};
+
+    sup->epfd = epoll_create1(0);
+    sup->timerfd = timerfd_create(CLOCK_MONOTONIC, 0);
+    if (-1 == sup->epfd || -1 == sup->timerfd)
+    {
+        perror("Failed to create supervisor event loop");
+        return (-1);
+    }
+
+    tick.it_interval.tv_nsec = WD_SUPERVISOR_TICK_MS * 1000000L;
+    tick.it_value = tick.it_interval;
+    timerfd_settime(sup->timerfd, 0, &tick, NULL);
+
+    event.events = EPOLLIN;
+    event.data.u64 = TICK_EVENT;
+    if (0 != epoll_ctl(sup->epfd, EPOLL_CTL_ADD, sup->timerfd, &event))
+    {
+        return (-1);
+    }
+
+    if (!sup->is_daemon)
+    {
+        return (0);
+    }
+
+    event.data.u64 = LISTEN_EVENT;
+
+    return (epoll_ctl(sup->epfd, EPOLL_CTL_ADD, sup->listen_fd, &event));
+}
+
+static void RunLoop(supervisor_t *sup)
+{
+    struct epoll_event events[MAX_EVENTS];
+    int n_events = 0;
+    int i = 0;
+
+    while (!stop_flag &&
+           (sup->is_daemon || sup->idle_ticks < IDLE_EXIT_MS / WD_SUPERVISOR_TICK_MS))
+    {
+        n_events = epoll_wait(sup->epfd, events, MAX_EVENTS, -1);
+        if (-1 == n_events)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+
+            perror("Supervisor epoll_wait failed");
+            return;
+        }
+
+        for (i = 0; i < n_events; ++i)
+        {
+            if (TICK_EVENT == events[i].data.u64)
+            {
+                OnTick(sup);
+            }
+            else if (LISTEN_EVENT == events[i].data.u64)
+            {
+                OnAccept(sup);
+            }
+            else if (PENDING_EVENT <= events[i].data.u64)
+            {
+                OnPendingEvent(sup, (size_t)(events[i].data.u64 - PENDING_EVENT));
+            }
+            else if (CONN_EVENT <= events[i].data.u64)
+            {
+                OnConnEvent(sup, (size_t)(events[i].data.u64 - CONN_EVENT));
+            }
+            else
+            {
+                OnClientExit(sup, (size_t)events[i].data.u64);
+            }
+        }
+
+        StartRevives(sup);
+    }
+}
+
+static supervisor_t *CreateSupervisor(size_t max_revives)
+{
+    struct sigaction sig_act = {0};
+    supervisor_t *sup = NULL;
+    size_t id = 0;
+
+    sup = (supervisor_t *)calloc(1, sizeof(supervisor_t));
+    if (NULL == sup)
+    {
+        return (NULL);
+    }
+
+    sup->wheel = TimerWheelCreate(WD_SUPERVISOR_MAX_CLIENTS, WHEEL_BUCKETS);
+    if (NULL == sup->wheel)
+    {
+        free(sup);
+        return (NULL);
+    }
+
+    for (id = 0; id < WD_SUPERVISOR_MAX_CLIENTS; ++id)
+    {
+        sup->clients[id].pidfd = -1;
+        sup->clients[id].given_pidfd = -1;
+        sup->clients[id].conn = -1;
+    }
+
+    sup->max_revives = (0 == max_revives ? WD_SUPERVISOR_MAX_REVIVES : max_revives);
+    sup->epfd = -1;
+    sup->timerfd = -1;
+    sup->listen_fd = -1;
+
+    sigemptyset(&sig_act.sa_mask);
+    sig_act.sa_handler = &SignalHandler;
+    sigaction(SIGTERM, &sig_act, NULL);
+    sigaction(SIGINT, &sig_act, NULL);
+
+    return (sup);
+}
+
+static void DestroySupervisor(supervisor_t *sup)
+{
+    size_t id = 0;
+
+    for (id = 0; id < WD_SUPERVISOR_MAX_CLIENTS; ++id)
+    {
+        UnwatchPid(sup, id);
+        DropDaemonClient(sup, id);
+    }
+
+    for (id = 0; id < MAX_PENDING; ++id)
+    {
+        if (NULL != sup->pending[id])
+        {
+            DropPending(sup, id);
+        }
+    }
+
+    if (-1 != sup->epfd)
+    {
+        close(sup->epfd);
+    }
+    if (-1 != sup->timerfd)
+    {
+        close(sup->timerfd);
+    }
+    if (-1 != sup->listen_fd)
+    {
+        close(sup->listen_fd);
+    }
+
+    if (NULL != sup->pending_wheel)
+    {
+        TimerWheelDestroy(sup->pending_wheel);
+    }
+    TimerWheelDestroy(sup->wheel);
+    free(sup);
+}
+
+int SupervisorRun(const char *name, size_t max_revives)
+{
+    supervisor_t *sup = NULL;
+    int lock_fd = -1;
+    int status = -1;
+
+    assert(name);
+
+    /* the lock is dropped by the kernel when the supervisor dies */
+    lock_fd = shm_open(name, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+    if (-1 == lock_fd || -1 == flock(lock_fd, LOCK_EX | LOCK_NB))
+    {
+        if (-1 != lock_fd)
+        {
+            close(lock_fd);
+        }
+
+        /* another supervisor owns the registry */
+        return (EWOULDBLOCK == errno ? 0 : -1);
+    }
+
+    sup = CreateSupervisor(max_revives);
+    if (NULL == sup)
+    {
+        close(lock_fd);
+        return (-1);
+    }
+
+    sup->registry = WDRegistryOpen(name);
+
+    if (NULL != sup->registry && 0 == InitLoop(sup))
+    {
+        /* force a scan of the clients that attached before we started */
+        sup->generation = atomic_load(&sup->registry->generation) - 1;
+        atomic_store(&sup->registry->supervisor_pid, getpid());
+
+        RunLoop(sup);
+
+        atomic_store(&sup->registry->supervisor_pid, 0);
+        status = 0;
+    }
+
+    if (NULL != sup->registry)
+    {
+        WDRegistryClose(sup->registry);
+    }
+    DestroySupervisor(sup);
+
+    close(lock_fd);
+
+    return (status);
+}
+
+static int OpenListener(const char *name)
+{
+    struct sockaddr_un addr;
+    socklen_t addr_size = DaemonAddress(name, &addr);
+    int listen_fd = -1;
+    int error = 0;
+
+    if (0 == addr_size)
+    {
+        errno = ENAMETOOLONG;
+        return (-1);
+    }
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (-1 == listen_fd)
+    {
+        return (-1);
+    }
+
+    /* the bind fails while another daemon holds the name */
+    if (0 != bind(listen_fd, (struct sockaddr *)&addr, addr_size) ||
+        0 != listen(listen_fd, LISTEN_BACKLOG))
+    {
+        error = errno;
+        close(listen_fd);
+        errno = error;
+
+        return (-1);
+    }
+
+    return (listen_fd);
+}
+
+static void RaiseFdLimit(void)
+{
+    struct rlimit limit = {0};
+
+    /* two descriptors per client: its pidfd and its connection */
+    if (0 == getrlimit(RLIMIT_NOFILE, &limit))
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+int SupervisorRunDaemon(const char *name, size_t max_revives)
+{
+    supervisor_t *sup = NULL;
+    int listen_fd = -1;
+    int status = -1;
+
+    assert(name);
+
+    listen_fd = OpenListener(name);
+    if (-1 == listen_fd)
+    {
+        /* another daemon serves this name */
+        return (EADDRINUSE == errno ? 0 : -1);
+    }
+
+    RaiseFdLimit();
+
+    sup = CreateSupervisor(max_revives);
+    if (NULL == sup)
+    {
+        close(listen_fd);
+        return (-1);
+    }
+
+    sup->is_daemon = 1;
+    sup->listen_fd = listen_fd;
+
+    /* nobody else maps the registry: clients reach it through the socket */
+    sup->registry = (wd_registry_t *)calloc(1, sizeof(wd_registry_t));
+    sup->pending_wheel = TimerWheelCreate(MAX_PENDING, PENDING_WHEEL_BUCKETS);
+
+    if (NULL != sup->registry && NULL != sup->pending_wheel && 0 == InitLoop(sup))
+    {
+        RunLoop(sup);
+        status = 0;
+    }
+
+    free(sup->registry);
+    DestroySupervisor(sup);
+
+    return (status);
+}
@@ -0,0 +1,29 @@
+#include <stdio.h>  /* fprintf */
+#include <stdlib.h> /* atoi */
+#include <string.h> /* strcmp */
+
+#include "supervisor.h"
+
+int main(int argc, char *argv[])
+{
+    int is_daemon = (1 < argc && 0 == strcmp(argv[1], "-d"));
+
+    if (2 + is_daemon > argc)
+    {
+        fprintf(stderr, "usage: %s [-d] <registry or daemon name> [max parallel revives]\n", 
+                argv[0]);
+        return (1);
+    }
+
+    argv += is_daemon;
+    argc -= is_daemon;
+
+    if (is_daemon)
+    {
+        return (SupervisorRunDaemon(argv[1], 2 < argc ? (size_t)atoi(argv[2]) : 
+                                                        WD_SUPERVISOR_MAX_REVIVES));
+    }
+
+    return (SupervisorRun(argv[1], 2 < argc ? (size_t)atoi(argv[2]) : 
+                                              WD_SUPERVISOR_MAX_REVIVES));
+}
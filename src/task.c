@@ -1,5 +1,7 @@
+#define _POSIX_C_SOURCE 200112L /* clock_gettime */
 #include <assert.h> /* assert */
 #include <stdlib.h> /* malloc, free */
+#include <time.h> /* clock_gettime */
 
 #include "task.h"
 
@@ -9,9 +11,26 @@ enum Status
 	FAILURE = 1
 };
 
+time_t TaskTimeNow(void)
+{
+	struct timespec now = {0};
+	
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	
+	return (now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
+
 task_t *TaskCreate(int (*op_func)(void *), void *param, 
 				   size_t delay_in_sec, size_t interval_in_sec, 
 				   void (*task_cleanup)(void *), void *cleanup_param)
+{
+	return (TaskCreateMs(op_func, param, delay_in_sec * 1000, interval_in_sec * 1000, 
+						 task_cleanup, cleanup_param));
+}
+
+task_t *TaskCreateMs(int (*op_func)(void *), void *param, 
+				     size_t delay_in_ms, size_t interval_in_ms, 
+				     void (*task_cleanup)(void *), void *cleanup_param)
 {
 	task_t *task = NULL;
 	
@@ -35,28 +54,43 @@ task_t *TaskCreate(int (*op_func)(void *), void *param,
 	
 	task->op_func = op_func;
 	task->op_param = param;
-	task->time_to_run = time(0) + delay_in_sec;
-	task->interval_in_sec = interval_in_sec;
+	task->time_to_run = TaskTimeNow() + delay_in_ms;
+	task->interval_in_ms = interval_in_ms;
 	task->task_cleanup = task_cleanup;
 	task->cleanup_param = cleanup_param;
+	task->is_cancelled = 0;
 	
 	return (task);
 }
 
-uid_t TaskGetUID(const task_t *task)
+ilrd_uid_t TaskGetUID(const task_t *task)
 {
 	assert(task);
 	
 	return (task->task_id);
 }
 
-int TaskIsMatch(const task_t *task1, uid_t uid)
+int TaskIsMatch(const task_t *task1, ilrd_uid_t uid)
 {
 	assert(task1);
 	
 	return (UIDIsSame(TaskGetUID(task1), uid));
 }
 
+void TaskCancel(task_t *task)
+{
+	assert(task);
+	
+	task->is_cancelled = 1;
+}
+
+int TaskIsCancelled(const task_t *task)
+{
+	assert(task);
+	
+	return (task->is_cancelled);
+}
+
 time_t TaskGetTimeToRun(const task_t *task)
 {
 	assert(task);
@@ -85,7 +119,7 @@ int TaskUpdateTimeToRun(task_t *task)
 	/* the updated time to run is used to insert the task that's being executed 
 	   back into the pqueue with an updated priority (which is based on 
 	   time_to_run) */
-	task->time_to_run += task->interval_in_sec;
+	task->time_to_run += task->interval_in_ms;
 		
 	return (SUCCESS);
 }
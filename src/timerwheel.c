@@ -0,0 +1,180 @@
+#include <assert.h> /* assert */
+#include <stdlib.h> /* malloc, free */
+
+#include "timerwheel.h"
+
+#define NONE ((size_t)-1)
+
+typedef struct Timer
+{
+	size_t next;
+	size_t prev;
+	size_t bucket;
+	size_t rounds;
+} wheel_timer_t;
+
+struct TimerWheel
+{
+	wheel_timer_t *timers;
+	size_t *heads;
+	size_t capacity;
+	size_t n_buckets;
+	size_t now;
+};
+
+static void Unlink(timer_wheel_t *wheel, size_t id)
+{
+	wheel_timer_t *timer = &wheel->timers[id];
+
+	if(NONE != timer->prev)
+	{
+		wheel->timers[timer->prev].next = timer->next;
+	}
+	else
+	{
+		wheel->heads[timer->bucket] = timer->next;
+	}
+
+	if(NONE != timer->next)
+	{
+		wheel->timers[timer->next].prev = timer->prev;
+	}
+
+	timer->bucket = NONE;
+	timer->next = NONE;
+	timer->prev = NONE;
+}
+
+timer_wheel_t *TimerWheelCreate(size_t capacity, size_t n_buckets)
+{
+	timer_wheel_t *wheel = NULL;
+	size_t i = 0;
+
+	assert(0 < n_buckets);
+
+	wheel = (timer_wheel_t *)malloc(sizeof(timer_wheel_t));
+	if(NULL == wheel)
+	{
+		return (NULL);
+	}
+
+	wheel->timers = (wheel_timer_t *)malloc(capacity * sizeof(wheel_timer_t));
+	wheel->heads = (size_t *)malloc(n_buckets * sizeof(size_t));
+	if(NULL == wheel->timers || NULL == wheel->heads)
+	{
+		free(wheel->timers);
+		free(wheel->heads);
+		free(wheel);
+
+		return (NULL);
+	}
+
+	for(i = 0; i < capacity; ++i)
+	{
+		wheel->timers[i].next = NONE;
+		wheel->timers[i].prev = NONE;
+		wheel->timers[i].bucket = NONE;
+		wheel->timers[i].rounds = 0;
+	}
+
+	for(i = 0; i < n_buckets; ++i)
+	{
+		wheel->heads[i] = NONE;
+	}
+
+	wheel->capacity = capacity;
+	wheel->n_buckets = n_buckets;
+	wheel->now = 0;
+
+	return (wheel);
+}
+
+void TimerWheelDestroy(timer_wheel_t *wheel)
+{
+	assert(NULL != wheel);
+
+	free(wheel->timers);
+	free(wheel->heads);
+	free(wheel);
+}
+
+void TimerWheelAdd(timer_wheel_t *wheel, size_t id, size_t ticks)
+{
+	wheel_timer_t *timer = NULL;
+	size_t bucket = 0;
+
+	assert(NULL != wheel);
+	assert(id < wheel->capacity);
+	assert(0 < ticks);
+
+	if(TimerWheelIsPending(wheel, id))
+	{
+		Unlink(wheel, id);
+	}
+
+	bucket = (wheel->now + ticks) % wheel->n_buckets;
+
+	timer = &wheel->timers[id];
+	timer->bucket = bucket;
+	timer->rounds = (ticks - 1) / wheel->n_buckets;
+	timer->prev = NONE;
+	timer->next = wheel->heads[bucket];
+
+	if(NONE != timer->next)
+	{
+		wheel->timers[timer->next].prev = id;
+	}
+
+	wheel->heads[bucket] = id;
+}
+
+void TimerWheelRemove(timer_wheel_t *wheel, size_t id)
+{
+	assert(NULL != wheel);
+	assert(id < wheel->capacity);
+
+	if(TimerWheelIsPending(wheel, id))
+	{
+		Unlink(wheel, id);
+	}
+}
+
+int TimerWheelIsPending(const timer_wheel_t *wheel, size_t id)
+{
+	assert(NULL != wheel);
+	assert(id < wheel->capacity);
+
+	return (NONE != wheel->timers[id].bucket);
+}
+
+size_t TimerWheelTick(timer_wheel_t *wheel, void (*expire)(size_t id, void *param),
+                      void *param)
+{
+	size_t id = 0;
+	size_t next = 0;
+	size_t expired = 0;
+
+	assert(NULL != wheel);
+	assert(NULL != expire);
+
+	wheel->now = (wheel->now + 1) % wheel->n_buckets;
+
+	/* a timer added to this bucket by expire goes to the head, behind the walk */
+	for(id = wheel->heads[wheel->now]; NONE != id; id = next)
+	{
+		next = wheel->timers[id].next;
+
+		if(0 < wheel->timers[id].rounds)
+		{
+			--wheel->timers[id].rounds;
+			continue;
+		}
+
+		Unlink(wheel, id);
+		++expired;
+
+		expire(id, param);
+	}
+
+	return (expired);
+}
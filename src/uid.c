@@ -1,83 +1,185 @@
-#include <sys/types.h> /* getpid */
-#include <unistd.h>	   /* getpid */
-#include <time.h>	   /* time_t */
-#include <string.h>	   /* strcpy */
-#include <stdlib.h>	   /* malloc, free */
-#include <ifaddrs.h>   /* struct ifaddrs, struct sockaddr */
-#include <arpa/inet.h> /* AF_INET */
-#include <pthread.h>   /* mutex */
+#define _POSIX_C_SOURCE 200112L /* getifaddrs */
+#include <sys/types.h>  /* getpid */
+#include <unistd.h>     /* getpid */
+#include <time.h>       /* time */
+#include <stdio.h>      /* fopen, fscanf */
+#include <string.h>     /* strrchr */
+#include <ifaddrs.h>    /* struct ifaddrs, struct sockaddr */
+#include <arpa/inet.h>  /* AF_INET, ntohl */
+#include <pthread.h>    /* pthread_atfork */
+#include <stdatomic.h>  /* atomic_uint_fast64_t */
 
 #include "uid.h"
 
 enum
 {
 	TRUE = 1,
-	FALSE = 0,
-	FAILURE = 0,
-	SUCCESS = 1
+	FALSE = 0
 };
 
-const uid_t UIDBadUID = {0};
-
-pthread_mutex_t lock;
-
-static int GetIP(char *ip)
+/* 
+the serial is the start time of the process in ms, shifted left, plus the 
+counter. 42 bits of ms last until 2109. the counter may carry into the 
+time bits: a later process with the same pid starts at least 1 ms later, 
+so their serials meet only after more than 2^22 ids per ms of run time.
+*/
+#define START_SHIFT (22)
+#define STAT_LINE_SIZE (1024)
+#define STAT_FIELDS_BEFORE_START (19) /* fields 3 to 21 of /proc/self/stat */
+
+const ilrd_uid_t UIDBadUID = {0};
+
+/* 0 until the identity of the process is cached. a pid is never 0 */
+static atomic_uint_fast64_t host_id = 0;
+static atomic_uint_fast64_t serial_base = 0;
+static atomic_uint_fast64_t counter = 0;
+static atomic_int is_atfork_set = FALSE;
+
+static uint32_t GetIP(void)
 {
-	struct ifaddrs *ifap, *ifa;
-	struct sockaddr_in *sa;
-	char *addr;
+	struct ifaddrs *ifap = NULL;
+	struct ifaddrs *ifa = NULL;
+	uint32_t addr = 0;
+	uint32_t loopback = 0;
 
 	if (0 != getifaddrs(&ifap))
 	{
-		return (FAILURE);
+		return (0);
 	}
-	for (ifa = ifap; ifa; ifa = ifa->ifa_next)
+
+	/* take the first non-loopback IPv4 address */
+	for (ifa = ifap; ifa && 0 == addr; ifa = ifa->ifa_next)
 	{
 		if (ifa->ifa_addr && ifa->ifa_addr->sa_family == AF_INET)
 		{
-			sa = (struct sockaddr_in *)ifa->ifa_addr;
-			addr = inet_ntoa(sa->sin_addr);
+			addr = ntohl(((struct sockaddr_in *)ifa->ifa_addr)->sin_addr.s_addr);
+			if (INADDR_LOOPBACK == addr)
+			{
+				loopback = addr;
+				addr = 0;
+			}
 		}
 	}
 
-	strcpy(ip, addr);
-
 	freeifaddrs(ifap);
 
-	return (SUCCESS);
+	return (0 != addr ? addr : loopback);
 }
 
-uid_t UIDCreate(void)
+/* in ms since the epoch, from the boot time and the start of the process */
+static uint64_t GetStartMs(void)
 {
-	static size_t counter = 0; 
-	uid_t UID = {0};
-	char *ip = NULL;
+	char line[STAT_LINE_SIZE] = {'\0'};
+	unsigned long start_ticks = 0;
+	unsigned long boot_time = 0;
+	long ticks_per_s = sysconf(_SC_CLK_TCK);
+	char *fields = NULL;
+	FILE *stat = NULL;
+	int i = 0;
+
+	stat = fopen("/proc/stat", "r");
+	while (NULL != stat && NULL != fgets(line, sizeof(line), stat) &&
+		   1 != sscanf(line, "btime %lu", &boot_time))
+	{
+	}
+	if (NULL != stat)
+	{
+		fclose(stat);
+	}
+
+	stat = fopen("/proc/self/stat", "r");
+	if (NULL != stat && NULL != fgets(line, sizeof(line), stat))
+	{
+		/* the command name may hold spaces, the fields follow its ')' */
+		fields = strrchr(line, ')');
+	}
+	if (NULL != stat)
+	{
+		fclose(stat);
+	}
 
-	UID.pid = getpid();
+	for (i = 0; NULL != fields && i <= STAT_FIELDS_BEFORE_START; ++i)
+	{
+		fields = strchr(fields + 1, ' ');
+	}
 
-	pthread_mutex_lock(&lock);
-	++counter;
-	UID.counter = counter;
-	pthread_mutex_unlock(&lock);
+	if (0 == boot_time || NULL == fields || 0 >= ticks_per_s ||
+		1 != sscanf(fields, " %lu", &start_ticks))
+	{
+		/* no /proc, fall back to the time of the first id */
+		return ((uint64_t)time(0) * 1000);
+	}
 
-	UID.time = time(0);
+	return ((uint64_t)boot_time * 1000 + (uint64_t)start_ticks * 1000 / ticks_per_s);
+}
 
-	if (FAILURE == GetIP(UID.ip))
+static void ForgetIdentity(void)
+{
+	/* a forked child has a pid of its own */
+	atomic_store(&host_id, 0);
+}
+
+static uint64_t CacheIdentity(void)
+{
+	uint64_t host = ((uint64_t)GetIP() << 32) | (uint32_t)getpid();
+	uint64_t base = GetStartMs() << START_SHIFT;
+	int expected = FALSE;
+
+	if (atomic_compare_exchange_strong(&is_atfork_set, &expected, TRUE))
 	{
-		return (UIDBadUID);
+		pthread_atfork(NULL, NULL, ForgetIdentity);
 	}
 
-	free(ip);
+	/* threads that race here compute the same identity */
+	atomic_store(&serial_base, base);
+	atomic_store(&host_id, host);
+
+	return (host);
+}
+
+ilrd_uid_t UIDCreate(void)
+{
+	ilrd_uid_t UID = {0};
+	uint64_t count = 0;
+
+	UID.host = atomic_load_explicit(&host_id, memory_order_acquire);
+	if (0 == UID.host)
+	{
+		UID.host = CacheIdentity();
+	}
+
+	count = atomic_fetch_add_explicit(&counter, 1, memory_order_relaxed) + 1;
+
+	UID.serial = atomic_load_explicit(&serial_base, memory_order_relaxed) + count;
 
 	return (UID);
 }
 
-int UIDIsSame(uid_t id1, uid_t id2)
+void UIDCreateN(ilrd_uid_t *uids, size_t n)
 {
-	if (id1.pid == id2.pid && id1.counter == id2.counter && id1.time == id2.time && 0 == strcmp(id1.ip, id2.ip))
+	uint64_t host = 0;
+	uint64_t base = 0;
+	uint64_t count = 0;
+	size_t i = 0;
+
+	host = atomic_load_explicit(&host_id, memory_order_acquire);
+	if (0 == host)
 	{
-		return TRUE;
+		host = CacheIdentity();
 	}
 
-	return FALSE;
+	base = atomic_load_explicit(&serial_base, memory_order_relaxed);
+	count = atomic_fetch_add_explicit(&counter, n, memory_order_relaxed);
+
+	for (i = 0; i < n; ++i)
+	{
+		++count;
+		uids[i].host = host;
+		uids[i].serial = base + count;
+	}
+}
+
+int UIDIsSame(ilrd_uid_t id1, ilrd_uid_t id2)
+{
+	return (id1.host == id2.host && id1.serial == id2.serial);
 }
@@ -0,0 +1,292 @@
+#define _POSIX_C_SOURCE 200112L /* clock_gettime */
+#include <sys/types.h>  /* getpid */
+#include <unistd.h>     /* getpid */
+#include <time.h>       /* clock_gettime */
+#include <signal.h>     /* kill */
+#include <errno.h>      /* errno */
+#include <stdlib.h>     /* malloc, free */
+#include <pthread.h>    /* pthread_key_t */
+#include <stdatomic.h>  /* atomic_uint_fast64_t */
+
+#include "uid64.h"
+#include "wdshm.h"
+
+#define NODE_MASK ((1U << UID64_NODE_BITS) - 1)
+#define SEQ_MASK ((((uint64_t)1) << UID64_SEQ_BITS) - 1)
+
+/* a thread doubles its block each time it uses one up within a millisecond */
+#define MAX_BLOCK (256)
+
+#define NODE_TABLE_NAME ("/uid64_nodes")
+
+/* the pid that leases each node of this host, 0 for a free node */
+typedef struct NodeTable
+{
+	atomic_int pids[NODE_MASK + 1];
+} node_table_t;
+
+/* a stamp is (ms << UID64_SEQ_BITS | sequence), an id without its node */
+typedef struct ThreadBlock
+{
+	uint64_t next;
+	uint64_t end;
+	uint64_t size;
+} thread_block_t;
+
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+static pthread_key_t block_key;
+static int is_key_valid = 0;
+
+/* wall clock ms minus monotonic ms at init */
+static uint64_t clock_offset_ms = 0;
+
+static atomic_uint node_id = 0;
+static atomic_int is_node_set = 0;
+/* a forked child of a process whose node was set waits for a node of its own */
+static atomic_int is_node_needed = 0;
+
+/* first stamp that was not handed out yet */
+static atomic_uint_fast64_t next_stamp = 0;
+
+static uint64_t TimespecToMs(const struct timespec *ts)
+{
+	return ((uint64_t)ts->tv_sec * 1000 + (uint64_t)ts->tv_nsec / 1000000);
+}
+
+static int IsFreeNode(int holder, int pid)
+{
+	/* a node of a process that exited is free again */
+	return (0 == holder || pid == holder || (-1 == kill(holder, 0) && ESRCH == errno));
+}
+
+/* a node that no other live process on this host holds */
+static unsigned int LeaseNode(void)
+{
+	node_table_t *table = NULL;
+	int pid = (int)getpid();
+	int holder = 0;
+	unsigned int node = 0;
+	unsigned int i = 0;
+
+	table = (node_table_t *)WDShmOpen(NODE_TABLE_NAME, sizeof(node_table_t));
+	if (NULL == table)
+	{
+		return ((unsigned int)pid & NODE_MASK);
+	}
+
+	for (i = 0; i <= NODE_MASK; ++i)
+	{
+		node = ((unsigned int)pid + i) & NODE_MASK;
+		holder = atomic_load(&table->pids[node]);
+
+		if (IsFreeNode(holder, pid) &&
+		   atomic_compare_exchange_strong(&table->pids[node], &holder, pid))
+		{
+			break;
+		}
+	}
+
+	WDShmClose(table, sizeof(node_table_t));
+
+	/* more than 1024 processes make ids: share a node, as before */
+	return (i <= NODE_MASK ? node : (unsigned int)pid & NODE_MASK);
+}
+
+static void OnFork(void)
+{
+	thread_block_t *block = NULL;
+
+	/* the child starts with none of the stamps its parent reserved */
+	block = is_key_valid ? (thread_block_t *)pthread_getspecific(block_key) : NULL;
+	if (NULL != block)
+	{
+		block->next = 0;
+		block->end = 0;
+		block->size = 1;
+	}
+	atomic_store(&next_stamp, 0);
+
+	/* the child must not make the ids of its parent. a node that was set
+	   is not leased, so only the caller knows which one the child may use. */
+	if (atomic_load(&is_node_set))
+	{
+		atomic_store(&is_node_needed, 1);
+	}
+	else
+	{
+		atomic_store(&node_id, LeaseNode());
+	}
+}
+
+static void Init(void)
+{
+	struct timespec wall = {0};
+	struct timespec mono = {0};
+
+	clock_gettime(CLOCK_REALTIME, &wall);
+	clock_gettime(CLOCK_MONOTONIC, &mono);
+
+	clock_offset_ms = TimespecToMs(&wall) - TimespecToMs(&mono);
+
+	is_key_valid = (0 == pthread_key_create(&block_key, free));
+
+	if (!atomic_load(&is_node_set))
+	{
+		atomic_store(&node_id, LeaseNode());
+	}
+
+	pthread_atfork(NULL, NULL, OnFork);
+}
+
+static uint64_t NowStamp(void)
+{
+	struct timespec mono = {0};
+
+	clock_gettime(CLOCK_MONOTONIC, &mono);
+
+	return ((TimespecToMs(&mono) + clock_offset_ms - UID64_EPOCH_MS) << UID64_SEQ_BITS);
+}
+
+/* take n stamps from the shared counter, starting no earlier than now */
+static uint64_t Reserve(uint64_t now, uint64_t n)
+{
+	uint64_t cur = atomic_load_explicit(&next_stamp, memory_order_relaxed);
+	uint64_t start = 0;
+
+	do
+	{
+		start = cur > now ? cur : now;
+	}
+	while (!atomic_compare_exchange_weak_explicit(&next_stamp, &cur, start + n,
+												   memory_order_relaxed,
+												   memory_order_relaxed));
+
+	return (start);
+}
+
+static uid64_t StampToID(uint64_t stamp, uint64_t node)
+{
+	return (((stamp >> UID64_SEQ_BITS) << (UID64_NODE_BITS + UID64_SEQ_BITS)) |
+			(node << UID64_SEQ_BITS) | (stamp & SEQ_MASK));
+}
+
+static thread_block_t *GetThreadBlock(void)
+{
+	thread_block_t *block = NULL;
+
+	if (!is_key_valid)
+	{
+		return (NULL);
+	}
+
+	block = (thread_block_t *)pthread_getspecific(block_key);
+	if (NULL == block)
+	{
+		block = (thread_block_t *)malloc(sizeof(thread_block_t));
+		if (NULL == block)
+		{
+			return (NULL);
+		}
+
+		block->next = 0;
+		block->end = 0;
+		block->size = 1;
+
+		if (0 != pthread_setspecific(block_key, block))
+		{
+			free(block);
+
+			return (NULL);
+		}
+	}
+
+	return (block);
+}
+
+void UID64SetNode(unsigned int node)
+{
+	atomic_store(&is_node_set, 1);
+	atomic_store(&node_id, node & NODE_MASK);
+	atomic_store(&is_node_needed, 0);
+}
+
+uid64_t UID64Create(void)
+{
+	thread_block_t *block = NULL;
+	uint64_t now = 0;
+	uint64_t node = 0;
+
+	pthread_once(&init_once, Init);
+
+	if (atomic_load_explicit(&is_node_needed, memory_order_relaxed))
+	{
+		return (UID64_BAD_ID);
+	}
+
+	now = NowStamp();
+	node = atomic_load_explicit(&node_id, memory_order_relaxed);
+
+	block = GetThreadBlock();
+	if (NULL == block)
+	{
+		return (StampToID(Reserve(now, 1), node));
+	}
+
+	/* a block left over from an earlier millisecond would date the id */
+	if (block->next >= block->end || block->next < now)
+	{
+		if (block->next >= block->end && block->end > now)
+		{
+			/* used up within this millisecond, take more next time */
+			block->size = block->size < MAX_BLOCK ? block->size * 2 : MAX_BLOCK;
+		}
+		else
+		{
+			block->size = 1;
+		}
+
+		block->next = Reserve(now, block->size);
+		block->end = block->next + block->size;
+	}
+
+	++block->next;
+
+	return (StampToID(block->next - 1, node));
+}
+
+void UID64CreateN(uid64_t *ids, size_t n)
+{
+	uint64_t stamp = 0;
+	uint64_t node = 0;
+	size_t i = 0;
+
+	pthread_once(&init_once, Init);
+
+	if (atomic_load_explicit(&is_node_needed, memory_order_relaxed))
+	{
+		for (i = 0; i < n; ++i)
+		{
+			ids[i] = UID64_BAD_ID;
+		}
+
+		return;
+	}
+
+	node = atomic_load_explicit(&node_id, memory_order_relaxed);
+	stamp = Reserve(NowStamp(), n);
+
+	for (i = 0; i < n; ++i)
+	{
+		ids[i] = StampToID(stamp + i, node);
+	}
+}
+
+uint64_t UID64GetTime(uid64_t id)
+{
+	return ((id >> (UID64_NODE_BITS + UID64_SEQ_BITS)) + UID64_EPOCH_MS);
+}
+
+unsigned int UID64GetNode(uid64_t id)
+{
+	return ((unsigned int)(id >> UID64_SEQ_BITS) & NODE_MASK);
+}
@@ -1,45 +1,160 @@
 #define _POSIX_C_SOURCE 200112L
 #define __USE_POSIX    /* struct sigaction */
-#include <stdatomic.h> /* atomic_int */
 #include <sys/types.h> /* fork */
 #include <unistd.h>    /* fork */
 #include <pthread.h>   /* pthread_create */
-#include <signal.h>    /* SIGUSR1, SIGUSR2 */
+#include <signal.h>    /* SIGUSR2 */
 #include <assert.h>    /* assert */
 #include <stdio.h>     /* perror */
 #include <errno.h>     /* perror */
 #include <stdlib.h>    /* getenv, unsetenv, atoi */
-#include <semaphore.h> /* sem_open */
-#include <fcntl.h>     /* sem_open O constants */
-#include <sys/stat.h>  /* semaphore modes*/
+#include <sys/wait.h>  /* waitpid */
+#include <sys/prctl.h> /* prctl */
+#include <spawn.h>     /* posix_spawn */
+#include <time.h>      /* clock_gettime */
+#include <stdatomic.h> /* atomic_long */
+#include <string.h>    /* strlen, strchr, memcpy */
+#include <stdint.h>    /* uint64_t */
+#include <sys/timerfd.h> /* timerfd_create */
 
 #include "watchdog.h"
 #include "scheduler.h"
+#include "wdchannel.h"
+#include "pidwatch.h"
+#include "supervisor.h"
+#include "procstat.h"
+#include "wdregion.h"
 
-#define SEM_NAME ("kausdk")
+#define WD_EXEC_PATH ("./watchdog_op.out")
+#define CHANNEL_ENV ("WD_CHANNEL")
+#define CHANNEL_NAME_SIZE (32)
+#define CONFIG_ENV ("WD_CONFIG")
+#define CONFIG_STR_SIZE (512)
+#define MAX_PEER_THREADS (256)
+#define WCHAN_SIZE (64)
+/* a started peer that did not post ready in this time failed to start */
+#define READY_TIMEOUT_MS (10000)
+/* how often a wait for ready checks whether the peer already exited */
+#define READY_POLL_MS (10)
 
-atomic_int sig_counter = 0;
+extern char **environ;
 
-pid_t wd_pid = 0;
-pid_t pid = 0;
+pid_t peer_pid = 0;
+int is_watchdog = 0;
 
 pthread_t sched_thread = 0;
-sem_t *sem = NULL;
-int stop_flag = 0;
-sigset_t signal_set = {0};
+/* event-loop mode: no scheduler thread, this timer is due with the next task */
+int event_fd = -1;
+volatile sig_atomic_t stop_flag = 0;
+
+/* the peer is revived by the check task or by the death watch thread */
+pthread_t death_thread = 0;
+pthread_mutex_t revive_lock = PTHREAD_MUTEX_INITIALIZER;
 
 scheduler_t *sched = NULL;
 
-static void SIGUSR1Handler(int sig_num)
+wd_channel_t *channel = NULL;
+unsigned long last_peer_beat = 0;
+size_t missed_checks = 0;
+/* cpu time of a threadless user process at the last check */
+unsigned long last_peer_cpu_ms = 0;
+
+/* the peer died and was not revived yet */
+int is_peer_dead = 0;
+/* a revive waits for the new peer without revive_lock. the peer counts as dead
+   until it is ready, and no other revive starts meanwhile. */
+int is_peer_reviving = 0;
+pthread_cond_t revive_done = PTHREAD_COND_INITIALIZER;
+/* the revived peer was not seen beating yet */
+int is_peer_starting = 0;
+/* when the peer was revived. it has a whole check period from then to beat */
+time_t revive_ms = 0;
+
+wd_config_t config = {0};
+
+/* what the watchdog last saw of each thread slot of the user process */
+typedef struct ThreadWatch
 {
-    (void)sig_num;
-    ++sig_counter;
-}
+    unsigned long serial;
+    unsigned long progress;
+    time_t since;
+    int is_reported;
+    unsigned long cpu_ms; /* cpu time of the thread at its last progress */
+    int is_spin_reported;
+} thread_watch_t;
+
+thread_watch_t thread_watch[WD_MAX_THREADS] = {{0}};
+
+/* threads of the user process in uninterruptible sleep, and since when */
+typedef struct DStateWatch
+{
+    pid_t tid;
+    time_t since;
+    int is_reported;
+} d_state_watch_t;
+
+d_state_watch_t d_state_watch[MAX_PEER_THREADS] = {{0}};
+size_t n_d_state = 0;
+
+/* what the watchdog last saw of the kick counter, watched after a first kick */
+unsigned long last_kick = 0;
+time_t last_kick_ms = 0;
+int is_kick_armed = 0;
+
+/* the user process crossed a resource limit, and waits for a restart */
+int is_over_limit = 0;
+time_t over_limit_ms = 0;
+/* the watchdog killed it on purpose, that is not a crash */
+int is_restart_planned = 0;
+
+/* WDKick advances a word that nobody reads until the channel is open */
+static atomic_ulong unwatched_kicks = 0;
+atomic_ulong *wd_kick_counter = &unwatched_kicks;
+
+/* supervisor mode: our slot in the registry of a shared supervisor */
+wd_registry_t *registry = NULL;
+int client_slot = -1;
+pid_t supervisor_child = 0;
+
+/* daemon mode: our connection to a supervisor daemon and our heartbeat */
+int daemon_conn = -1;
+wd_side_t *daemon_beat = NULL;
+
+/* time the user process spent in the last spawn of the watchdog */
+atomic_long spawn_latency_us = -1;
+
+/* health probes of the user process, run by its scheduler */
+typedef struct HealthProbe
+{
+    int (*probe)(void *param);
+    void *param;
+    size_t interval_ms;
+    size_t budget_ms;
+    size_t max_breaches;
+    wd_probe_stats_t stats;
+} health_probe_t;
+
+health_probe_t probes[WD_MAX_PROBES] = {{0}};
+size_t n_probes = 0;
+/* the stats are read by application threads */
+pthread_mutex_t probe_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* persistent regions mapped by this process, by their slot in the channel */
+void *regions[WD_MAX_REGIONS] = {NULL};
+
+/* the watchdog's parked instance of the user program */
+pid_t standby_pid = 0;
 
 static void SIGUSR2Handler(int sig_num)
 {
     (void)sig_num;
     stop_flag = 1;
+
+    /* only sets a flag, and wakes the scheduler up from its sleep */
+    if (NULL != sched)
+    {
+        SchedulerStop(sched);
+    }
 }
 
 static void *SchedThreadFunc(void *arg)
@@ -51,255 +166,1688 @@ static void *SchedThreadFunc(void *arg)
     return (NULL);
 }
 
-static int SendSIGUSR1Task(void *pid)
+static int MySide(void)
+{
+    return (is_watchdog ? WD_SIDE_WATCHDOG : WD_SIDE_USER);
+}
+
+static int PeerSide(void)
 {
+    return (is_watchdog ? WD_SIDE_USER : WD_SIDE_WATCHDOG);
+}
+
+static int BeatTask(void *data)
+{
+    (void)data;
+
     if (stop_flag)
     {
         return (-1);
     }
 
-    if (WD_SUCCESS != kill(*(pid_t *)pid, SIGUSR1))
+    WDChannelBeat(channel, MySide());
+
+    return (0);
+}
+
+static pid_t SpawnWatchdog(char *path)
+{
+    char *argv[2] = {NULL};
+    struct timespec start = {0};
+    struct timespec end = {0};
+    pid_t pid = 0;
+    int status = 0;
+
+    argv[0] = path;
+
+    /* 
+    posix_spawn does not copy the page tables of the user process the way
+    fork does, so the spawn time does not grow with the RSS
+    */
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    status = posix_spawn(&pid, WD_EXEC_PATH, NULL, NULL, argv, environ);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    if (0 != status)
+    {
+        errno = status;
+        perror("Failed to run watchdog executable");
+        return (-1);
+    }
+
+    atomic_store(&spawn_latency_us, (end.tv_sec - start.tv_sec) * 1000000L + 
+                                    (end.tv_nsec - start.tv_nsec) / 1000);
+
+    return (pid);
+}
+
+/*
+the standby dies with the thread that forks it (PR_SET_PDEATHSIG), not with
+the process: the main thread and death_thread, which run until the watchdog
+stops. if death_thread ends early, its standby dies, and PromoteStandby
+falls back to a plain revive.
+*/
+static void SpawnStandby(char *path)
+{
+    standby_pid = fork();
+    if (-1 == standby_pid)
+    {
+        perror("Failed to create standby process");
+        standby_pid = 0;
+        return;
+    }
+
+    if (0 == standby_pid)
     {
-        perror("Failed to send signal");
+        /* standby process. it finds its pid in the channel at WDStart */
+        WDChannelSetStandby(channel, getpid());
 
+        execl(path, "./watchdog_op.out", (char *)NULL);
+        perror("Failed to load standby executable");
+        _exit(EXIT_FAILURE);
+    }
+}
+
+static int PromoteStandby(void)
+{
+    if (0 == standby_pid || 0 != waitpid(standby_pid, NULL, WNOHANG))
+    {
+        /* no standby, or it died */
+        standby_pid = 0;
         return (-1);
     }
 
+    peer_pid = standby_pid;
+    standby_pid = 0;
+
+    /* let it return from WDStart. it posts ready once it runs as the user */
+    WDChannelPromoteStandby(channel);
+
     return (0);
 }
 
-static int ReviveProcess(char *path)
+static void WaitForPromotion(void)
 {
-    char env_str[10] = {'\0'};
+    /* a standby must not outlive the watchdog that started it */
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+    if (getppid() != peer_pid)
+    {
+        _exit(EXIT_SUCCESS);
+    }
 
-    assert(path);
+    WDChannelWaitPromotion(channel);
 
-    /* check if this process is the watchdog */
-    if (NULL == getenv("WD_PID"))
+    /* as the user process, it must outlive a crash of the watchdog */
+    prctl(PR_SET_PDEATHSIG, 0);
+    WDChannelSetStandby(channel, 0);
+}
+
+/*
+call with revive_lock held. it is released while the new peer starts, so
+neither the check task nor the death watch blocks on a peer that never
+comes up. returns 0 once the peer runs, 1 if it exited or timed out first.
+*/
+static int WaitPeerReady(void)
+{
+    pid_t pid = peer_pid;
+    time_t deadline = TaskTimeNow() + READY_TIMEOUT_MS;
+    int status = 0;
+
+    is_peer_reviving = 1;
+    pthread_mutex_unlock(&revive_lock);
+
+    while (0 != WDChannelWaitReady(channel, READY_POLL_MS))
     {
-        /* watchdog process died */
-        wd_pid = fork();
-        if (-1 == wd_pid)
+        /* all our peers are our children, so an early exit is seen here */
+        if (pid == waitpid(pid, NULL, WNOHANG))
         {
-            perror("Failed to create child process");
-            return (-1);
+            fprintf(stderr, "watchdog: process %d exited before it was ready\n", (int)pid);
+            status = 1;
+            break;
         }
 
-        if (0 == wd_pid)
+        if (TaskTimeNow() >= deadline)
         {
-            /* watchdog process */
-
-            if (-1 == execl("./watchdog_op.out", path, (char *)NULL))
-            {
-                perror("Failed to run watchdog executable in revive.");
-                return (-1);
-            }
+            fprintf(stderr, "watchdog: process %d was not ready in %d ms\n", (int)pid,
+                    READY_TIMEOUT_MS);
+            kill(pid, SIGKILL);
+            status = 1;
+            break;
         }
-        else
-        {
-            /* parent process */
-            sem_wait(sem);
+    }
+
+    pthread_mutex_lock(&revive_lock);
+    is_peer_reviving = 0;
+    pthread_cond_broadcast(&revive_done);
+
+    return (status);
+}
+
+/* call with revive_lock held. returns 0 on success, -1 if no peer could be
+   created, 1 if the new peer did not come up */
+static int ReviveProcess(char *path)
+{
+    char env_str[10] = {'\0'};
+    int status = 0;
+
+    assert(path);
+
+    /* a late post of a peer that failed to start is not for the new one */
+    while (0 == WDChannelWaitReady(channel, 0))
+    {
+    }
 
-            sprintf(env_str, "%d", wd_pid);
-            setenv("WD_PID", env_str, 1);
+    if (!is_watchdog)
+    {
+        /* watchdog process died. reap it if it was our child */
+        waitpid(peer_pid, NULL, WNOHANG);
+
+        peer_pid = SpawnWatchdog(path);
+        if (-1 == peer_pid)
+        {
+            return (-1);
         }
+
+        sprintf(env_str, "%d", peer_pid);
+        setenv("WD_PID", env_str, 1);
     }
-    else if (atoi(getenv("WD_PID")) == getpid())
+    else if (!config.hot_standby || 0 != PromoteStandby())
     {
-        /* user process died */
-        pid = fork();
-        if (-1 == pid)
+        /* user process died, and no standby took its place */
+        peer_pid = fork();
+        if (-1 == peer_pid)
         {
             perror("Failed to create child process");
             return (-1);
         }
 
-        if (0 == pid)
+        if (0 == peer_pid)
         {
             /* user process */
-            if (-1 == execl(path, "./watchdog_op.out", (char *)NULL))
-            {
-                perror("Failed to load user executable");
-                return (-1);
-            }
-        }
-        else
-        {
-            /* watchdog process */
-            sem_wait(sem);
+            execl(path, "./watchdog_op.out", (char *)NULL);
+            perror("Failed to load user executable");
+            _exit(EXIT_FAILURE);
         }
     }
 
-    return (0);
+    status = WaitPeerReady();
+
+    if (0 == status && is_watchdog && config.hot_standby)
+    {
+        SpawnStandby(path);
+    }
+
+    return (status);
 }
 
-static int CheckCounterTask(void *data)
+static long TimeNowUs(void)
 {
-    assert(data);
+    struct timespec now = {0};
 
-    /* check signal counter */
+    clock_gettime(CLOCK_MONOTONIC, &now);
 
-    if (0 != sig_counter)
-    {
-        sig_counter = 0;
-    }
-    else
+    return (now.tv_sec * 1000000L + now.tv_nsec / 1000);
+}
+
+/* 
+the outage statistics of the peer. call with revive_lock held. 
+they are published under a sequence lock, so WDGetStats never waits for us.
+*/
+static void RecordBeat(void)
+{
+    wd_side_stats_t *stats = WDChannelStatsBegin(channel, PeerSide());
+    long now = TimeNowUs();
+
+    stats->last_beat_us = now;
+
+    if (is_peer_starting)
     {
-        /* the other process was terminated. recreate it. */
-        ReviveProcess(data);
+        is_peer_starting = 0;
+        stats->last_healthy_us = now;
+        HistogramAdd(&stats->revive_to_healthy, now - stats->last_revive_us);
     }
 
-    return (0);
+    WDChannelStatsEnd(channel, PeerSide());
 }
 
-static int CheckStopFlagTask(void *data)
+static void RecordMissedCheck(void)
 {
-    (void)data;
+    wd_side_stats_t *stats = WDChannelStatsBegin(channel, PeerSide());
 
-    if (stop_flag)
-    {
-        SchedulerStop(sched);
+    ++stats->missed_checks;
+
+    WDChannelStatsEnd(channel, PeerSide());
+}
+
+static void RecordDetect(void)
+{
+    wd_side_stats_t *stats = WDChannelStatsBegin(channel, PeerSide());
+    long now = TimeNowUs();
 
-        sem_destroy(sem);
+    stats->last_detect_us = now;
 
-        /* send SIGUSR2 to other process */
-        kill(pid, SIGUSR2);
+    if (0 != stats->last_beat_us)
+    {
+        HistogramAdd(&stats->beat_to_detect, now - stats->last_beat_us);
     }
 
-    return (0);
+    WDChannelStatsEnd(channel, PeerSide());
 }
 
-int WDStart(char **path)
+static void RecordRevive(void)
 {
-    struct sigaction sig_act1 = {0};
-    struct sigaction sig_act2 = {0};
-    char *wd_pid_str = NULL;
-    char curr_path[500] = {'\0'};
+    wd_side_stats_t *stats = WDChannelStatsBegin(channel, PeerSide());
+    long now = TimeNowUs();
 
-    assert(path);
+    stats->last_revive_us = now;
+    ++stats->restarts;
+    HistogramAdd(&stats->detect_to_revive, now - stats->last_detect_us);
 
-    /* define signal handler 1 */
-    sigemptyset(&sig_act1.sa_mask);
-    sig_act1.sa_flags = 0;
-    sig_act1.sa_handler = &SIGUSR1Handler;
-    sigaction(SIGUSR1, &sig_act1, NULL);
+    WDChannelStatsEnd(channel, PeerSide());
 
-    /* define signal handler 2 */
-    sigemptyset(&sig_act2.sa_mask);
-    sig_act2.sa_flags = 0;
-    sig_act2.sa_handler = &SIGUSR2Handler;
-    sigaction(SIGUSR2, &sig_act2, NULL);
+    is_peer_starting = 1;
+}
+
+/* call with revive_lock held */
+static int RevivePeer(char *path)
+{
+    int status = 0;
 
-    sem = sem_open(SEM_NAME, O_CREAT, S_IRWXU | S_IRWXO, 0);
-    if (NULL == sem)
+    /* the threads of a dead user process make no progress */
+    if (is_watchdog)
     {
-        perror("sem_open error:\n");
-        return -1;
+        WDChannelClearThreads(channel);
+        WDChannelSetUnhealthy(channel, 0);
+
+        WDChannelSetIdle(channel, 0);
+        is_over_limit = 0;
+
+        /* the new process is not watched until it kicks */
+        last_kick = atomic_load_explicit(&channel->kick.beat, memory_order_relaxed);
+        is_kick_armed = 0;
     }
 
-    /* check if this is the user process or the watchdog process */
-    wd_pid_str = getenv("WD_PID");
-    if (NULL == wd_pid_str)
+    status = ReviveProcess(path);
+    if (0 == status)
     {
-        /* watchdog process does not exist */
-        /* create child process for watchdog */
-        wd_pid = fork();
+        RecordRevive();
+    }
+
+    /* give the new peer a full check period */
+    last_peer_beat = WDChannelGetBeat(channel, PeerSide());
+    missed_checks = 0;
+    revive_ms = TaskTimeNow();
+
+    return (status);
+}
 
-        if (-1 == wd_pid)
+/* call with revive_lock held */
+static void RecordCrash(void)
+{
+    time_t next_restart = 0;
+
+    /* the watchdog holds back restarts of a user process that keeps crashing */
+    if (is_watchdog && !is_restart_planned)
+    {
+        next_restart = WDChannelRecordCrash(channel, &config.restart, TaskTimeNow());
+        if (next_restart > TaskTimeNow())
         {
-            perror("Failed to create child.");
-            return (WD_FAILED_TO_CREATE_CHILD_PROCESS);
+            fprintf(stderr, "watchdog: process %d crashed, restarting in %ld ms\n",
+                    (int)peer_pid, (long)(next_restart - TaskTimeNow()));
         }
+    }
+
+    is_restart_planned = 0;
+}
+
+/* call with revive_lock held */
+static void MarkPeerDead(void)
+{
+    if (is_peer_dead)
+    {
+        return;
+    }
+
+    is_peer_dead = 1;
+    RecordDetect();
+    RecordCrash();
+}
+
+/* call with revive_lock held. returns -1 if no peer could be created */
+static int TryRevive(char *path)
+{
+    restart_state_t restart = {0};
+    int status = 0;
+
+    if (!is_peer_dead || is_peer_reviving || stop_flag)
+    {
+        return (0);
+    }
 
-        if (0 == wd_pid)
+    if (is_watchdog)
+    {
+        WDChannelGetRestartState(channel, &restart);
+        if (TaskTimeNow() < restart.next_restart_ms)
         {
-            /* child process */
-            if (-1 == execl("./watchdog_op.out", *path, (char *)NULL))
-            {
-                perror("Failed to run watchdog executable.");
-                return (-1);
-            }
+            return (0);
         }
-        else
-        {
-            /* parent process */
-            sched = SchedulerCreate();
 
-            SchedulerAddTask(sched, &SendSIGUSR1Task, &wd_pid, 0, 1, NULL, NULL);
-            SchedulerAddTask(sched, &CheckCounterTask, *path, 2, 2, NULL, NULL);
-            SchedulerAddTask(sched, &CheckStopFlagTask, NULL, 1, 1, NULL, NULL);
+        WDChannelRecordRestart(channel, TaskTimeNow());
+    }
+
+    status = RevivePeer(path);
+    if (1 == status)
+    {
+        /* it died or hung on its way up, which is one more crash */
+        RecordCrash();
+        return (0);
+    }
+
+    is_peer_dead = 0;
 
-            sem_wait(sem);
+    return (status);
+}
 
-            pthread_create(&sched_thread, NULL, &SchedThreadFunc, sched);
+/* a threadless user process that sleeps and used no cpu waits for work */
+static int IsPeerIdle(void)
+{
+    proc_stat_t stat = {0};
+    unsigned long cpu_ms = 0;
+    int is_idle = 0;
 
-            /* add SIGUSR1 to signal set, then mask the set */
-            sigemptyset(&signal_set);
-            sigaddset(&signal_set, SIGUSR1);
-            pthread_sigmask(SIG_BLOCK, &signal_set, NULL);
-        }
+    if (0 != ProcStatRead(peer_pid, 0, &stat))
+    {
+        return (0);
     }
-    else if (atoi(wd_pid_str) == getpid())
+
+    cpu_ms = stat.utime_ms + stat.stime_ms;
+    is_idle = ('S' == stat.state && cpu_ms == last_peer_cpu_ms);
+    last_peer_cpu_ms = cpu_ms;
+
+    return (is_idle);
+}
+
+static int CheckBeatTask(void *data)
+{
+    unsigned long beat = 0;
+    int is_idle = 0;
+
+    assert(data);
+
+    /* in case the stop signal was lost */
+    if (is_watchdog && WDChannelIsStopRequested(channel))
     {
-        /* current process is watchdog */
-        pid = getppid();
+        SchedulerStop(sched);
+        return (0);
+    }
 
-        sched = SchedulerCreate();
+    pthread_mutex_lock(&revive_lock);
 
-        SchedulerAddTask(sched, &SendSIGUSR1Task, &pid, 0, 1, NULL, NULL);
-        SchedulerAddTask(sched, &CheckCounterTask, *path, 2, 2, NULL, NULL);
-        SchedulerAddTask(sched, &CheckStopFlagTask, NULL, 1, 1, NULL, NULL);
-        sem_post(sem);
+    /* the new peer is not checked until it runs */
+    if (is_peer_reviving)
+    {
+        pthread_mutex_unlock(&revive_lock);
+        return (0);
+    }
 
-        SchedulerRun(sched);
+    /* the peer must have beaten since the last check */
+    beat = WDChannelGetBeat(channel, PeerSide());
 
-        SchedulerDestroy(sched);
+    /* sampled on every check, to compare with the last one */
+    if (is_watchdog && WD_THREADLESS_IDLE_OK == config.threadless)
+    {
+        is_idle = IsPeerIdle();
     }
-    else
+
+    if (beat != last_peer_beat)
     {
-        /* user process has been revived */
-        sched = SchedulerCreate();
+        last_peer_beat = beat;
+        missed_checks = 0;
+        RecordBeat();
+    }
+    else if (is_idle || TaskTimeNow() - revive_ms < (time_t)config.check_interval_ms)
+    {
+        missed_checks = 0;
+    }
+    else if (!is_peer_dead)
+    {
+        RecordMissedCheck();
 
-        pid = atoi(getenv("WD_PID"));
+        if (++missed_checks >= config.miss_threshold)
+        {
+            /* the other process hangs or was terminated */
+            if (is_watchdog)
+            {
+                kill(peer_pid, SIGKILL);
+            }
 
-        SchedulerAddTask(sched, &SendSIGUSR1Task, &pid, 0, 1, NULL, NULL);
-        SchedulerAddTask(sched, &CheckCounterTask, *path, 2, 2, NULL, NULL);
-        SchedulerAddTask(sched, &CheckStopFlagTask, NULL, 1, 1, NULL, NULL);
+            MarkPeerDead();
+        }
+    }
 
-        sem_post(sem);
+    /* alive, but its own health probes fail */
+    if (is_watchdog && !is_peer_dead && WDChannelIsUnhealthy(channel))
+    {
+        fprintf(stderr, "watchdog: process %d failed its health probes\n", peer_pid);
+        kill(peer_pid, SIGKILL);
+        MarkPeerDead();
+    }
 
-        pthread_create(&sched_thread, NULL, &SchedThreadFunc, sched);
+    /* a user process that runs long enough is no longer crash-looping */
+    if (is_watchdog && !is_peer_dead)
+    {
+        WDChannelRecordRunning(channel, &config.restart, TaskTimeNow());
     }
 
+    /* recreate it, when its restart delay is over */
+    TryRevive(data);
+
+    pthread_mutex_unlock(&revive_lock);
+
     return (0);
 }
 
-void WDStop(size_t timeout)
+static void ReportThreadStall(wd_thread_slot_t *slot, time_t stalled_ms)
 {
-    time_t start_time = time(0);
+    proc_stat_t stat = {0};
+    pid_t tid = atomic_load(&slot->tid);
 
-    while (!stop_flag)
+    if (0 == ProcStatRead(peer_pid, tid, &stat))
+    {
+        fprintf(stderr, "watchdog: thread %d of process %d made no progress for %ld ms "
+                "(state %c, user %lu ms, system %lu ms)\n", (int)tid, (int)peer_pid,
+                (long)stalled_ms, stat.state, stat.utime_ms, stat.stime_ms);
+    }
+    else
+    {
+        fprintf(stderr, "watchdog: thread %d of process %d made no progress for %ld ms\n",
+                (int)tid, (int)peer_pid, (long)stalled_ms);
+    }
+}
+
+static unsigned long ThreadCpuMs(pid_t tid)
+{
+    proc_stat_t stat = {0};
+
+    if (0 != ProcStatRead(peer_pid, tid, &stat))
+    {
+        return (0);
+    }
+
+    return (stat.utime_ms + stat.stime_ms);
+}
+
+/* diagnostic capture: where every thread of the user process is */
+static void ReportPeerThreads(void)
+{
+    pid_t tids[MAX_PEER_THREADS] = {0};
+    char wchan[WCHAN_SIZE] = {'\0'};
+    proc_stat_t stat = {0};
+    size_t n_tids = ProcStatListThreads(peer_pid, tids, MAX_PEER_THREADS);
+    size_t i = 0;
+
+    for (i = 0; i < n_tids; ++i)
     {
-        if (difftime(time(0), start_time) >= timeout)
+        if (0 != ProcStatRead(peer_pid, tids[i], &stat))
         {
-            kill(wd_pid, SIGKILL);
+            continue;
         }
-        else
+
+        if (0 != ProcStatReadWchan(peer_pid, tids[i], wchan, WCHAN_SIZE))
         {
-            kill(wd_pid, SIGUSR2);
+            wchan[0] = '\0';
         }
+
+        fprintf(stderr, "watchdog:   thread %d: state %c, user %lu ms, system %lu ms%s%s\n",
+                (int)tids[i], stat.state, stat.utime_ms, stat.stime_ms,
+                ('\0' != wchan[0] ? ", waits in " : ""), wchan);
     }
+}
 
-    unsetenv("WD_PID");
+/* a spinning or blocked thread, already reported */
+static void OnPeerHang(void)
+{
+    if (WD_THREAD_REPORT == config.hang_action)
+    {
+        ReportPeerThreads();
+        return;
+    }
 
-    sem_unlink(SEM_NAME);
+    /* the death watch or the heartbeat check revives it */
+    pthread_mutex_lock(&revive_lock);
+    kill(peer_pid, SIGKILL);
+    WDChannelClearThreads(channel);
+    pthread_mutex_unlock(&revive_lock);
+}
 
-    SchedulerStop(sched);
+/* no progress, yet the thread used nearly a whole cpu all along */
+static int IsSpinning(pid_t tid, const thread_watch_t *watch, time_t stalled_ms)
+{
+    unsigned long cpu_ms = 0;
 
-    pthread_join(sched_thread, NULL);
+    if (stalled_ms < (time_t)config.spin_window_ms)
+    {
+        return (0);
+    }
 
-    SchedulerDestroy(sched);
+    cpu_ms = ThreadCpuMs(tid) - watch->cpu_ms;
+
+    return (cpu_ms * 10 >= (unsigned long)stalled_ms * 9);
+}
+
+static int CheckThreadsTask(void *data)
+{
+    wd_thread_slot_t *slot = NULL;
+    thread_watch_t *watch = NULL;
+    unsigned long serial = 0;
+    unsigned long progress = 0;
+    time_t now = TaskTimeNow();
+    int i = 0;
+
+    (void)data;
+
+    for (i = 0; i < WD_MAX_THREADS; ++i)
+    {
+        slot = &channel->threads[i];
+        watch = &thread_watch[i];
+
+        if (WD_THREAD_ACTIVE != atomic_load(&slot->state))
+        {
+            continue;
+        }
 
-    /* unblock SIGUSR1 */
-    pthread_sigmask(SIG_UNBLOCK, &signal_set, NULL);
-}
\ No newline at end of file
+        serial = atomic_load(&slot->serial);
+        progress = atomic_load_explicit(&slot->progress, memory_order_relaxed);
+
+        if (serial != watch->serial || progress != watch->progress)
+        {
+            /* a new registration or a kick restarts the deadline */
+            watch->serial = serial;
+            watch->progress = progress;
+            watch->since = now;
+            watch->is_reported = 0;
+            watch->is_spin_reported = 0;
+
+            if (0 < config.spin_window_ms)
+            {
+                watch->cpu_ms = ThreadCpuMs(atomic_load(&slot->tid));
+            }
+        }
+        else if (0 < config.spin_window_ms && !watch->is_spin_reported &&
+                 IsSpinning(atomic_load(&slot->tid), watch, now - watch->since))
+        {
+            /* caught before its deadline, which may be long */
+            watch->is_spin_reported = 1;
+            fprintf(stderr, "watchdog: thread %d of process %d spins without progress "
+                    "for %ld ms\n", (int)atomic_load(&slot->tid), (int)peer_pid,
+                    (long)(now - watch->since));
+            OnPeerHang();
+        }
+        else if (!watch->is_reported && now - watch->since >= (time_t)slot->deadline_ms)
+        {
+            watch->is_reported = 1;
+            ReportThreadStall(slot, now - watch->since);
+
+            if (WD_THREAD_RESTART == slot->action)
+            {
+                /* the death watch or the heartbeat check revives it */
+                pthread_mutex_lock(&revive_lock);
+                kill(peer_pid, SIGKILL);
+                WDChannelClearThreads(channel);
+                pthread_mutex_unlock(&revive_lock);
+            }
+        }
+    }
+
+    return (0);
+}
+
+static int CheckDStateTask(void *data)
+{
+    pid_t tids[MAX_PEER_THREADS] = {0};
+    d_state_watch_t blocked[MAX_PEER_THREADS] = {{0}};
+    proc_stat_t stat = {0};
+    time_t now = TaskTimeNow();
+    size_t n_tids = 0;
+    size_t n_blocked = 0;
+    size_t i = 0;
+    size_t j = 0;
+    int is_hung = 0;
+
+    (void)data;
+
+    n_tids = ProcStatListThreads(peer_pid, tids, MAX_PEER_THREADS);
+
+    for (i = 0; i < n_tids; ++i)
+    {
+        if (0 != ProcStatRead(peer_pid, tids[i], &stat) || 'D' != stat.state)
+        {
+            continue;
+        }
+
+        /* still blocked since the last check, or blocked from now on */
+        blocked[n_blocked].tid = tids[i];
+        blocked[n_blocked].since = now;
+        for (j = 0; j < n_d_state; ++j)
+        {
+            if (d_state_watch[j].tid == tids[i])
+            {
+                blocked[n_blocked] = d_state_watch[j];
+                break;
+            }
+        }
+
+        if (!blocked[n_blocked].is_reported &&
+            now - blocked[n_blocked].since >= (time_t)config.d_state_ms)
+        {
+            blocked[n_blocked].is_reported = 1;
+            is_hung = 1;
+            fprintf(stderr, "watchdog: thread %d of process %d is in uninterruptible sleep "
+                    "for %ld ms\n", (int)tids[i], (int)peer_pid,
+                    (long)(now - blocked[n_blocked].since));
+        }
+
+        ++n_blocked;
+    }
+
+    memcpy(d_state_watch, blocked, n_blocked * sizeof(d_state_watch_t));
+    n_d_state = n_blocked;
+
+    if (is_hung)
+    {
+        OnPeerHang();
+    }
+
+    return (0);
+}
+
+static int IsOverLimit(const proc_usage_t *usage)
+{
+    const wd_limits_t *limits = &config.limits;
+
+    if (0 < limits->max_rss_kb && usage->rss_kb > limits->max_rss_kb)
+    {
+        fprintf(stderr, "watchdog: process %d uses %lu kB of memory, over %lu kB\n",
+                (int)peer_pid, usage->rss_kb, (unsigned long)limits->max_rss_kb);
+        return (1);
+    }
+    if (0 < limits->max_fds && usage->n_fds > limits->max_fds)
+    {
+        fprintf(stderr, "watchdog: process %d has %lu open fds, over %lu\n",
+                (int)peer_pid, usage->n_fds, (unsigned long)limits->max_fds);
+        return (1);
+    }
+    if (0 < limits->max_threads && usage->n_threads > limits->max_threads)
+    {
+        fprintf(stderr, "watchdog: process %d has %lu threads, over %lu\n",
+                (int)peer_pid, usage->n_threads, (unsigned long)limits->max_threads);
+        return (1);
+    }
+
+    return (0);
+}
+
+static int IsInRestartWindow(void)
+{
+    const wd_limits_t *limits = &config.limits;
+    time_t now = time(NULL);
+    struct tm local = {0};
+    size_t minute = 0;
+
+    if (limits->window_start_min == limits->window_end_min)
+    {
+        return (0);
+    }
+
+    localtime_r(&now, &local);
+    minute = (size_t)(local.tm_hour * 60 + local.tm_min);
+
+    if (limits->window_start_min < limits->window_end_min)
+    {
+        return (limits->window_start_min <= minute && minute < limits->window_end_min);
+    }
+
+    /* the window wraps past midnight */
+    return (limits->window_start_min <= minute || minute < limits->window_end_min);
+}
+
+static int CheckUsageTask(void *data)
+{
+    proc_usage_t usage = {0};
+    time_t now = TaskTimeNow();
+
+    (void)data;
+
+    pthread_mutex_lock(&revive_lock);
+
+    if (!is_peer_dead && !is_over_limit && 0 == ProcStatReadUsage(peer_pid, &usage) &&
+        IsOverLimit(&usage))
+    {
+        is_over_limit = 1;
+        over_limit_ms = now;
+    }
+
+    /* a leak is slow, so the restart can wait for a better time */
+    if (!is_peer_dead && is_over_limit &&
+        (WDChannelIsIdle(channel) || IsInRestartWindow() ||
+         now - over_limit_ms >= (time_t)config.limits.max_defer_ms))
+    {
+        fprintf(stderr, "watchdog: restarting process %d to free its resources\n",
+                (int)peer_pid);
+        is_over_limit = 0;
+        is_restart_planned = 1;
+
+        /* the death watch or the heartbeat check revives it */
+        kill(peer_pid, SIGKILL);
+    }
+
+    pthread_mutex_unlock(&revive_lock);
+
+    return (0);
+}
+
+static int CheckKickTask(void *data)
+{
+    unsigned long kick = 0;
+    time_t now = TaskTimeNow();
+
+    (void)data;
+
+    pthread_mutex_lock(&revive_lock);
+
+    kick = atomic_load_explicit(&channel->kick.beat, memory_order_relaxed);
+    if (kick != last_kick)
+    {
+        last_kick = kick;
+        last_kick_ms = now;
+        is_kick_armed = 1;
+    }
+    else if (is_kick_armed && now - last_kick_ms >= (time_t)config.kick_window_ms)
+    {
+        /* the death watch or the heartbeat check revives it */
+        fprintf(stderr, "watchdog: process %d was not kicked for %ld ms\n", peer_pid,
+                (long)(now - last_kick_ms));
+        is_kick_armed = 0;
+        kill(peer_pid, SIGKILL);
+    }
+
+    pthread_mutex_unlock(&revive_lock);
+
+    return (0);
+}
+
+static void SleepUntilMs(time_t when)
+{
+    struct timespec remaining = {0};
+    time_t now = TaskTimeNow();
+
+    while (now < when && !stop_flag)
+    {
+        remaining.tv_sec = (when - now) / 1000;
+        remaining.tv_nsec = ((when - now) % 1000) * 1000000;
+        nanosleep(&remaining, NULL);
+
+        now = TaskTimeNow();
+    }
+}
+
+static void *DeathWatchFunc(void *path)
+{
+    sigset_t stop_set = {0};
+    restart_state_t restart = {0};
+    pid_t watched = 0;
+    int pidfd = -1;
+    int status = 0;
+
+    /* the stop signal is for the scheduler thread */
+    sigemptyset(&stop_set);
+    sigaddset(&stop_set, SIGUSR2);
+    pthread_sigmask(SIG_BLOCK, &stop_set, NULL);
+
+    while (!stop_flag)
+    {
+        /* the check task may be reviving the peer. watch the new one once it runs */
+        pthread_mutex_lock(&revive_lock);
+        while (is_peer_reviving)
+        {
+            pthread_cond_wait(&revive_done, &revive_lock);
+        }
+        watched = peer_pid;
+        pthread_mutex_unlock(&revive_lock);
+
+        pidfd = PidWatchOpen(watched);
+        if (-1 == pidfd && ESRCH != errno)
+        {
+            /* no pidfd support, a crash is found by the heartbeat check */
+            return (NULL);
+        }
+
+        /* the kernel wakes us up the moment the peer exits */
+        if (-1 != pidfd)
+        {
+            status = PidWatchWait(pidfd, watched, -1);
+            PidWatchClose(pidfd);
+
+            if (1 != status)
+            {
+                return (NULL);
+            }
+        }
+
+        /* the check task may have revived it already */
+        pthread_mutex_lock(&revive_lock);
+        if (watched == peer_pid)
+        {
+            MarkPeerDead();
+        }
+        WDChannelGetRestartState(channel, &restart);
+        pthread_mutex_unlock(&revive_lock);
+
+        SleepUntilMs(restart.next_restart_ms);
+
+        pthread_mutex_lock(&revive_lock);
+        status = TryRevive(path);
+        pthread_mutex_unlock(&revive_lock);
+
+        if (0 != status)
+        {
+            return (NULL);
+        }
+    }
+
+    return (NULL);
+}
+
+static int OpenChannel(void)
+{
+    char name[CHANNEL_NAME_SIZE] = {'\0'};
+    int is_new = 0;
+
+    /* the first user process names the channel, the rest inherit the name */
+    is_new = (NULL == getenv(CHANNEL_ENV));
+    if (is_new)
+    {
+        sprintf(name, "/wd_%d", getpid());
+        setenv(CHANNEL_ENV, name, 1);
+    }
+
+    channel = WDChannelOpen(getenv(CHANNEL_ENV));
+    if (NULL == channel)
+    {
+        return (-1);
+    }
+
+    if (is_new && 0 != WDChannelInit(channel))
+    {
+        return (-1);
+    }
+
+    last_peer_beat = WDChannelGetBeat(channel, PeerSide());
+
+    if (!is_watchdog)
+    {
+        wd_kick_counter = &channel->kick.beat;
+    }
+
+    return (0);
+}
+
+static void SetConfig(const wd_config_t *user_config)
+{
+    char config_str[CONFIG_STR_SIZE] = {'\0'};
+    unsigned long beat = 0;
+    unsigned long check = 0;
+    unsigned long miss = 0;
+    int hot_standby = 0;
+    unsigned long restart[5] = {0};
+    int threadless = 0;
+    unsigned long kick_window = 0;
+    unsigned long spin_window = 0;
+    unsigned long d_state = 0;
+    int hang_action = 0;
+    unsigned long limits[6] = {0};
+
+    if (NULL != user_config)
+    {
+        config = *user_config;
+    }
+    else if (NULL != getenv(CONFIG_ENV) &&
+             20 == sscanf(getenv(CONFIG_ENV), 
+                          "%lu,%lu,%lu,%d,%lu,%lu,%lu,%lu,%lu,%d,%lu,%lu,%lu,%d,"
+                          "%lu,%lu,%lu,%lu,%lu,%lu", 
+                          &beat, &check, &miss, &hot_standby, &restart[0], &restart[1], 
+                          &restart[2], &restart[3], &restart[4], &threadless, 
+                          &kick_window, &spin_window, &d_state, &hang_action, &limits[0],
+                          &limits[1], &limits[2], &limits[3], &limits[4], &limits[5]))
+    {
+        /* the watchdog process gets the configuration of its user */
+        config.beat_interval_ms = beat;
+        config.check_interval_ms = check;
+        config.miss_threshold = miss;
+        config.hot_standby = hot_standby;
+        config.restart.window_ms = restart[0];
+        config.restart.max_crashes = restart[1];
+        config.restart.base_delay_ms = restart[2];
+        config.restart.max_delay_ms = restart[3];
+        config.restart.cool_down_ms = restart[4];
+        config.threadless = threadless;
+        config.kick_window_ms = kick_window;
+        config.spin_window_ms = spin_window;
+        config.d_state_ms = d_state;
+        config.hang_action = hang_action;
+        config.limits.max_rss_kb = limits[0];
+        config.limits.max_fds = limits[1];
+        config.limits.max_threads = limits[2];
+        config.limits.window_start_min = limits[3];
+        config.limits.window_end_min = limits[4];
+        config.limits.max_defer_ms = limits[5];
+    }
+
+    if (0 == config.beat_interval_ms)
+    {
+        config.beat_interval_ms = WD_DEFAULT_BEAT_INTERVAL_MS;
+    }
+    if (0 == config.check_interval_ms)
+    {
+        config.check_interval_ms = WD_DEFAULT_CHECK_INTERVAL_MS;
+    }
+    if (0 == config.miss_threshold)
+    {
+        config.miss_threshold = WD_DEFAULT_MISS_THRESHOLD;
+    }
+
+    RestartPolicySetDefaults(&config.restart);
+
+    sprintf(config_str, "%lu,%lu,%lu,%d,%lu,%lu,%lu,%lu,%lu,%d,%lu,%lu,%lu,%d,"
+            "%lu,%lu,%lu,%lu,%lu,%lu", 
+            (unsigned long)config.beat_interval_ms, (unsigned long)config.check_interval_ms,
+            (unsigned long)config.miss_threshold, config.hot_standby,
+            (unsigned long)config.restart.window_ms, (unsigned long)config.restart.max_crashes,
+            (unsigned long)config.restart.base_delay_ms, 
+            (unsigned long)config.restart.max_delay_ms, 
+            (unsigned long)config.restart.cool_down_ms, config.threadless,
+            (unsigned long)config.kick_window_ms, (unsigned long)config.spin_window_ms,
+            (unsigned long)config.d_state_ms, config.hang_action,
+            (unsigned long)config.limits.max_rss_kb, (unsigned long)config.limits.max_fds,
+            (unsigned long)config.limits.max_threads, 
+            (unsigned long)config.limits.window_start_min,
+            (unsigned long)config.limits.window_end_min, 
+            (unsigned long)config.limits.max_defer_ms);
+    setenv(CONFIG_ENV, config_str, 1);
+}
+
+static void ArmEventFd(void)
+{
+    struct itimerspec next = {{0}, {0}};
+    time_t next_ms = SchedulerGetNextTime(sched);
+
+    /* with no tasks, the timer stays disarmed */
+    if (-1 != next_ms)
+    {
+        next.it_value.tv_sec = next_ms / 1000;
+        next.it_value.tv_nsec = (next_ms % 1000) * 1000000L;
+    }
+
+    timerfd_settime(event_fd, TFD_TIMER_ABSTIME, &next, NULL);
+}
+
+/* run the scheduler on a thread of its own, or from the application's loop */
+static int StartScheduler(void)
+{
+    if (NULL == sched)
+    {
+        /* threadless: the watchdog samples our progress word, we run nothing */
+        return (0);
+    }
+
+    if (!config.event_loop)
+    {
+        pthread_create(&sched_thread, NULL, &SchedThreadFunc, sched);
+        return (0);
+    }
+
+    event_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (-1 == event_fd)
+    {
+        perror("Failed to create event fd");
+        return (-1);
+    }
+
+    ArmEventFd();
+
+    return (0);
+}
+
+static void SpawnSupervisor(void)
+{
+    char *argv[3] = {NULL};
+    int status = 0;
+
+    argv[0] = (char *)WD_SUPERVISOR_EXEC_PATH;
+    argv[1] = (char *)config.supervisor;
+
+    /* if another client starts one too, only one keeps the registry */
+    status = posix_spawn(&supervisor_child, WD_SUPERVISOR_EXEC_PATH, NULL, NULL, 
+                         argv, environ);
+    if (0 != status)
+    {
+        errno = status;
+        perror("Failed to run supervisor executable");
+        supervisor_child = 0;
+    }
+}
+
+static int ClientBeatTask(void *data)
+{
+    (void)data;
+
+    WDRegistryBeat(registry, client_slot);
+
+    return (0);
+}
+
+static int CheckSupervisorTask(void *data)
+{
+    unsigned long beat = WDRegistryGetSupervisorBeat(registry);
+    int pid = 0;
+
+    (void)data;
+
+    /* reap a supervisor we started that has exited */
+    if (0 != supervisor_child && 0 != waitpid(supervisor_child, NULL, WNOHANG))
+    {
+        supervisor_child = 0;
+    }
+
+    if (beat != last_peer_beat)
+    {
+        last_peer_beat = beat;
+        missed_checks = 0;
+    }
+    else if (++missed_checks >= config.miss_threshold)
+    {
+        /* one of the clients takes over the restart of the supervisor */
+        missed_checks = 0;
+        pid = atomic_load(&registry->supervisor_pid);
+
+        if (atomic_compare_exchange_strong(&registry->supervisor_pid, &pid, 0))
+        {
+            if (0 != pid)
+            {
+                kill(pid, SIGKILL);
+            }
+
+            SpawnSupervisor();
+        }
+    }
+
+    return (0);
+}
+
+static int AttachSupervisor(char *path)
+{
+    char *slot_str = getenv(WD_SUPERVISOR_SLOT_ENV);
+    int pid = 0;
+
+    registry = WDRegistryOpen(config.supervisor);
+    if (NULL == registry)
+    {
+        return (WD_FAILED_TO_CREATE_WATCHDOG);
+    }
+
+    if (NULL != slot_str)
+    {
+        /* revived by the supervisor, take the slot of the dead process */
+        client_slot = atoi(slot_str);
+        unsetenv(WD_SUPERVISOR_SLOT_ENV);
+    }
+    else
+    {
+        client_slot = WDRegistryClaim(registry);
+    }
+
+    if (-1 == client_slot ||
+        0 != WDRegistryActivate(registry, client_slot, path, config.check_interval_ms,
+                                config.miss_threshold))
+    {
+        WDRegistryClose(registry);
+        registry = NULL;
+
+        return (WD_FAILED_TO_CREATE_WATCHDOG);
+    }
+
+    pid = atomic_load(&registry->supervisor_pid);
+    if (0 == pid || 0 != kill(pid, 0))
+    {
+        SpawnSupervisor();
+    }
+
+    last_peer_beat = WDRegistryGetSupervisorBeat(registry);
+
+    sched = SchedulerCreate();
+    SchedulerAddTaskMs(sched, &ClientBeatTask, NULL, 0, config.beat_interval_ms, NULL, NULL);
+    SchedulerAddTaskMs(sched, &CheckSupervisorTask, NULL, config.check_interval_ms,
+                       config.check_interval_ms, NULL, NULL);
+
+    if (0 != StartScheduler())
+    {
+        return (WD_FAILED_TO_CREATE_WATCHDOG);
+    }
+
+    return (WD_SUCCESS);
+}
+
+static int DaemonBeatTask(void *data)
+{
+    (void)data;
+
+    WDDaemonBeat(daemon_beat);
+
+    return (0);
+}
+
+static int AttachDaemon(char *path)
+{
+    char *slot_str = getenv(WD_SUPERVISOR_SLOT_ENV);
+    int slot = -1;
+
+    if (NULL != slot_str)
+    {
+        /* revived by the daemon, take the slot of the dead process */
+        slot = atoi(slot_str);
+        unsetenv(WD_SUPERVISOR_SLOT_ENV);
+    }
+
+    daemon_conn = WDDaemonRegister(config.supervisor_daemon, path, 
+                                   config.check_interval_ms, config.miss_threshold, 
+                                   slot, &daemon_beat);
+    if (-1 == daemon_conn)
+    {
+        return (WD_FAILED_TO_CREATE_WATCHDOG);
+    }
+
+    sched = SchedulerCreate();
+    SchedulerAddTaskMs(sched, &DaemonBeatTask, NULL, 0, config.beat_interval_ms, NULL, NULL);
+
+    if (0 != StartScheduler())
+    {
+        return (WD_FAILED_TO_CREATE_WATCHDOG);
+    }
+
+    return (WD_SUCCESS);
+}
+
+static void DetachSupervisor(void)
+{
+    SchedulerStop(sched);
+    if (config.event_loop)
+    {
+        close(event_fd);
+        event_fd = -1;
+    }
+    else
+    {
+        pthread_join(sched_thread, NULL);
+    }
+    SchedulerDestroy(sched);
+
+    if (-1 != daemon_conn)
+    {
+        WDDaemonRelease(daemon_conn, daemon_beat);
+        daemon_conn = -1;
+        daemon_beat = NULL;
+
+        return;
+    }
+
+    WDRegistryRelease(registry, client_slot);
+    WDRegistryClose(registry);
+    registry = NULL;
+}
+
+static void StopScheduler(void)
+{
+    if (NULL == sched)
+    {
+        return;
+    }
+
+    SchedulerStop(sched);
+    if (config.event_loop)
+    {
+        close(event_fd);
+        event_fd = -1;
+    }
+    else
+    {
+        pthread_kill(sched_thread, SIGUSR2);
+        pthread_join(sched_thread, NULL);
+    }
+
+    SchedulerDestroy(sched);
+    sched = NULL;
+}
+
+static int ProbeTask(void *data)
+{
+    health_probe_t *probe = (health_probe_t *)data;
+    long start_us = 0;
+    long latency_us = 0;
+    int status = 0;
+
+    if (stop_flag)
+    {
+        return (-1);
+    }
+
+    start_us = TimeNowUs();
+    status = probe->probe(probe->param);
+    latency_us = TimeNowUs() - start_us;
+
+    pthread_mutex_lock(&probe_lock);
+
+    ++probe->stats.calls;
+    HistogramAdd(&probe->stats.latency, (unsigned long)latency_us);
+
+    if (0 != status)
+    {
+        ++probe->stats.failures;
+    }
+    if (latency_us > (long)probe->budget_ms * 1000)
+    {
+        ++probe->stats.breaches;
+    }
+
+    if (0 != status || latency_us > (long)probe->budget_ms * 1000)
+    {
+        /* the watchdog restarts us at its next check */
+        if (++probe->stats.consecutive >= probe->max_breaches)
+        {
+            WDChannelSetUnhealthy(channel, 1);
+        }
+    }
+    else
+    {
+        probe->stats.consecutive = 0;
+    }
+
+    pthread_mutex_unlock(&probe_lock);
+
+    return (0);
+}
+
+static void AddTasks(char *path)
+{
+    size_t i = 0;
+
+    SchedulerAddTaskMs(sched, &BeatTask, NULL, 0, config.beat_interval_ms, NULL, NULL);
+    SchedulerAddTaskMs(sched, &CheckBeatTask, path, config.check_interval_ms, 
+                       config.check_interval_ms, NULL, NULL);
+    if (is_watchdog)
+    {
+        SchedulerAddTaskMs(sched, &CheckThreadsTask, NULL, config.beat_interval_ms,
+                           config.beat_interval_ms, NULL, NULL);
+        if (0 < config.limits.max_rss_kb || 0 < config.limits.max_fds ||
+            0 < config.limits.max_threads)
+        {
+            SchedulerAddTaskMs(sched, &CheckUsageTask, NULL, config.check_interval_ms,
+                               config.check_interval_ms, NULL, NULL);
+        }
+        if (0 < config.d_state_ms)
+        {
+            SchedulerAddTaskMs(sched, &CheckDStateTask, NULL, config.d_state_ms / 2,
+                               (config.d_state_ms + 1) / 2, NULL, NULL);
+        }
+        if (0 < config.kick_window_ms)
+        {
+            /* a stall is seen within 1.5 windows */
+            SchedulerAddTaskMs(sched, &CheckKickTask, NULL, config.kick_window_ms / 2,
+                               (config.kick_window_ms + 1) / 2, NULL, NULL);
+        }
+    }
+    else
+    {
+        for (i = 0; i < n_probes; ++i)
+        {
+            SchedulerAddTaskMs(sched, &ProbeTask, &probes[i], probes[i].interval_ms,
+                               probes[i].interval_ms, NULL, NULL);
+        }
+    }
+}
+
+static void CloseRegions(void)
+{
+    int i = 0;
+
+    for (i = 0; i < WD_MAX_REGIONS; ++i)
+    {
+        if (NULL != regions[i])
+        {
+            WDRegionClose(regions[i]);
+            regions[i] = NULL;
+        }
+    }
+}
+
+int WDStart(char **path)
+{
+    return (WDStartEx(path, NULL));
+}
+
+int WDStartEx(char **path, const wd_config_t *user_config)
+{
+    struct sigaction sig_act2 = {0};
+    char *wd_pid_str = NULL;
+    int status = 0;
+
+    assert(path);
+
+    if (NULL != user_config && NULL != user_config->supervisor_daemon)
+    {
+        /* a supervisor daemon watches this one */
+        SetConfig(user_config);
+
+        return (AttachDaemon(*path));
+    }
+
+    if (NULL != user_config && NULL != user_config->supervisor)
+    {
+        /* a shared supervisor process watches this one */
+        SetConfig(user_config);
+
+        return (AttachSupervisor(*path));
+    }
+
+    /* define stop signal handler */
+    sigemptyset(&sig_act2.sa_mask);
+    sig_act2.sa_flags = 0;
+    sig_act2.sa_handler = &SIGUSR2Handler;
+    sigaction(SIGUSR2, &sig_act2, NULL);
+
+    /* check if this is the user process or the watchdog process */
+    wd_pid_str = getenv("WD_PID");
+    is_watchdog = (NULL != wd_pid_str && atoi(wd_pid_str) == getpid());
+
+    SetConfig(is_watchdog ? NULL : user_config);
+
+    if (0 != OpenChannel())
+    {
+        return (WD_FAILED_TO_CREATE_WATCHDOG);
+    }
+
+    if (NULL == wd_pid_str)
+    {
+        /* watchdog process does not exist */
+        /* create child process for watchdog */
+        peer_pid = SpawnWatchdog(*path);
+        if (-1 == peer_pid)
+        {
+            return (WD_FAILED_TO_CREATE_CHILD_PROCESS);
+        }
+
+        if (!config.threadless)
+        {
+            sched = SchedulerCreate();
+            AddTasks(*path);
+        }
+
+        pthread_mutex_lock(&revive_lock);
+        status = WaitPeerReady();
+        pthread_mutex_unlock(&revive_lock);
+
+        if (0 != status || 0 != StartScheduler())
+        {
+            return (WD_FAILED_TO_CREATE_WATCHDOG);
+        }
+    }
+    else if (is_watchdog)
+    {
+        /* current process is watchdog */
+        peer_pid = getppid();
+
+        sched = SchedulerCreate();
+
+        AddTasks(*path);
+        WDChannelPostReady(channel);
+
+        if (config.hot_standby)
+        {
+            SpawnStandby(*path);
+        }
+
+        pthread_create(&death_thread, NULL, &DeathWatchFunc, *path);
+
+        SchedulerRun(sched);
+
+        /* no revive after the user process is told we stopped */
+        pthread_mutex_lock(&revive_lock);
+        stop_flag = 1;
+        pthread_mutex_unlock(&revive_lock);
+
+        WDChannelAckStop(channel);
+
+        SchedulerDestroy(sched);
+        WDChannelClose(channel);
+    }
+    else
+    {
+        peer_pid = atoi(wd_pid_str);
+
+        if (getpid() == WDChannelGetStandby(channel))
+        {
+            /* park here until the user process dies */
+            WaitForPromotion();
+        }
+
+        /* user process has been revived */
+        if (!config.threadless)
+        {
+            sched = SchedulerCreate();
+            AddTasks(*path);
+        }
+
+        WDChannelPostReady(channel);
+
+        if (0 != StartScheduler())
+        {
+            return (WD_FAILED_TO_CREATE_WATCHDOG);
+        }
+    }
+
+    return (0);
+}
+
+int WDThreadRegister(size_t deadline_ms, int action)
+{
+    if (NULL == channel)
+    {
+        return (-1);
+    }
+
+    return (WDChannelAddThread(channel, ProcStatGetTid(), deadline_ms, action));
+}
+
+void WDThreadKick(int thread)
+{
+    WDChannelKickThread(channel, thread);
+}
+
+void WDThreadUnregister(int thread)
+{
+    WDChannelRemoveThread(channel, thread);
+}
+
+int WDAddHealthProbe(int (*probe)(void *param), void *param, size_t interval_ms,
+                     size_t budget_ms, size_t max_breaches)
+{
+    health_probe_t *new_probe = NULL;
+
+    assert(probe);
+    assert(0 < interval_ms);
+
+    if (NULL != sched || WD_MAX_PROBES == n_probes)
+    {
+        return (-1);
+    }
+
+    new_probe = &probes[n_probes];
+    new_probe->probe = probe;
+    new_probe->param = param;
+    new_probe->interval_ms = interval_ms;
+    new_probe->budget_ms = budget_ms;
+    new_probe->max_breaches = (0 < max_breaches ? max_breaches : 1);
+
+    return ((int)n_probes++);
+}
+
+void WDGetProbeStats(int probe, wd_probe_stats_t *stats)
+{
+    assert(0 <= probe && (size_t)probe < n_probes);
+    assert(stats);
+
+    pthread_mutex_lock(&probe_lock);
+    *stats = probes[probe].stats;
+    pthread_mutex_unlock(&probe_lock);
+}
+
+void WDSetIdle(int is_idle)
+{
+    if (NULL != channel)
+    {
+        WDChannelSetIdle(channel, is_idle);
+    }
+}
+
+void WDReportProgress(void)
+{
+    WDChannelBeat(channel, WD_SIDE_USER);
+}
+
+int WDGetFd(void)
+{
+    return (event_fd);
+}
+
+int WDProcessEvents(void)
+{
+    uint64_t expirations = 0;
+
+    if (-1 == event_fd)
+    {
+        return (-1);
+    }
+
+    /* the fd is nonblocking, so this is safe when nothing expired */
+    if (sizeof(expirations) != read(event_fd, &expirations, sizeof(expirations)) &&
+        EAGAIN != errno)
+    {
+        return (-1);
+    }
+
+    if (SUCCESS != SchedulerRunDue(sched))
+    {
+        return (-1);
+    }
+
+    ArmEventFd();
+
+    return (0);
+}
+
+void WDGetStats(wd_stats_t *stats)
+{
+    assert(stats);
+
+    WDChannelGetStats(channel, WD_SIDE_USER, &stats->user);
+    WDChannelGetStats(channel, WD_SIDE_WATCHDOG, &stats->watchdog);
+}
+
+void WDGetRestartState(restart_state_t *state)
+{
+    assert(state);
+
+    WDChannelGetRestartState(channel, state);
+}
+
+long WDGetSpawnLatency(void)
+{
+    return (atomic_load(&spawn_latency_us));
+}
+
+void *WDRegisterPersistentRegion(const char *name, size_t size)
+{
+    char shm_name[WD_REGION_NAME_SIZE] = {'\0'};
+    int slot = 0;
+
+    assert(name);
+
+    if (NULL == channel || is_watchdog || NULL != strchr(name, '/') ||
+        strlen(getenv(CHANNEL_ENV)) + 1 + strlen(name) >= WD_REGION_NAME_SIZE)
+    {
+        return (NULL);
+    }
+
+    /* regions are named after the channel, so they are per instance */
+    sprintf(shm_name, "%s_%s", getenv(CHANNEL_ENV), name);
+
+    slot = WDChannelAddRegion(channel, shm_name);
+    if (-1 == slot)
+    {
+        return (NULL);
+    }
+
+    if (NULL == regions[slot])
+    {
+        regions[slot] = WDRegionOpen(shm_name, size);
+    }
+
+    return (regions[slot]);
+}
+
+unsigned long WDGetRegionGeneration(const void *region)
+{
+    return (WDRegionGetGeneration(region));
+}
+
+void WDStop(size_t timeout)
+{
+    WDStopMs(timeout * 1000);
+}
+
+void WDStopMs(size_t timeout_ms)
+{
+    if (NULL != registry || -1 != daemon_conn)
+    {
+        DetachSupervisor();
+        return;
+    }
+
+    /* stop our checks first, so the watchdog is not revived while it stops */
+    stop_flag = 1;
+    StopScheduler();
+
+    /* one request and one signal to wake the watchdog up, then wait */
+    WDChannelRequestStop(channel);
+    kill(peer_pid, SIGUSR2);
+
+    if (0 != WDChannelWaitStopAck(channel, timeout_ms))
+    {
+        kill(peer_pid, SIGKILL);
+    }
+
+    /* reap the watchdog if it is our child */
+    waitpid(peer_pid, NULL, 0);
+
+    unsetenv("WD_PID");
+
+    CloseRegions();
+    WDChannelUnlinkRegions(channel);
+
+    wd_kick_counter = &unwatched_kicks;
+
+    WDChannelClose(channel);
+    channel = NULL;
+    WDChannelUnlink(getenv(CHANNEL_ENV));
+    unsetenv(CHANNEL_ENV);
+    unsetenv(CONFIG_ENV);
+}
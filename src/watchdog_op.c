@@ -1,5 +1,6 @@
 #define _POSIX_C_SOURCE 200112L /* setenv */
 #include <stdlib.h>             /* setenv */
+#include <stdio.h>              /* sprintf */
 #include <sys/types.h>          /* getpid */
 #include <unistd.h>             /* getpid */
 
@@ -0,0 +1,457 @@
+#define _GNU_SOURCE             /* syscall */
+#include <sys/mman.h>    /* shm_unlink */
+#include <sys/syscall.h> /* SYS_futex */
+#include <linux/futex.h> /* FUTEX_WAIT */
+#include <unistd.h>      /* syscall */
+#include <time.h>        /* clock_gettime */
+#include <limits.h>      /* INT_MAX */
+#include <errno.h>       /* EINTR */
+#include <string.h>      /* memset, strlen, strcmp, strcpy */
+#include <stdio.h>       /* perror */
+#include <assert.h>      /* assert */
+
+#include "wdchannel.h"
+#include "wdshm.h"
+
+/* a few ms of reads: far longer than a write, unless its writer is dead */
+#define SEQ_MAX_SPINS (1000000)
+
+wd_channel_t *WDChannelOpen(const char *name)
+{
+    return ((wd_channel_t *)WDShmOpen(name, sizeof(wd_channel_t)));
+}
+
+int WDChannelInit(wd_channel_t *channel)
+{
+    assert(channel);
+
+    memset(channel, 0, sizeof(wd_channel_t));
+
+    if (-1 == sem_init(&channel->ready, 1, 0) || -1 == sem_init(&channel->standby, 1, 0))
+    {
+        perror("Failed to init channel semaphores");
+        return (-1);
+    }
+
+    return (0);
+}
+
+void WDChannelClose(wd_channel_t *channel)
+{
+    WDShmClose(channel, sizeof(wd_channel_t));
+}
+
+int WDChannelUnlink(const char *name)
+{
+    assert(name);
+
+    return (shm_unlink(name));
+}
+
+void WDChannelBeat(wd_channel_t *channel, int side)
+{
+    atomic_ulong *beat = NULL;
+
+    assert(channel);
+
+    /* single writer, so a plain increment is enough */
+    beat = &channel->sides[side].beat;
+    atomic_store_explicit(beat, atomic_load_explicit(beat, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+}
+
+unsigned long WDChannelGetBeat(wd_channel_t *channel, int side)
+{
+    assert(channel);
+
+    return (atomic_load_explicit(&channel->sides[side].beat, memory_order_relaxed));
+}
+
+void WDChannelSetStandby(wd_channel_t *channel, pid_t pid)
+{
+    assert(channel);
+
+    atomic_store(&channel->standby_pid, pid);
+}
+
+pid_t WDChannelGetStandby(wd_channel_t *channel)
+{
+    assert(channel);
+
+    return (atomic_load(&channel->standby_pid));
+}
+
+void WDChannelSetUnhealthy(wd_channel_t *channel, int is_unhealthy)
+{
+    assert(channel);
+
+    atomic_store(&channel->is_unhealthy, is_unhealthy);
+}
+
+int WDChannelIsUnhealthy(wd_channel_t *channel)
+{
+    assert(channel);
+
+    return (atomic_load(&channel->is_unhealthy));
+}
+
+void WDChannelSetIdle(wd_channel_t *channel, int is_idle)
+{
+    assert(channel);
+
+    atomic_store_explicit(&channel->is_idle, is_idle, memory_order_relaxed);
+}
+
+int WDChannelIsIdle(wd_channel_t *channel)
+{
+    assert(channel);
+
+    return (atomic_load_explicit(&channel->is_idle, memory_order_relaxed));
+}
+
+void WDChannelPostReady(wd_channel_t *channel)
+{
+    assert(channel);
+
+    sem_post(&channel->ready);
+}
+
+int WDChannelWaitReady(wd_channel_t *channel, size_t timeout_ms)
+{
+    struct timespec deadline = {0};
+    int status = 0;
+
+    assert(channel);
+
+    /* sem_timedwait takes a deadline on the wall clock */
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += (time_t)(timeout_ms / 1000);
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (1000000000L <= deadline.tv_nsec)
+    {
+        ++deadline.tv_sec;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    do
+    {
+        status = sem_timedwait(&channel->ready, &deadline);
+    }
+    while (-1 == status && EINTR == errno);
+
+    return (status);
+}
+
+void WDChannelPromoteStandby(wd_channel_t *channel)
+{
+    assert(channel);
+
+    sem_post(&channel->standby);
+}
+
+void WDChannelWaitPromotion(wd_channel_t *channel)
+{
+    int status = 0;
+
+    assert(channel);
+
+    do
+    {
+        status = sem_wait(&channel->standby);
+    }
+    while (-1 == status && EINTR == errno);
+}
+
+void WDChannelRequestStop(wd_channel_t *channel)
+{
+    assert(channel);
+
+    atomic_store(&channel->stop_request, 1);
+}
+
+int WDChannelIsStopRequested(wd_channel_t *channel)
+{
+    assert(channel);
+
+    return (atomic_load(&channel->stop_request));
+}
+
+void WDChannelAckStop(wd_channel_t *channel)
+{
+    assert(channel);
+
+    atomic_store(&channel->stop_ack, 1);
+    syscall(SYS_futex, &channel->stop_ack, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+static long TimeNowMs(void)
+{
+    struct timespec now = {0};
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec * 1000L + now.tv_nsec / 1000000L);
+}
+
+int WDChannelWaitStopAck(wd_channel_t *channel, size_t timeout_ms)
+{
+    struct timespec remaining = {0};
+    long deadline = TimeNowMs() + (long)timeout_ms;
+    long left = 0;
+
+    assert(channel);
+
+    /* the futex only sleeps while the word is still 0 */
+    while (!atomic_load(&channel->stop_ack))
+    {
+        left = deadline - TimeNowMs();
+        if (0 >= left)
+        {
+            return (-1);
+        }
+
+        remaining.tv_sec = left / 1000;
+        remaining.tv_nsec = (left % 1000) * 1000000L;
+        syscall(SYS_futex, &channel->stop_ack, FUTEX_WAIT, 0, &remaining, NULL, 0);
+    }
+
+    return (0);
+}
+
+/*
+a writer may be killed between WriteBegin and WriteEnd and leave the count
+odd. the next writer keeps it odd instead of inverting it, and a reader
+stops waiting after SEQ_MAX_SPINS and takes the copy as it is.
+*/
+static void WriteBegin(atomic_ulong *seq)
+{
+    atomic_store_explicit(seq, atomic_load_explicit(seq, memory_order_relaxed) | 1,
+                          memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+static void WriteEnd(atomic_ulong *seq)
+{
+    atomic_store_explicit(seq, atomic_load_explicit(seq, memory_order_relaxed) + 1,
+                          memory_order_release);
+}
+
+static unsigned long ReadBegin(atomic_ulong *seq)
+{
+    unsigned long begin = 0;
+    size_t spins = 0;
+
+    do
+    {
+        begin = atomic_load_explicit(seq, memory_order_acquire);
+    }
+    while ((begin & 1) && SEQ_MAX_SPINS > ++spins);
+
+    return (begin);
+}
+
+static int ReadRetry(atomic_ulong *seq, unsigned long begin)
+{
+    atomic_thread_fence(memory_order_acquire);
+
+    return (begin != atomic_load_explicit(seq, memory_order_relaxed));
+}
+
+long WDChannelRecordCrash(wd_channel_t *channel, const restart_policy_t *policy,
+                          long now_ms)
+{
+    long next_restart_ms = 0;
+
+    assert(channel);
+
+    WriteBegin(&channel->restart_seq);
+    next_restart_ms = RestartPolicyOnCrash(policy, &channel->restart, now_ms);
+    WriteEnd(&channel->restart_seq);
+
+    return (next_restart_ms);
+}
+
+void WDChannelRecordRestart(wd_channel_t *channel, long now_ms)
+{
+    assert(channel);
+
+    WriteBegin(&channel->restart_seq);
+    RestartPolicyOnRestart(&channel->restart, now_ms);
+    WriteEnd(&channel->restart_seq);
+}
+
+void WDChannelRecordRunning(wd_channel_t *channel, const restart_policy_t *policy,
+                            long now_ms)
+{
+    assert(channel);
+
+    /* the watchdog is the only writer, so it reads without the lock */
+    if (RestartPolicyIsStable(policy, &channel->restart, now_ms))
+    {
+        WriteBegin(&channel->restart_seq);
+        RestartPolicyOnStable(&channel->restart);
+        WriteEnd(&channel->restart_seq);
+    }
+}
+
+void WDChannelGetRestartState(wd_channel_t *channel, restart_state_t *state)
+{
+    unsigned long begin = 0;
+
+    assert(channel);
+    assert(state);
+
+    do
+    {
+        begin = ReadBegin(&channel->restart_seq);
+        *state = channel->restart;
+    }
+    while (ReadRetry(&channel->restart_seq, begin));
+}
+
+wd_side_stats_t *WDChannelStatsBegin(wd_channel_t *channel, int side)
+{
+    assert(channel);
+
+    WriteBegin(&channel->stats_seq[side]);
+
+    return (&channel->stats[side]);
+}
+
+void WDChannelStatsEnd(wd_channel_t *channel, int side)
+{
+    assert(channel);
+
+    WriteEnd(&channel->stats_seq[side]);
+}
+
+void WDChannelGetStats(wd_channel_t *channel, int side, wd_side_stats_t *stats)
+{
+    unsigned long begin = 0;
+
+    assert(channel);
+    assert(stats);
+
+    do
+    {
+        begin = ReadBegin(&channel->stats_seq[side]);
+        *stats = channel->stats[side];
+    }
+    while (ReadRetry(&channel->stats_seq[side], begin));
+}
+
+int WDChannelAddThread(wd_channel_t *channel, pid_t tid, unsigned long deadline_ms,
+                       int action)
+{
+    wd_thread_slot_t *slot = NULL;
+    int state = WD_THREAD_FREE;
+    int i = 0;
+
+    assert(channel);
+
+    for (i = 0; i < WD_MAX_THREADS; ++i)
+    {
+        slot = &channel->threads[i];
+        state = WD_THREAD_FREE;
+
+        if (atomic_compare_exchange_strong(&slot->state, &state, WD_THREAD_CLAIMED))
+        {
+            slot->deadline_ms = deadline_ms;
+            slot->action = action;
+            atomic_store(&slot->tid, tid);
+            atomic_fetch_add(&slot->serial, 1);
+
+            /* the watchdog reads the fields above after it sees the state */
+            atomic_store(&slot->state, WD_THREAD_ACTIVE);
+
+            return (i);
+        }
+    }
+
+    return (-1);
+}
+
+void WDChannelRemoveThread(wd_channel_t *channel, int thread)
+{
+    assert(channel);
+
+    atomic_store(&channel->threads[thread].state, WD_THREAD_FREE);
+}
+
+void WDChannelClearThreads(wd_channel_t *channel)
+{
+    int i = 0;
+
+    assert(channel);
+
+    for (i = 0; i < WD_MAX_THREADS; ++i)
+    {
+        WDChannelRemoveThread(channel, i);
+    }
+}
+
+void WDChannelKickThread(wd_channel_t *channel, int thread)
+{
+    atomic_ulong *progress = NULL;
+
+    assert(channel);
+
+    progress = &channel->threads[thread].progress;
+    atomic_store_explicit(progress, atomic_load_explicit(progress, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+}
+
+int WDChannelAddRegion(wd_channel_t *channel, const char *name)
+{
+    wd_region_slot_t *slot = NULL;
+    int state = WD_REGION_FREE;
+    int i = 0;
+
+    assert(channel);
+    assert(name);
+    assert(strlen(name) < WD_REGION_NAME_SIZE);
+
+    /* a revived process registers the regions of its predecessor again */
+    for (i = 0; i < WD_MAX_REGIONS; ++i)
+    {
+        slot = &channel->regions[i];
+        if (WD_REGION_ACTIVE == atomic_load(&slot->state) && 0 == strcmp(slot->name, name))
+        {
+            return (i);
+        }
+    }
+
+    for (i = 0; i < WD_MAX_REGIONS; ++i)
+    {
+        slot = &channel->regions[i];
+        state = WD_REGION_FREE;
+
+        if (atomic_compare_exchange_strong(&slot->state, &state, WD_REGION_CLAIMED))
+        {
+            strcpy(slot->name, name);
+            atomic_store(&slot->state, WD_REGION_ACTIVE);
+
+            return (i);
+        }
+    }
+
+    return (-1);
+}
+
+void WDChannelUnlinkRegions(wd_channel_t *channel)
+{
+    wd_region_slot_t *slot = NULL;
+    int i = 0;
+
+    assert(channel);
+
+    for (i = 0; i < WD_MAX_REGIONS; ++i)
+    {
+        slot = &channel->regions[i];
+        if (WD_REGION_ACTIVE == atomic_load(&slot->state))
+        {
+            shm_unlink(slot->name);
+            atomic_store(&slot->state, WD_REGION_FREE);
+        }
+    }
+}
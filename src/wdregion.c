@@ -0,0 +1,57 @@
+#include <string.h> /* memset */
+#include <assert.h> /* assert */
+
+#include "wdregion.h"
+#include "wdshm.h"
+
+static wd_region_header_t *GetHeader(const void *data)
+{
+    return ((wd_region_header_t *)((char *)data - WD_REGION_HEADER_SIZE));
+}
+
+void *WDRegionOpen(const char *name, size_t size)
+{
+    wd_region_header_t *header = NULL;
+
+    assert(name);
+
+    header = (wd_region_header_t *)WDShmOpen(name, WD_REGION_HEADER_SIZE + size);
+    if (NULL == header)
+    {
+        return (NULL);
+    }
+
+    if (WD_REGION_MAGIC == header->magic && WD_REGION_VERSION == header->version &&
+        size == header->size)
+    {
+        atomic_fetch_add(&header->generation, 1);
+    }
+    else
+    {
+        /* new, or left by another build of the program */
+        memset((char *)header + WD_REGION_HEADER_SIZE, 0, size);
+        header->version = WD_REGION_VERSION;
+        header->size = size;
+        atomic_store(&header->generation, 1);
+        header->magic = WD_REGION_MAGIC;
+    }
+
+    return ((char *)header + WD_REGION_HEADER_SIZE);
+}
+
+void WDRegionClose(void *data)
+{
+    wd_region_header_t *header = NULL;
+
+    assert(data);
+
+    header = GetHeader(data);
+    WDShmClose(header, WD_REGION_HEADER_SIZE + header->size);
+}
+
+unsigned long WDRegionGetGeneration(const void *data)
+{
+    assert(data);
+
+    return (atomic_load(&GetHeader(data)->generation));
+}
@@ -0,0 +1,57 @@
+#define _POSIX_C_SOURCE 200112L
+#include <sys/mman.h>  /* shm_open, mmap */
+#include <sys/stat.h>  /* fstat, modes */
+#include <fcntl.h>     /* O constants */
+#include <unistd.h>    /* ftruncate, close */
+#include <assert.h>    /* assert */
+#include <stdio.h>     /* perror */
+
+#include "wdshm.h"
+
+void *WDShmOpen(const char *name, size_t size)
+{
+    int fd = -1;
+    struct stat st = {0};
+    void *addr = NULL;
+
+    assert(name);
+
+    fd = shm_open(name, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+    if (-1 == fd)
+    {
+        perror("Failed to open shm object");
+        return (NULL);
+    }
+
+    if (-1 == fstat(fd, &st))
+    {
+        perror("Failed to stat shm object");
+        close(fd);
+        return (NULL);
+    }
+
+    /* a new object is zero-filled when it is extended */
+    if ((size_t)st.st_size < size && -1 == ftruncate(fd, size))
+    {
+        perror("Failed to size shm object");
+        close(fd);
+        return (NULL);
+    }
+
+    addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == addr)
+    {
+        perror("Failed to map shm object");
+        return (NULL);
+    }
+
+    return (addr);
+}
+
+void WDShmClose(void *addr, size_t size)
+{
+    assert(addr);
+
+    munmap(addr, size);
+}
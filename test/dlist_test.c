@@ -0,0 +1,429 @@
+#define _POSIX_C_SOURCE 200112L /* fork */
+#include <pthread.h>   /* pthread_create */
+#include <stdio.h>     /* printf */
+#include <stdlib.h>    /* calloc */
+#include <sys/types.h> /* pid_t */
+#include <sys/wait.h>  /* waitpid */
+#include <unistd.h>    /* fork */
+
+#include "dlist.h"
+#include "sortlist.h"
+
+/*
+tests of the parallel range functions of the doubly linked list and the
+sorted list, on empty, single-element, short and long ranges, on ranges
+around the threshold, from several threads at once, and after a fork.
+*/
+
+#define N_LONG (3 * DLIST_PARALLEL_THRESHOLD + 123)
+#define N_THREADS (4)
+#define N_REPEATS (20)
+
+/* the data of element i points to its counter, counts[i] */
+typedef struct Range
+{
+    dlist_t *list;
+    size_t *counts;
+    size_t size;
+} range_t;
+
+static size_t total_errors = 0;
+
+static void Check(int is_ok, const char *what)
+{
+    if (!is_ok)
+    {
+        printf("FAIL: %s\n", what);
+        ++total_errors;
+    }
+}
+
+static int CreateRange(range_t *range, size_t size)
+{
+    size_t i = 0;
+
+    range->list = DListCreate();
+    range->counts = (size_t *)calloc(size + 1, sizeof(size_t));
+    range->size = size;
+
+    if (NULL == range->list || NULL == range->counts)
+    {
+        return (1);
+    }
+
+    for (i = 0; i < size; ++i)
+    {
+        if (DListEnd(range->list) == DListPushBack(range->list, &range->counts[i]))
+        {
+            return (1);
+        }
+    }
+
+    return (0);
+}
+
+static void DestroyRange(range_t *range)
+{
+    if (NULL != range->list)
+    {
+        DListDestroy(range->list);
+    }
+    free(range->counts);
+}
+
+static int Count(void *data, void *param)
+{
+    (void)param;
+    ++*(size_t *)data;
+
+    return (0);
+}
+
+/* fails with index + 1 on the elements whose index is a multiple of the size
+   in param, except the first one */
+static int CountAndFail(void *data, void *param)
+{
+    size_t *counts = ((range_t *)param)->counts;
+    size_t every = ((range_t *)param)->size;
+    size_t index = (size_t *)data - counts;
+
+    ++*(size_t *)data;
+
+    return (0 != index && 0 == index % every ? (int)index + 1 : 0);
+}
+
+static int IsOdd(void *data, const void *param)
+{
+    return (1 == ((size_t *)data - (const size_t *)param) % 2);
+}
+
+/* every element of [0, size) was counted once */
+static int IsCountedOnce(const range_t *range)
+{
+    size_t i = 0;
+
+    for (i = 0; i < range->size; ++i)
+    {
+        if (1 != range->counts[i])
+        {
+            return (0);
+        }
+    }
+
+    return (1);
+}
+
+static int IsSameList(dlist_t *list1, dlist_t *list2)
+{
+    dlist_iter_t iter1 = DListBegin(list1);
+    dlist_iter_t iter2 = DListBegin(list2);
+
+    while (DListEnd(list1) != iter1 && DListEnd(list2) != iter2 &&
+           DListGetData(iter1) == DListGetData(iter2))
+    {
+        iter1 = DListNext(iter1);
+        iter2 = DListNext(iter2);
+    }
+
+    return (DListEnd(list1) == iter1 && DListEnd(list2) == iter2);
+}
+
+static void TestForEach(size_t size)
+{
+    range_t range = {0};
+
+    if (0 != CreateRange(&range, size))
+    {
+        Check(0, "create a range");
+        DestroyRange(&range);
+        return;
+    }
+
+    Check(0 == DListParallelForEach(DListBegin(range.list), DListEnd(range.list),
+                                    &Count, NULL), "parallel for each");
+    Check(IsCountedOnce(&range), "parallel for each visits every element once");
+
+    DestroyRange(&range);
+}
+
+static void TestForEachFails(void)
+{
+    range_t range = {0};
+    range_t every = {0};
+    size_t i = 0;
+
+    if (0 != CreateRange(&range, N_LONG))
+    {
+        Check(0, "create a range");
+        DestroyRange(&range);
+        return;
+    }
+
+    /* the first failure is in the last chunks, the others after it */
+    every.counts = range.counts;
+    every.size = N_LONG - DLIST_PARALLEL_CHUNK / 2;
+    Check((int)every.size + 1 == DListParallelForEach(DListBegin(range.list),
+                                                      DListEnd(range.list),
+                                                      &CountAndFail, &every),
+          "parallel for each returns the failure");
+
+    for (i = 0; i < N_LONG; ++i)
+    {
+        range.counts[i] = 0;
+    }
+
+    /* many failures: the first one in range order is returned */
+    every.size = DLIST_PARALLEL_CHUNK + 1;
+    Check((int)every.size + 1 == DListParallelForEach(DListBegin(range.list),
+                                                      DListEnd(range.list),
+                                                      &CountAndFail, &every),
+          "parallel for each returns the first failure in range order");
+
+    /* the chunks before the first failure are all done */
+    for (i = 0; i <= every.size && 1 == range.counts[i]; ++i)
+    {
+    }
+    Check(i > every.size, "parallel for each finishes the chunks before a failure");
+
+    DestroyRange(&range);
+}
+
+static void TestMultiFind(dlist_iter_t from, dlist_iter_t to, const size_t *counts)
+{
+    dlist_t *expected = DListCreate();
+    dlist_t *found = DListCreate();
+
+    if (NULL == expected || NULL == found)
+    {
+        Check(0, "create output lists");
+    }
+    else
+    {
+        Check(DListMultiFind(from, to, &IsOdd, counts, expected) ==
+              DListParallelMultiFind(from, to, &IsOdd, counts, found),
+              "parallel multi find returns like multi find");
+        Check(IsSameList(expected, found), "parallel multi find finds like multi find");
+    }
+
+    if (NULL != expected)
+    {
+        DListDestroy(expected);
+    }
+    if (NULL != found)
+    {
+        DListDestroy(found);
+    }
+}
+
+static void TestMultiFindSizes(size_t size)
+{
+    range_t range = {0};
+    dlist_iter_t middle = NULL;
+    size_t i = 0;
+
+    if (0 != CreateRange(&range, size))
+    {
+        Check(0, "create a range");
+        DestroyRange(&range);
+        return;
+    }
+
+    TestMultiFind(DListBegin(range.list), DListEnd(range.list), range.counts);
+
+    /* a range that starts and ends inside the list */
+    if (0 != size)
+    {
+        middle = DListBegin(range.list);
+        for (i = 0; i < size / 3; ++i)
+        {
+            middle = DListNext(middle);
+        }
+        TestMultiFind(middle, DListPrev(DListEnd(range.list)), range.counts);
+    }
+
+    DestroyRange(&range);
+}
+
+static void TestEdgeRanges(void)
+{
+    range_t range = {0};
+    dlist_t *found = DListCreate();
+    dlist_iter_t first = NULL;
+
+    if (0 != CreateRange(&range, 1) || NULL == found)
+    {
+        Check(0, "create a range");
+        DestroyRange(&range);
+        return;
+    }
+
+    first = DListBegin(range.list);
+
+    /* an empty range, in a list that is not empty */
+    Check(0 == DListParallelForEach(first, first, &Count, NULL), "for each on an empty range");
+    Check(0 == range.counts[0], "for each on an empty range does nothing");
+    Check(0 == DListParallelMultiFind(first, first, &IsOdd, range.counts, found),
+          "multi find on an empty range");
+    Check(DListIsEmpty(found), "multi find on an empty range finds nothing");
+
+    /* a single element */
+    Check(0 == DListParallelForEach(first, DListEnd(range.list), &Count, NULL),
+          "for each on a single element");
+    Check(1 == range.counts[0], "for each on a single element visits it");
+    Check(0 == DListParallelMultiFind(first, DListEnd(range.list), &IsOdd, range.counts, found),
+          "multi find on a single element");
+
+    DListDestroy(found);
+    DestroyRange(&range);
+
+    /* an empty list */
+    CreateRange(&range, 0);
+    Check(0 == DListParallelForEach(DListBegin(range.list), DListEnd(range.list), &Count, NULL),
+          "for each on an empty list");
+    DestroyRange(&range);
+}
+
+static int CompareCounts(void *data1, const void *data2)
+{
+    return (((const size_t *)data1 > (const size_t *)data2) -
+            ((const size_t *)data1 < (const size_t *)data2));
+}
+
+static void TestSortList(size_t size)
+{
+    sort_list_t *list = SortListCreate(&CompareCounts);
+    range_t range = {0};
+    size_t i = 0;
+
+    range.counts = (size_t *)calloc(size + 1, sizeof(size_t));
+    range.size = size;
+
+    if (NULL == list || NULL == range.counts)
+    {
+        Check(0, "create a sorted list");
+    }
+    else
+    {
+        /* from the largest down, so each one goes in at the front */
+        for (i = size; 0 < i; --i)
+        {
+            SortListInsert(list, &range.counts[i - 1]);
+        }
+
+        Check(0 == SortListParallelForEach(SortListBegin(list), SortListEnd(list),
+                                           &Count, NULL), "sorted list parallel for each");
+        Check(IsCountedOnce(&range), "sorted list parallel for each visits every element once");
+
+        /* an empty range */
+        Check(0 == SortListParallelForEach(SortListEnd(list), SortListEnd(list),
+                                           &Count, NULL), "sorted list for each on an empty range");
+        Check(IsCountedOnce(&range), "sorted list for each on an empty range does nothing");
+    }
+
+    if (NULL != list)
+    {
+        SortListDestroy(list);
+    }
+    free(range.counts);
+}
+
+static void *RepeatForEach(void *param)
+{
+    range_t *range = (range_t *)param;
+    size_t i = 0;
+    int status = 0;
+
+    for (i = 0; i < N_REPEATS && 0 == status; ++i)
+    {
+        status = DListParallelForEach(DListBegin(range->list), DListEnd(range->list),
+                                      &Count, NULL);
+    }
+
+    return (0 == status ? NULL : range);
+}
+
+static void TestManyThreads(void)
+{
+    pthread_t threads[N_THREADS];
+    range_t ranges[N_THREADS];
+    void *failed = NULL;
+    size_t i = 0;
+    size_t j = 0;
+
+    for (i = 0; i < N_THREADS; ++i)
+    {
+        if (0 != CreateRange(&ranges[i], DLIST_PARALLEL_THRESHOLD + i))
+        {
+            Check(0, "create a range");
+        }
+        pthread_create(&threads[i], NULL, &RepeatForEach, &ranges[i]);
+    }
+
+    /* the threads share the pool, or do their ranges on their own */
+    for (i = 0; i < N_THREADS; ++i)
+    {
+        pthread_join(threads[i], &failed);
+        Check(NULL == failed, "parallel for each from many threads");
+
+        for (j = 0; j < ranges[i].size && N_REPEATS == ranges[i].counts[j]; ++j)
+        {
+        }
+        Check(ranges[i].size == j, "parallel for each from many threads visits every element");
+
+        DestroyRange(&ranges[i]);
+    }
+}
+
+static void TestFork(void)
+{
+    range_t range = {0};
+    pid_t child = 0;
+    int status = 0;
+
+    /* the pool of the parent is up before the fork */
+    TestForEach(N_LONG);
+
+    child = fork();
+    if (0 == child)
+    {
+        /* the child has none of the threads of the parent */
+        _exit(0 == CreateRange(&range, N_LONG) &&
+              0 == DListParallelForEach(DListBegin(range.list), DListEnd(range.list),
+                                        &Count, NULL) &&
+              IsCountedOnce(&range) ? 0 : 1);
+    }
+
+    Check(-1 != child && child == waitpid(child, &status, 0) &&
+          WIFEXITED(status) && 0 == WEXITSTATUS(status),
+          "parallel for each in a forked child");
+}
+
+int main()
+{
+    size_t sizes[] = {0, 1, 2, DLIST_PARALLEL_CHUNK, DLIST_PARALLEL_THRESHOLD - 1,
+                      DLIST_PARALLEL_THRESHOLD, DLIST_PARALLEL_THRESHOLD + 1, N_LONG};
+    size_t i = 0;
+
+    TestEdgeRanges();
+
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+    {
+        TestForEach(sizes[i]);
+        TestMultiFindSizes(sizes[i]);
+        TestSortList(sizes[i]);
+    }
+
+    TestForEachFails();
+    TestManyThreads();
+    TestFork();
+
+    if (0 != total_errors)
+    {
+        printf("dlist: %lu checks failed\n", (unsigned long)total_errors);
+        return (1);
+    }
+
+    printf("dlist: all tests passed\n");
+
+    return (0);
+}
@@ -0,0 +1,270 @@
+#include <stdio.h>  /* printf */
+#include <stdlib.h> /* calloc */
+
+#include "hashmap.h"
+
+/*
+tests of the Robin Hood hash map. the random runs keep a plain array of
+what the map should hold and compare the two after every change, so the
+backward shift of a removal is checked on every kind of cluster.
+*/
+
+#define N_KEYS (4096)
+#define N_RESIZE (100000)
+#define N_CHURN (1000000)
+#define CHURN_SIZE (14)
+
+static size_t total_errors = 0;
+
+static void Check(int is_ok, const char *what)
+{
+    if (!is_ok)
+    {
+        printf("FAIL: %s\n", what);
+        ++total_errors;
+    }
+}
+
+static unsigned long Random(unsigned long *seed)
+{
+    *seed = *seed * 1103515245UL + 12345UL;
+
+    return ((*seed >> 16) & 0x7fff);
+}
+
+static ilrd_uid_t MakeKey(size_t i)
+{
+    ilrd_uid_t key = {0};
+
+    key.host = 1;
+    key.serial = i;
+
+    return (key);
+}
+
+/* the data of key i is i + 1, so it is never NULL */
+static void *MakeData(size_t i)
+{
+    return ((void *)(i + 1));
+}
+
+static int CountData(void *data, void *param)
+{
+    size_t *sum = (size_t *)param;
+
+    *sum += (size_t)data;
+
+    return (0);
+}
+
+static int StopAtData(void *data, void *param)
+{
+    return (data == param ? 7 : 0);
+}
+
+static void TestBasic(void)
+{
+    hash_map_t *map = HashMapCreate(0);
+    size_t sum = 0;
+
+    Check(NULL != map, "create");
+    if (NULL == map)
+    {
+        return;
+    }
+
+    Check(HashMapIsEmpty(map), "empty after create");
+    Check(NULL == HashMapFind(map, MakeKey(1)), "find in an empty map");
+    Check(NULL == HashMapRemove(map, MakeKey(1)), "remove from an empty map");
+
+    Check(0 == HashMapInsert(map, MakeKey(1), MakeData(1)), "insert");
+    Check(0 == HashMapInsert(map, MakeKey(2), MakeData(2)), "insert");
+    Check(1 == HashMapInsert(map, MakeKey(1), MakeData(3)), "insert an existing key");
+    Check(2 == HashMapSize(map), "size after insert");
+    Check(MakeData(1) == HashMapFind(map, MakeKey(1)), "find keeps the first data");
+
+    Check(0 == HashMapForEach(map, &CountData, &sum) && 5 == sum, "for each");
+    Check(7 == HashMapForEach(map, &StopAtData, MakeData(2)), "for each stops");
+
+    Check(MakeData(2) == HashMapRemove(map, MakeKey(2)), "remove");
+    Check(NULL == HashMapRemove(map, MakeKey(2)), "remove twice");
+    Check(1 == HashMapSize(map), "size after remove");
+
+    HashMapClear(map);
+    Check(HashMapIsEmpty(map), "empty after clear");
+    Check(NULL == HashMapFind(map, MakeKey(1)), "find after clear");
+    Check(0 == HashMapInsert(map, MakeKey(1), MakeData(1)), "insert after clear");
+
+    HashMapDestroy(map);
+}
+
+static void TestResize(void)
+{
+    hash_map_t *map = HashMapCreate(0);
+    size_t n_found = 0;
+    size_t i = 0;
+
+    Check(NULL != map, "create");
+    if (NULL == map)
+    {
+        return;
+    }
+
+    /* grows from the smallest table many times over */
+    for (i = 0; i < N_RESIZE; ++i)
+    {
+        if (0 != HashMapInsert(map, MakeKey(i), MakeData(i)))
+        {
+            Check(0, "insert while growing");
+            break;
+        }
+    }
+
+    Check(N_RESIZE == HashMapSize(map), "size after growing");
+
+    for (i = 0; i < N_RESIZE; ++i)
+    {
+        n_found += (MakeData(i) == HashMapFind(map, MakeKey(i)));
+    }
+    Check(N_RESIZE == n_found, "every element is found after growing");
+    Check(NULL == HashMapFind(map, MakeKey(N_RESIZE)), "a missing key after growing");
+
+    HashMapDestroy(map);
+}
+
+/* compare the map with what it should hold */
+static int IsSame(const hash_map_t *map, const unsigned char *is_in, size_t size)
+{
+    size_t n_in = 0;
+    size_t i = 0;
+
+    for (i = 0; i < N_KEYS; ++i)
+    {
+        if (HashMapFind(map, MakeKey(i)) != (is_in[i] ? MakeData(i) : NULL))
+        {
+            return (0);
+        }
+
+        n_in += is_in[i];
+    }
+
+    return (n_in == size && size == HashMapSize(map));
+}
+
+static void TestRandom(void)
+{
+    unsigned char *is_in = (unsigned char *)calloc(N_KEYS, 1);
+    /* starts from the smallest table, so it also grows while it changes */
+    hash_map_t *map = HashMapCreate(0);
+    unsigned long seed = 1;
+    size_t size = 0;
+    size_t key = 0;
+    size_t i = 0;
+
+    Check(NULL != map && NULL != is_in, "create");
+    if (NULL == map || NULL == is_in)
+    {
+        free(is_in);
+        if (NULL != map)
+        {
+            HashMapDestroy(map);
+        }
+        return;
+    }
+
+    for (i = 0; i < 20000; ++i)
+    {
+        key = Random(&seed) % N_KEYS;
+
+        /* grow to about half the keys, then hover there */
+        if (0 == is_in[key] && (size < N_KEYS / 2 || 0 == Random(&seed) % 2))
+        {
+            Check(0 == HashMapInsert(map, MakeKey(key), MakeData(key)), "random insert");
+            is_in[key] = 1;
+            ++size;
+        }
+        else if (1 == is_in[key])
+        {
+            Check(MakeData(key) == HashMapRemove(map, MakeKey(key)), "random remove");
+            is_in[key] = 0;
+            --size;
+        }
+
+        if (0 == i % 97 && !IsSame(map, is_in, size))
+        {
+            Check(0, "map matches after random changes");
+            break;
+        }
+    }
+
+    /* removing everything shifts back every cluster down to nothing */
+    for (key = 0; key < N_KEYS; ++key)
+    {
+        if (is_in[key])
+        {
+            Check(MakeData(key) == HashMapRemove(map, MakeKey(key)), "remove all");
+            is_in[key] = 0;
+            --size;
+        }
+    }
+    Check(IsSame(map, is_in, 0) && HashMapIsEmpty(map), "empty after removing all");
+
+    HashMapDestroy(map);
+    free(is_in);
+}
+
+static void TestChurn(void)
+{
+    hash_map_t *map = HashMapCreate(0);
+    size_t is_ok = 1;
+    size_t i = 0;
+
+    Check(NULL != map, "create");
+    if (NULL == map)
+    {
+        return;
+    }
+
+    /* a map with tombstones would fill up with them here, and a search for
+       a missing key would walk the whole table or never end. removal
+       shifts elements back instead, so nothing is left behind. */
+    for (i = 0; i < N_CHURN && is_ok; ++i)
+    {
+        is_ok = (0 == HashMapInsert(map, MakeKey(i), MakeData(i)));
+
+        if (CHURN_SIZE <= i)
+        {
+            is_ok = is_ok &&
+                    MakeData(i - CHURN_SIZE) == HashMapRemove(map, MakeKey(i - CHURN_SIZE)) &&
+                    NULL == HashMapFind(map, MakeKey(i - CHURN_SIZE));
+        }
+    }
+
+    Check(is_ok, "insert and remove many times at a fixed size");
+    Check(CHURN_SIZE == HashMapSize(map), "size after churn");
+
+    for (i = N_CHURN - CHURN_SIZE; i < N_CHURN; ++i)
+    {
+        Check(MakeData(i) == HashMapFind(map, MakeKey(i)), "find after churn");
+    }
+
+    HashMapDestroy(map);
+}
+
+int main()
+{
+    TestBasic();
+    TestResize();
+    TestRandom();
+    TestChurn();
+
+    if (0 != total_errors)
+    {
+        printf("hashmap: %lu checks failed\n", (unsigned long)total_errors);
+        return (1);
+    }
+
+    printf("hashmap: all tests passed\n");
+
+    return (0);
+}
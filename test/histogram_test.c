@@ -0,0 +1,126 @@
+#include <limits.h> /* ULONG_MAX */
+#include <stdio.h>  /* printf */
+#include <string.h> /* memset */
+
+#include "histogram.h"
+
+/*
+tests of the log2 histograms: the bucket of every power of two and of the
+values next to it, values past the last bucket, and percentiles as the upper
+bound of their bucket or the max when it is smaller.
+*/
+
+#define N_VALUES (1000)
+
+static size_t total_errors = 0;
+
+static void Check(int is_ok, const char *what)
+{
+    if (!is_ok)
+    {
+        printf("FAIL: %s\n", what);
+        ++total_errors;
+    }
+}
+
+/* says whether the only value in the histogram is in this bucket */
+static int IsInBucket(unsigned long value_us, unsigned int bucket)
+{
+    histogram_t hist;
+
+    memset(&hist, 0, sizeof(hist));
+
+    HistogramAdd(&hist, value_us);
+
+    return (1 == hist.counts[bucket] && 1 == hist.count);
+}
+
+static void TestEmpty(void)
+{
+    histogram_t hist;
+
+    memset(&hist, 0, sizeof(hist));
+
+    Check(0 == HistogramPercentile(&hist, 50), "the percentile of an empty histogram");
+    Check(0 == HistogramPercentile(&hist, 100), "the max of an empty histogram");
+    Check(0 == HistogramMean(&hist), "the mean of an empty histogram");
+}
+
+static void TestBuckets(void)
+{
+    unsigned int i = 0;
+
+    Check(IsInBucket(0, 0) && IsInBucket(1, 0), "bucket 0 holds 0 and 1");
+
+    /* bucket i holds [2^i, 2^(i+1)) */
+    for (i = 1; i < HISTOGRAM_BUCKETS - 1; ++i)
+    {
+        Check(IsInBucket(1UL << i, i), "a power of two starts its bucket");
+        Check(IsInBucket((2UL << i) - 1, i), "the value before the next power ends the bucket");
+    }
+
+    Check(IsInBucket(1UL << (HISTOGRAM_BUCKETS - 1), HISTOGRAM_BUCKETS - 1),
+          "the start of the last bucket");
+    Check(IsInBucket(ULONG_MAX, HISTOGRAM_BUCKETS - 1), "values past the last bucket go to it");
+}
+
+static void TestPercentile(void)
+{
+    histogram_t hist;
+    unsigned long i = 0;
+
+    memset(&hist, 0, sizeof(hist));
+
+    /* 1 to 1000 */
+    for (i = 1; i <= N_VALUES; ++i)
+    {
+        HistogramAdd(&hist, i);
+    }
+
+    Check(N_VALUES == hist.count && N_VALUES == hist.max_us, "count and max");
+    Check(500 == HistogramMean(&hist), "the mean");
+    Check(1 == HistogramPercentile(&hist, 0), "the lowest value is in bucket 0");
+    Check(127 == HistogramPercentile(&hist, 10), "the 10th percentile is in [64, 128)");
+    Check(511 == HistogramPercentile(&hist, 50), "the median is in [256, 512)");
+    Check(N_VALUES == HistogramPercentile(&hist, 100), "the max bounds the last bucket in use");
+}
+
+static void TestPercentileMax(void)
+{
+    histogram_t hist;
+    size_t i = 0;
+
+    memset(&hist, 0, sizeof(hist));
+
+    /* the bucket of 100 is [64, 128), and the max is tighter */
+    for (i = 0; i < 10; ++i)
+    {
+        HistogramAdd(&hist, 100);
+    }
+
+    Check(100 == HistogramPercentile(&hist, 50) && 100 == HistogramMean(&hist),
+          "values that are all the same");
+
+    /* the last bucket has no upper bound but the max */
+    HistogramAdd(&hist, ULONG_MAX / 2);
+    Check(ULONG_MAX / 2 == HistogramPercentile(&hist, 100), "the max of the last bucket");
+    Check(127 == HistogramPercentile(&hist, 50), "a large value leaves the median");
+}
+
+int main()
+{
+    TestEmpty();
+    TestBuckets();
+    TestPercentile();
+    TestPercentileMax();
+
+    if (0 != total_errors)
+    {
+        printf("histogram: %lu checks failed\n", (unsigned long)total_errors);
+        return (1);
+    }
+
+    printf("histogram: all tests passed\n");
+
+    return (0);
+}
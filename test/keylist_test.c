@@ -0,0 +1,245 @@
+#include <stdio.h>  /* printf */
+
+/* the compare kernels are static, so they are tested from inside the file */
+#include "../src/keylist.c"
+
+/*
+tests of the key list compare kernels. every kernel this build and this CPU
+have must count the same keys as the scalar loop, on random keys and on the
+keys where the SSE2 emulation of a signed 64-bit compare can go wrong: equal
+high halves, low halves with the top bit set, and the ends of the range.
+*/
+
+#define N_RANDOM (200000)
+#define MAX_SCAN (2 * SCAN_WIDTH + 3)
+#define N_LIST (20000)
+
+static size_t total_errors = 0;
+
+static void Check(int is_ok, const char *what)
+{
+    if (!is_ok)
+    {
+        printf("FAIL: %s\n", what);
+        ++total_errors;
+    }
+}
+
+static unsigned long Random(unsigned long *seed)
+{
+    *seed = *seed * 1103515245UL + 12345UL;
+
+    return ((*seed >> 16) & 0x7fff);
+}
+
+static klist_key_t MakeKey(uint32_t high, uint32_t low)
+{
+    return ((klist_key_t)(((uint64_t)high << 32) | low));
+}
+
+/* the keys around every place a 32-bit half changes sign or carries */
+static const uint32_t halves[] =
+{
+    0x00000000, 0x00000001, 0x7ffffffe, 0x7fffffff,
+    0x80000000, 0x80000001, 0xfffffffe, 0xffffffff
+};
+
+#define N_HALVES (sizeof(halves) / sizeof(halves[0]))
+#define N_EDGES (N_HALVES * N_HALVES)
+
+static klist_key_t edges[N_EDGES];
+
+static void MakeEdges(void)
+{
+    size_t i = 0;
+
+    for (i = 0; i < N_EDGES; ++i)
+    {
+        edges[i] = MakeKey(halves[i / N_HALVES], halves[i % N_HALVES]);
+    }
+}
+
+/* a random key, often one of the edge keys or next to one */
+static klist_key_t RandomKey(unsigned long *seed)
+{
+    klist_key_t key = MakeKey((uint32_t)(Random(seed) << 17 ^ Random(seed) << 2 ^ Random(seed)),
+                              (uint32_t)(Random(seed) << 17 ^ Random(seed) << 2 ^ Random(seed)));
+
+    switch (Random(seed) % 4)
+    {
+        case 0:
+            return (edges[Random(seed) % N_EDGES]);
+        case 1:
+            /* the same high half as an edge key */
+            return (MakeKey((uint32_t)((uint64_t)edges[Random(seed) % N_EDGES] >> 32),
+                            (uint32_t)key));
+        default:
+            return (key);
+    }
+}
+
+static void TestKernel(scan_less_t kernel, const char *name)
+{
+    klist_key_t keys[MAX_SCAN];
+    klist_key_t key = 0;
+    unsigned long seed = 7;
+    size_t n_wrong = 0;
+    size_t n = 0;
+    size_t i = 0;
+    size_t j = 0;
+
+    /* every edge key against every other one, on every lane */
+    for (i = 0; i < N_EDGES; ++i)
+    {
+        for (j = 0; j < N_EDGES; ++j)
+        {
+            keys[j % 4] = edges[j];
+
+            if (3 == j % 4 || N_EDGES - 1 == j)
+            {
+                n = j % 4 + 1;
+                n_wrong += (ScanLessScalar(keys, n, edges[i]) != kernel(keys, n, edges[i]));
+            }
+        }
+    }
+
+    /* random keys, in arrays of every length the binary search leaves */
+    for (i = 0; i < N_RANDOM; ++i)
+    {
+        n = Random(&seed) % (MAX_SCAN + 1);
+
+        for (j = 0; j < n; ++j)
+        {
+            keys[j] = RandomKey(&seed);
+        }
+
+        key = RandomKey(&seed);
+        n_wrong += (ScanLessScalar(keys, n, key) != kernel(keys, n, key));
+
+        /* a key that is in the array */
+        if (0 != n)
+        {
+            j = Random(&seed) % n;
+            n_wrong += (ScanLessScalar(keys, n, keys[j]) != kernel(keys, n, keys[j]));
+        }
+    }
+
+    if (0 != n_wrong)
+    {
+        printf("%s: %lu wrong counts\n", name, (unsigned long)n_wrong);
+    }
+    Check(0 == n_wrong, "a kernel counts like the scalar loop");
+}
+
+#if defined(__SSE2__)
+
+static void TestCmpGt64(void)
+{
+    __m128i res;
+    int64_t out[2] = {0};
+    size_t n_wrong = 0;
+    size_t i = 0;
+    size_t j = 0;
+
+    for (i = 0; i < N_EDGES; ++i)
+    {
+        for (j = 0; j < N_EDGES; ++j)
+        {
+            res = CmpGt64(_mm_set_epi64x(edges[j], edges[i]),
+                          _mm_set_epi64x(edges[i], edges[j]));
+            _mm_storeu_si128((__m128i *)out, res);
+
+            n_wrong += ((edges[i] > edges[j] ? -1 : 0) != out[0]);
+            n_wrong += ((edges[j] > edges[i] ? -1 : 0) != out[1]);
+        }
+    }
+
+    Check(0 == n_wrong, "CmpGt64 on the sign edge cases");
+}
+
+#endif
+
+static int CompareKeys(const void *a, const void *b)
+{
+    klist_key_t lhs = *(const klist_key_t *)a;
+    klist_key_t rhs = *(const klist_key_t *)b;
+
+    return ((lhs > rhs) - (lhs < rhs));
+}
+
+static void TestList(void)
+{
+    static klist_key_t keys[N_LIST];
+    key_list_t *list = KeyListCreate();
+    klist_key_t key = 0;
+    unsigned long seed = 11;
+    size_t n_wrong = 0;
+    size_t i = 0;
+
+    Check(NULL != list, "create");
+    if (NULL == list)
+    {
+        return;
+    }
+
+    for (i = 0; i < N_LIST; ++i)
+    {
+        keys[i] = RandomKey(&seed);
+        n_wrong += (0 != KeyListInsert(list, keys[i], (void *)(i + 1)));
+    }
+
+    qsort(keys, N_LIST, sizeof(klist_key_t), &CompareKeys);
+
+    for (i = 0; i < N_LIST; ++i)
+    {
+        n_wrong += (NULL == KeyListFind(list, keys[i]));
+
+        /* a key right after one that is there is found only if it is there too */
+        key = (INT64_MAX == keys[i] ? keys[i] : keys[i] + 1);
+        n_wrong += ((NULL == KeyListFind(list, key)) !=
+                    (NULL == bsearch(&key, keys, N_LIST, sizeof(key), &CompareKeys)));
+    }
+
+    for (i = 0; i < N_LIST; ++i)
+    {
+        n_wrong += (NULL == KeyListPopFront(list, &key) || keys[i] != key);
+    }
+
+    Check(0 == n_wrong, "the list finds and sorts edge keys");
+    Check(KeyListIsEmpty(list), "empty after popping all");
+
+    KeyListDestroy(list);
+}
+
+int main()
+{
+    MakeEdges();
+
+#if defined(__SSE2__)
+    TestCmpGt64();
+    TestKernel(&ScanLessSse2, "sse2");
+#endif
+
+#if defined(KEYLIST_AVX2)
+    if (__builtin_cpu_supports("avx2"))
+    {
+        TestKernel(&ScanLessAvx2, "avx2");
+    }
+    else
+    {
+        printf("keylist: no AVX2 on this CPU, its kernel is not tested\n");
+    }
+#endif
+
+    TestList();
+
+    if (0 != total_errors)
+    {
+        printf("keylist: %lu checks failed\n", (unsigned long)total_errors);
+        return (1);
+    }
+
+    printf("keylist: all tests passed\n");
+
+    return (0);
+}
@@ -0,0 +1,299 @@
+#include <pthread.h> /* pthread_create */
+#include <stdio.h>   /* printf */
+#include <stdlib.h>  /* calloc */
+
+#include "lflist.h"
+
+/*
+stress test of the lock-free list. threads insert, find and remove under
+keys they share, so removed nodes are retired while other threads still
+walk over them and the hazard pointers have to keep them alive.
+*/
+
+#define N_THREADS (8)
+#define N_OPS (4000)
+#define N_KEYS (64)
+#define N_PREFILL (5000)
+#define KEEP_EVERY (7)
+
+typedef struct Worker
+{
+    lf_list_t *list;
+    size_t id;
+    unsigned long seed;
+    size_t n_kept;
+    size_t n_popped;
+    size_t n_errors;
+    unsigned char *seen;
+} worker_t;
+
+static size_t total_errors = 0;
+
+static void Check(int is_ok, const char *what)
+{
+    if (!is_ok)
+    {
+        printf("FAIL: %s\n", what);
+        ++total_errors;
+    }
+}
+
+static unsigned long Random(unsigned long *seed)
+{
+    *seed = *seed * 1103515245UL + 12345UL;
+
+    return ((*seed >> 16) & 0x7fff);
+}
+
+/* the data of an element says which thread made it, and which one it is */
+static void *MakeData(size_t thread, size_t i)
+{
+    return ((void *)(thread * N_OPS + i + 1));
+}
+
+static void *InsertFindRemove(void *param)
+{
+    worker_t *worker = (worker_t *)param;
+    lf_handle_t *handle = LFListAttach(worker->list);
+    lflist_key_t key = 0;
+    void *data = NULL;
+    size_t i = 0;
+
+    for (i = 0; i < N_OPS; ++i)
+    {
+        key = (lflist_key_t)(Random(&worker->seed) % N_KEYS) - N_KEYS / 2;
+        data = MakeData(worker->id, i);
+
+        if (0 != LFListInsert(handle, key, data))
+        {
+            ++worker->n_errors;
+            continue;
+        }
+
+        /* our element is there, so some element has this key */
+        if (NULL == LFListFind(handle, key))
+        {
+            ++worker->n_errors;
+        }
+
+        if (0 == i % KEEP_EVERY)
+        {
+            ++worker->n_kept;
+            continue;
+        }
+
+        /* only we remove our own elements, so it is there exactly once */
+        if (0 != LFListRemove(handle, key, data) ||
+            1 != LFListRemove(handle, key, data))
+        {
+            ++worker->n_errors;
+        }
+
+        /* hand the retired nodes over to another thread now and then */
+        if (0 == i % 500)
+        {
+            LFListDetach(handle);
+            handle = LFListAttach(worker->list);
+        }
+    }
+
+    LFListDetach(handle);
+
+    return (NULL);
+}
+
+static void *PopFront(void *param)
+{
+    worker_t *worker = (worker_t *)param;
+    lf_handle_t *handle = LFListAttach(worker->list);
+    lflist_key_t key = 0;
+    lflist_key_t prev_key = 0;
+    void *data = NULL;
+    size_t i = 0;
+
+    for (data = LFListPopFront(handle, &key); NULL != data;
+         data = LFListPopFront(handle, &key))
+    {
+        i = (size_t)data - 1;
+
+        /* every element comes out once. one thread sees the keys in order. */
+        if (N_PREFILL <= i || 0 != worker->seen[i] ||
+            (0 != worker->n_popped && key < prev_key))
+        {
+            ++worker->n_errors;
+        }
+        else
+        {
+            worker->seen[i] = (unsigned char)(worker->id + 1);
+        }
+
+        prev_key = key;
+        ++worker->n_popped;
+
+        /* some threads also find while the others pop */
+        if (0 == worker->id % 2)
+        {
+            LFListFind(handle, key + 1);
+        }
+    }
+
+    LFListDetach(handle);
+
+    return (NULL);
+}
+
+static void TestInsertFindRemove(void)
+{
+    pthread_t threads[N_THREADS];
+    worker_t workers[N_THREADS];
+    lf_list_t *list = LFListCreate();
+    lf_handle_t *handle = NULL;
+    lflist_key_t key = 0;
+    lflist_key_t prev_key = 0;
+    size_t n_kept = 0;
+    size_t n_drained = 0;
+    size_t i = 0;
+    void *data = NULL;
+
+    Check(NULL != list, "create");
+    if (NULL == list)
+    {
+        return;
+    }
+
+    for (i = 0; i < N_THREADS; ++i)
+    {
+        workers[i].list = list;
+        workers[i].id = i;
+        workers[i].seed = i + 1;
+        workers[i].n_kept = 0;
+        workers[i].n_popped = 0;
+        workers[i].n_errors = 0;
+        workers[i].seen = NULL;
+        pthread_create(&threads[i], NULL, &InsertFindRemove, &workers[i]);
+    }
+
+    for (i = 0; i < N_THREADS; ++i)
+    {
+        pthread_join(threads[i], NULL);
+        Check(0 == workers[i].n_errors, "insert, find and remove from many threads");
+        n_kept += workers[i].n_kept;
+    }
+
+    Check(n_kept == LFListSize(list), "size after concurrent changes");
+
+    handle = LFListAttach(list);
+    for (data = LFListPopFront(handle, &key); NULL != data;
+         data = LFListPopFront(handle, &key))
+    {
+        Check(0 == n_drained || prev_key <= key, "sorted after concurrent changes");
+        Check(0 == ((size_t)data - 1) % N_OPS % KEEP_EVERY, "only kept elements are left");
+        prev_key = key;
+        ++n_drained;
+    }
+    LFListDetach(handle);
+
+    Check(n_kept == n_drained, "every kept element is left");
+    Check(LFListIsEmpty(list), "empty after drain");
+
+    LFListDestroy(list);
+}
+
+static void TestPopFront(void)
+{
+    pthread_t threads[N_THREADS];
+    worker_t workers[N_THREADS];
+    unsigned char *seen = (unsigned char *)calloc(N_PREFILL, 1);
+    lf_list_t *list = LFListCreate();
+    lf_handle_t *handle = NULL;
+    unsigned long seed = 42;
+    size_t n_popped = 0;
+    size_t i = 0;
+
+    Check(NULL != list && NULL != seen, "create");
+    if (NULL == list || NULL == seen)
+    {
+        free(seen);
+        if (NULL != list)
+        {
+            LFListDestroy(list);
+        }
+        return;
+    }
+
+    handle = LFListAttach(list);
+    for (i = 0; i < N_PREFILL; ++i)
+    {
+        LFListInsert(handle, (lflist_key_t)(Random(&seed) % 512),
+                     (void *)(i + 1));
+    }
+    LFListDetach(handle);
+
+    for (i = 0; i < N_THREADS; ++i)
+    {
+        workers[i].list = list;
+        workers[i].id = i;
+        workers[i].seed = i + 1;
+        workers[i].n_kept = 0;
+        workers[i].n_popped = 0;
+        workers[i].n_errors = 0;
+        workers[i].seen = seen;
+        pthread_create(&threads[i], NULL, &PopFront, &workers[i]);
+    }
+
+    for (i = 0; i < N_THREADS; ++i)
+    {
+        pthread_join(threads[i], NULL);
+        Check(0 == workers[i].n_errors, "pop front from many threads");
+        n_popped += workers[i].n_popped;
+    }
+
+    Check(N_PREFILL == n_popped, "every element is popped once");
+    Check(LFListIsEmpty(list), "empty after pops");
+
+    LFListDestroy(list);
+    free(seen);
+}
+
+static void TestAttachLimit(void)
+{
+    lf_handle_t *handles[LFLIST_MAX_THREADS];
+    lf_list_t *list = LFListCreate();
+    size_t i = 0;
+
+    for (i = 0; i < LFLIST_MAX_THREADS; ++i)
+    {
+        handles[i] = LFListAttach(list);
+        Check(NULL != handles[i], "attach up to the limit");
+    }
+
+    Check(NULL == LFListAttach(list), "attach over the limit");
+
+    LFListDetach(handles[0]);
+    handles[0] = LFListAttach(list);
+    Check(NULL != handles[0], "attach after detach");
+
+    for (i = 0; i < LFLIST_MAX_THREADS; ++i)
+    {
+        LFListDetach(handles[i]);
+    }
+
+    LFListDestroy(list);
+}
+
+int main()
+{
+    TestAttachLimit();
+    TestInsertFindRemove();
+    TestPopFront();
+
+    if (0 != total_errors)
+    {
+        printf("lflist: %lu checks failed\n", (unsigned long)total_errors);
+        return (1);
+    }
+
+    printf("lflist: all tests passed\n");
+
+    return (0);
+}
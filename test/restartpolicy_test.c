@@ -0,0 +1,125 @@
+#include <stdio.h> /* printf */
+
+#include "restartpolicy.h"
+
+/*
+tests of the restart policy: the delay doubles with every crash in a row up
+to its cap, too many crashes in a window open the breaker, a failed trial
+keeps it open, and a run of a whole window closes it again.
+*/
+
+#define N_BACKOFF (6)
+
+static size_t total_errors = 0;
+
+static void Check(int is_ok, const char *what)
+{
+    if (!is_ok)
+    {
+        printf("FAIL: %s\n", what);
+        ++total_errors;
+    }
+}
+
+static void TestDefaults(void)
+{
+    restart_policy_t policy = {0};
+
+    RestartPolicySetDefaults(&policy);
+    Check(RESTART_DEFAULT_WINDOW_MS == policy.window_ms &&
+          RESTART_DEFAULT_MAX_CRASHES == policy.max_crashes &&
+          RESTART_DEFAULT_BASE_DELAY_MS == policy.base_delay_ms &&
+          RESTART_DEFAULT_MAX_DELAY_MS == policy.max_delay_ms &&
+          RESTART_DEFAULT_COOL_DOWN_MS == policy.cool_down_ms, "defaults fill zero fields");
+
+    policy.max_crashes = RESTART_HISTORY + 1;
+    policy.base_delay_ms = 7;
+    RestartPolicySetDefaults(&policy);
+    Check(RESTART_HISTORY == policy.max_crashes, "max crashes is at most the history");
+    Check(7 == policy.base_delay_ms, "defaults keep the fields that are set");
+}
+
+static void TestBackoff(void)
+{
+    restart_policy_t policy = {100000, 10, 100, 400, 5000};
+    restart_state_t state = {0};
+    long expected[N_BACKOFF] = {0, 100, 200, 400, 400, 400};
+    long now = 1000;
+    long next = 0;
+    size_t i = 0;
+
+    for (i = 0; i < N_BACKOFF; ++i)
+    {
+        next = RestartPolicyOnCrash(&policy, &state, now);
+        Check(expected[i] == next - now, "the delay doubles up to its cap");
+        Check(next == state.next_restart_ms, "the next restart is kept in the state");
+        Check(!state.is_open, "the breaker stays closed under its limit");
+
+        RestartPolicyOnRestart(&state, next);
+        now = next + 1;
+    }
+
+    Check(N_BACKOFF == state.consecutive && N_BACKOFF == state.total_crashes,
+          "crashes are counted");
+
+    /* a crash after a whole window of running restarts at once */
+    now += (long)policy.window_ms;
+    Check(now == RestartPolicyOnCrash(&policy, &state, now), "no delay after a stable run");
+    Check(1 == state.consecutive && N_BACKOFF + 1 == state.total_crashes,
+          "a stable run forgets the crashes in a row");
+}
+
+static void TestBreaker(void)
+{
+    restart_policy_t policy = {1000, 3, 10, 40, 5000};
+    restart_state_t state = {0};
+    long now = 0;
+
+    Check(0 == RestartPolicyOnCrash(&policy, &state, 0), "first crash");
+    RestartPolicyOnRestart(&state, 0);
+    Check(11 == RestartPolicyOnCrash(&policy, &state, 1), "second crash");
+    RestartPolicyOnRestart(&state, 11);
+
+    /* the third crash within the window opens the breaker */
+    Check(12 + 5000 == RestartPolicyOnCrash(&policy, &state, 12), "the breaker waits a cool-down");
+    Check(state.is_open, "too many crashes in a window open the breaker");
+
+    /* the trial restart crashes at once */
+    RestartPolicyOnRestart(&state, 5012);
+    Check(5013 + 5000 == RestartPolicyOnCrash(&policy, &state, 5013),
+          "a failed trial waits another cool-down");
+    Check(state.is_open, "a failed trial keeps the breaker open");
+
+    /* the next trial runs */
+    now = 10013;
+    RestartPolicyOnRestart(&state, now);
+    Check(!RestartPolicyIsStable(&policy, &state, now + 999), "not stable before a window");
+    Check(RestartPolicyIsStable(&policy, &state, now + 1000), "stable after a window");
+    Check(state.is_open, "the breaker is open until the run is stable");
+
+    RestartPolicyOnStable(&state);
+    Check(!state.is_open && 0 == state.consecutive, "a stable run closes the breaker");
+    Check(!RestartPolicyIsStable(&policy, &state, now + 1000), "nothing to forget once stable");
+
+    /* the next crash is the first in a row again */
+    now += 1100;
+    Check(now == RestartPolicyOnCrash(&policy, &state, now), "no delay after the breaker closes");
+    Check(!state.is_open, "one crash does not open the breaker again");
+}
+
+int main()
+{
+    TestDefaults();
+    TestBackoff();
+    TestBreaker();
+
+    if (0 != total_errors)
+    {
+        printf("restartpolicy: %lu checks failed\n", (unsigned long)total_errors);
+        return (1);
+    }
+
+    printf("restartpolicy: all tests passed\n");
+
+    return (0);
+}
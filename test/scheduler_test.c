@@ -0,0 +1,212 @@
+#include <stdio.h> /* printf */
+
+/* the queue is not part of the interface, so it is checked from inside the file */
+#include "../src/scheduler.c"
+
+/*
+tests of removing tasks from the scheduler. a removed task that waits in the
+queue is only marked as cancelled there: it must never run, and it must be
+freed once it reaches the front of the queue. run under valgrind or
+-fsanitize=address to see that nothing is left behind.
+*/
+
+#define N_MANY (1000)
+#define FAR_MS (3600 * 1000)
+
+static size_t total_errors = 0;
+
+static void Check(int is_ok, const char *what)
+{
+    if (!is_ok)
+    {
+        printf("FAIL: %s\n", what);
+        ++total_errors;
+    }
+}
+
+static int CountOnce(void *param)
+{
+    ++*(size_t *)param;
+
+    return (DO_NOT_REPEAT);
+}
+
+typedef struct SelfRemove
+{
+    scheduler_t *scheduler;
+    ilrd_uid_t uid;
+    size_t n_runs;
+} self_remove_t;
+
+static int RemoveSelfOnThird(void *param)
+{
+    self_remove_t *task = (self_remove_t *)param;
+
+    if (3 == ++task->n_runs)
+    {
+        SchedulerRemoveTask(task->scheduler, task->uid);
+    }
+
+    return (REPEAT);
+}
+
+static void TestRemoveWaiting(void)
+{
+    scheduler_t *scheduler = SchedulerCreate();
+    size_t runs[3] = {0};
+    ilrd_uid_t uids[3];
+    size_t i = 0;
+
+    for (i = 0; i < 3; ++i)
+    {
+        uids[i] = SchedulerAddTaskMs(scheduler, &CountOnce, &runs[i], i * 20, 0, NULL, NULL);
+    }
+
+    /* the middle task waits behind the first one */
+    Check(SUCCESS == SchedulerRemoveTask(scheduler, uids[1]), "remove a waiting task");
+    Check(ERROR == SchedulerRemoveTask(scheduler, uids[1]), "remove it twice");
+    Check(!SchedulerHasTask(scheduler, uids[1]), "a removed task is gone");
+    Check(SchedulerHasTask(scheduler, uids[0]), "the other tasks stay");
+    Check(2 == SchedulerSize(scheduler), "size does not count a removed task");
+
+    Check(SUCCESS == SchedulerRun(scheduler), "run");
+    Check(1 == runs[0] && 0 == runs[1] && 1 == runs[2], "a removed task never runs");
+
+    /* it was dropped on the way, so nothing is left to wait for */
+    Check(-1 == SchedulerGetNextTime(scheduler), "a removed task is freed");
+
+    SchedulerDestroy(scheduler);
+}
+
+static void TestRemoveFront(void)
+{
+    scheduler_t *scheduler = SchedulerCreate();
+    size_t runs[2] = {0};
+    ilrd_uid_t first = SchedulerAddTaskMs(scheduler, &CountOnce, &runs[0], 0, 0, NULL, NULL);
+    time_t second_time = 0;
+
+    SchedulerAddTaskMs(scheduler, &CountOnce, &runs[1], 50, 0, NULL, NULL);
+    second_time = TaskTimeNow() + 50;
+
+    Check(SUCCESS == SchedulerRemoveTask(scheduler, first), "remove the first task");
+
+    /* the next time skips the removed task, and frees it */
+    Check(second_time - 1 <= SchedulerGetNextTime(scheduler), "next time skips a removed task");
+
+    Check(SUCCESS == SchedulerRunDue(scheduler), "run due");
+    Check(0 == runs[0] && 0 == runs[1], "run due skips a removed task");
+
+    Check(SUCCESS == SchedulerRun(scheduler), "run");
+    Check(0 == runs[0] && 1 == runs[1], "run skips a removed task");
+
+    SchedulerDestroy(scheduler);
+}
+
+static void TestRemoveOnly(void)
+{
+    scheduler_t *scheduler = SchedulerCreate();
+    size_t runs = 0;
+    ilrd_uid_t uid = SchedulerAddTaskMs(scheduler, &CountOnce, &runs, 0, 0, NULL, NULL);
+
+    Check(SUCCESS == SchedulerRemoveTask(scheduler, uid), "remove the only task");
+    Check(SchedulerIsEmpty(scheduler), "empty after removing the only task");
+
+    /* nothing to run. the cancelled task is freed by destroy. */
+    Check(SUCCESS == SchedulerRun(scheduler), "run an emptied scheduler");
+    Check(0 == runs, "the only task never runs");
+
+    SchedulerDestroy(scheduler);
+}
+
+static void TestRemoveSelf(void)
+{
+    scheduler_t *scheduler = SchedulerCreate();
+    self_remove_t task = {0};
+
+    task.scheduler = scheduler;
+    task.uid = SchedulerAddTaskMs(scheduler, &RemoveSelfOnThird, &task, 0, 1, NULL, NULL);
+
+    Check(SUCCESS == SchedulerRun(scheduler), "run a task that removes itself");
+    Check(3 == task.n_runs, "a task that removed itself stops");
+    Check(SchedulerIsEmpty(scheduler), "empty after a task removed itself");
+
+    SchedulerDestroy(scheduler);
+}
+
+static void TestRemoveMany(void)
+{
+    scheduler_t *scheduler = SchedulerCreate();
+    ilrd_uid_t uids[N_MANY];
+    size_t runs = 0;
+    size_t i = 0;
+
+    for (i = 0; i < N_MANY; ++i)
+    {
+        uids[i] = SchedulerAddTaskMs(scheduler, &CountOnce, &runs, 0, 0, NULL, NULL);
+    }
+
+    /* keep every tenth task */
+    for (i = 0; i < N_MANY; ++i)
+    {
+        if (0 != i % 10)
+        {
+            SchedulerRemoveTask(scheduler, uids[i]);
+        }
+    }
+
+    Check(N_MANY / 10 == SchedulerSize(scheduler), "size after removing many tasks");
+    Check(SUCCESS == SchedulerRunDue(scheduler), "run due after removing many tasks");
+    Check(N_MANY / 10 == runs, "only the kept tasks run");
+    Check(-1 == SchedulerGetNextTime(scheduler), "every removed task is freed");
+
+    /* removed tasks that are far off never reach the front of the queue */
+    for (i = 0; i < N_MANY; ++i)
+    {
+        uids[i] = SchedulerAddTaskMs(scheduler, &CountOnce, &runs, FAR_MS + i, 0, NULL, NULL);
+    }
+
+    for (i = 0; i < N_MANY; ++i)
+    {
+        if (0 != i % 10)
+        {
+            SchedulerRemoveTask(scheduler, uids[i]);
+        }
+    }
+
+    Check(N_MANY / 10 == SchedulerSize(scheduler), "size after removing many far tasks");
+    Check(PQSize(scheduler->pq) <= 2 * SchedulerSize(scheduler),
+          "removed far tasks do not pile up in the queue");
+    Check(SchedulerHasTask(scheduler, uids[0]) && SchedulerHasTask(scheduler, uids[N_MANY - 10]),
+          "the kept far tasks stay");
+    Check(!SchedulerHasTask(scheduler, uids[1]), "a removed far task is gone");
+
+    /* removing the rest leaves nothing in the queue */
+    for (i = 0; i < N_MANY; i += 10)
+    {
+        SchedulerRemoveTask(scheduler, uids[i]);
+    }
+
+    Check(SchedulerIsEmpty(scheduler), "empty after removing every far task");
+    Check(-1 == SchedulerGetNextTime(scheduler), "every removed far task is freed");
+
+    SchedulerDestroy(scheduler);
+}
+
+int main()
+{
+    TestRemoveWaiting();
+    TestRemoveFront();
+    TestRemoveOnly();
+    TestRemoveSelf();
+    TestRemoveMany();
+
+    if (0 != total_errors)
+    {
+        printf("scheduler: %lu checks failed\n", (unsigned long)total_errors);
+        return (1);
+    }
+
+    printf("scheduler: all tests passed\n");
+
+    return (0);
+}
@@ -0,0 +1,202 @@
+#define _POSIX_C_SOURCE 200809L
+#include <sys/types.h> /* pid_t */
+#include <sys/wait.h>  /* waitpid */
+#include <signal.h>    /* kill */
+#include <spawn.h>     /* posix_spawn */
+#include <unistd.h>    /* fork, pipe */
+#include <stdio.h>     /* printf */
+#include <stdlib.h>    /* malloc, qsort, atoi */
+#include <time.h>      /* clock_gettime */
+
+#include "supervisor.h"
+
+/*
+registration latency and memory of a supervisor daemon. forks n clients
+that register one after another and stay registered, then compares the
+resident memory of the daemon before and after.
+usage: supervisor_bench.out [n clients]
+*/
+
+#define DAEMON_NAME ("/wd_bench")
+#define DEFAULT_CLIENTS (1000)
+#define CHECK_INTERVAL_MS (60000)
+#define LINE_SIZE (128)
+
+extern char **environ;
+
+static long NowNs(void)
+{
+    struct timespec now = {0};
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec * 1000000000L + now.tv_nsec);
+}
+
+static void SleepMs(long ms)
+{
+    struct timespec time = {0};
+
+    time.tv_sec = ms / 1000;
+    time.tv_nsec = (ms % 1000) * 1000000L;
+    nanosleep(&time, NULL);
+}
+
+static long ReadRssKb(pid_t pid)
+{
+    char path[LINE_SIZE] = {'\0'};
+    char line[LINE_SIZE] = {'\0'};
+    FILE *status = NULL;
+    long rss_kb = -1;
+
+    sprintf(path, "/proc/%d/status", (int)pid);
+
+    status = fopen(path, "r");
+    if (NULL == status)
+    {
+        return (-1);
+    }
+
+    while (NULL != fgets(line, sizeof(line), status) &&
+           1 != sscanf(line, "VmRSS: %ld", &rss_kb))
+    {
+    }
+
+    fclose(status);
+
+    return (rss_kb);
+}
+
+static int CompareLong(const void *a, const void *b)
+{
+    long lhs = *(const long *)a;
+    long rhs = *(const long *)b;
+
+    return ((lhs > rhs) - (lhs < rhs));
+}
+
+static void RunClient(int latency_fd, int done_fd)
+{
+    wd_side_t *beat = NULL;
+    long start = NowNs();
+    long latency = 0;
+    int conn = WDDaemonRegister(DAEMON_NAME, "/bin/true", CHECK_INTERVAL_MS, 1, -1, &beat);
+    char byte = 0;
+
+    latency = (-1 == conn ? -1 : NowNs() - start);
+    write(latency_fd, &latency, sizeof(latency));
+
+    /* stay registered until the parent closes the pipe */
+    read(done_fd, &byte, 1);
+
+    if (-1 != conn)
+    {
+        WDDaemonRelease(conn, beat);
+    }
+
+    _exit(0);
+}
+
+int main(int argc, char *argv[])
+{
+    char *daemon_argv[] = {WD_SUPERVISOR_EXEC_PATH, "-d", DAEMON_NAME, NULL};
+    wd_side_t *beat = NULL;
+    long *latencies = NULL;
+    long total = 0;
+    long rss_before = 0;
+    long rss_after = 0;
+    pid_t daemon = 0;
+    int latency_pipe[2] = {-1, -1};
+    int done_pipe[2] = {-1, -1};
+    int n_clients = (1 < argc ? atoi(argv[1]) : DEFAULT_CLIENTS);
+    int n_failed = 0;
+    int conn = -1;
+    int i = 0;
+
+    if (0 >= n_clients)
+    {
+        fprintf(stderr, "usage: %s [n clients]\n", argv[0]);
+        return (1);
+    }
+
+    latencies = (long *)malloc(n_clients * sizeof(long));
+    /* the daemon is spawned first, so it does not hold the pipes open */
+    if (NULL == latencies ||
+        0 != posix_spawn(&daemon, daemon_argv[0], NULL, NULL, daemon_argv, environ) ||
+        0 != pipe(latency_pipe) || 0 != pipe(done_pipe))
+    {
+        perror("Failed to start the benchmark");
+        return (1);
+    }
+
+    /* wait until the daemon listens */
+    for (i = 0; i < 100 && -1 == conn; ++i)
+    {
+        SleepMs(10);
+        conn = WDDaemonRegister(DAEMON_NAME, "/bin/true", CHECK_INTERVAL_MS, 1, -1, &beat);
+    }
+    if (-1 == conn)
+    {
+        fprintf(stderr, "The daemon did not start\n");
+        return (1);
+    }
+    WDDaemonRelease(conn, beat);
+
+    SleepMs(100);
+    rss_before = ReadRssKb(daemon);
+
+    for (i = 0; i < n_clients; ++i)
+    {
+        if (0 == fork())
+        {
+            close(done_pipe[1]);
+            RunClient(latency_pipe[1], done_pipe[0]);
+        }
+
+        /* one registration at a time */
+        if ((ssize_t)sizeof(long) != read(latency_pipe[0], &latencies[i], sizeof(long)) ||
+            0 > latencies[i])
+        {
+            latencies[i] = 0;
+            ++n_failed;
+        }
+    }
+
+    /* let the daemon track the clients on its next tick */
+    SleepMs(100);
+    rss_after = ReadRssKb(daemon);
+
+    close(done_pipe[1]);
+    for (i = 0; i < n_clients; ++i)
+    {
+        wait(NULL);
+    }
+
+    kill(daemon, SIGTERM);
+    waitpid(daemon, NULL, 0);
+
+    qsort(latencies, n_clients, sizeof(long), &CompareLong);
+    for (i = 0; i < n_clients; ++i)
+    {
+        total += latencies[i];
+    }
+
+    printf("clients: %d, failed: %d\n", n_clients, n_failed);
+    if (n_failed == n_clients)
+    {
+        free(latencies);
+        return (1);
+    }
+
+    printf("registration latency us: min %.1f avg %.1f p50 %.1f p99 %.1f max %.1f\n",
+           latencies[n_failed] / 1000.0, total / 1000.0 / (n_clients - n_failed),
+           latencies[n_failed + (n_clients - n_failed) / 2] / 1000.0,
+           latencies[n_failed + (n_clients - n_failed) * 99 / 100] / 1000.0,
+           latencies[n_clients - 1] / 1000.0);
+    printf("daemon rss kB: %ld before, %ld after, %.0f bytes per client\n",
+           rss_before, rss_after, (rss_after - rss_before) * 1024.0 / n_clients);
+
+    free(latencies);
+
+    return (0);
+}
@@ -0,0 +1,274 @@
+#include <stdio.h> /* printf */
+
+#include "timerwheel.h"
+
+/*
+tests of the hashed timer wheel: a timer expires on the very tick it is due,
+also when it waits several rounds of the wheel, and the random runs compare
+the wheel with a plain array of deadlines after every tick.
+*/
+
+#define N_BUCKETS (8)
+#define N_TIMERS (64)
+#define N_TICKS (20000)
+#define MAX_TICKS (5 * N_BUCKETS)
+#define NOT_PENDING (0)
+
+/* what the timers should do, tick by tick */
+typedef struct Model
+{
+    size_t now;
+    size_t deadlines[N_TIMERS]; /* NOT_PENDING, or the tick it expires on */
+    size_t n_wrong;
+    size_t n_expired;
+    timer_wheel_t *wheel;
+    size_t re_add_ticks; /* expire adds its timer again for this long, or 0 */
+} model_t;
+
+static size_t total_errors = 0;
+
+static void Check(int is_ok, const char *what)
+{
+    if (!is_ok)
+    {
+        printf("FAIL: %s\n", what);
+        ++total_errors;
+    }
+}
+
+static unsigned long Random(unsigned long *seed)
+{
+    *seed = *seed * 1103515245UL + 12345UL;
+
+    return ((*seed >> 16) & 0x7fff);
+}
+
+static void Expire(size_t id, void *param)
+{
+    model_t *model = (model_t *)param;
+
+    /* due on this very tick, and no longer pending */
+    if (model->deadlines[id] != model->now || TimerWheelIsPending(model->wheel, id))
+    {
+        ++model->n_wrong;
+    }
+
+    model->deadlines[id] = NOT_PENDING;
+    ++model->n_expired;
+
+    if (0 != model->re_add_ticks)
+    {
+        TimerWheelAdd(model->wheel, id, model->re_add_ticks);
+        model->deadlines[id] = model->now + model->re_add_ticks;
+    }
+}
+
+static void Add(model_t *model, size_t id, size_t ticks)
+{
+    TimerWheelAdd(model->wheel, id, ticks);
+    model->deadlines[id] = model->now + ticks;
+}
+
+static void Remove(model_t *model, size_t id)
+{
+    TimerWheelRemove(model->wheel, id);
+    model->deadlines[id] = NOT_PENDING;
+}
+
+static size_t Tick(model_t *model)
+{
+    ++model->now;
+
+    return (TimerWheelTick(model->wheel, &Expire, model));
+}
+
+static int IsSame(const model_t *model)
+{
+    size_t id = 0;
+
+    for (id = 0; id < N_TIMERS; ++id)
+    {
+        if ((NOT_PENDING != model->deadlines[id]) != TimerWheelIsPending(model->wheel, id))
+        {
+            return (0);
+        }
+    }
+
+    return (1);
+}
+
+static int InitModel(model_t *model)
+{
+    model_t empty = {0};
+
+    *model = empty;
+    model->wheel = TimerWheelCreate(N_TIMERS, N_BUCKETS);
+
+    return (NULL != model->wheel);
+}
+
+/* ticks until the timer is no longer pending, expire checks the tick */
+static size_t TicksUntilExpired(model_t *model, size_t id, size_t max_ticks)
+{
+    size_t ticks = 0;
+
+    while (ticks < max_ticks && TimerWheelIsPending(model->wheel, id))
+    {
+        Tick(model);
+        ++ticks;
+    }
+
+    return (ticks);
+}
+
+static void TestRounds(void)
+{
+    model_t model;
+    size_t ticks[] = {1, 2, N_BUCKETS - 1, N_BUCKETS, N_BUCKETS + 1,
+                      2 * N_BUCKETS, 3 * N_BUCKETS + 5};
+    size_t i = 0;
+
+    if (!InitModel(&model))
+    {
+        Check(0, "create");
+        return;
+    }
+
+    Check(!TimerWheelIsPending(model.wheel, 0), "not pending after create");
+    Check(0 == Tick(&model), "a tick of an empty wheel");
+
+    /* a timer that waits less than a round, a whole round, or many rounds */
+    for (i = 0; i < sizeof(ticks) / sizeof(ticks[0]); ++i)
+    {
+        Add(&model, 0, ticks[i]);
+        Check(TimerWheelIsPending(model.wheel, 0), "pending after add");
+        Check(ticks[i] == TicksUntilExpired(&model, 0, 10 * N_BUCKETS),
+              "a timer expires on the tick it is due");
+    }
+
+    /* timers due in the same bucket, on different rounds */
+    Add(&model, 1, 3);
+    Add(&model, 2, 3 + N_BUCKETS);
+    Add(&model, 3, 3 + 2 * N_BUCKETS);
+    Check(3 == TicksUntilExpired(&model, 1, MAX_TICKS), "first round of a bucket");
+    Check(TimerWheelIsPending(model.wheel, 2) && TimerWheelIsPending(model.wheel, 3),
+          "later rounds wait");
+    Check(N_BUCKETS == TicksUntilExpired(&model, 2, MAX_TICKS), "second round of a bucket");
+    Check(N_BUCKETS == TicksUntilExpired(&model, 3, MAX_TICKS), "third round of a bucket");
+
+    Check(0 == model.n_wrong && sizeof(ticks) / sizeof(ticks[0]) + 3 == model.n_expired,
+          "expire is called once for each timer, on time");
+
+    TimerWheelDestroy(model.wheel);
+}
+
+static void TestRestartRemove(void)
+{
+    model_t model;
+    size_t i = 0;
+
+    if (!InitModel(&model))
+    {
+        Check(0, "create");
+        return;
+    }
+
+    /* a restarted timer expires only at its new time */
+    Add(&model, 5, 2);
+    Tick(&model);
+    Add(&model, 5, 2 * N_BUCKETS);
+    Check(2 * N_BUCKETS == TicksUntilExpired(&model, 5, MAX_TICKS), "a restarted timer");
+
+    /* a removed timer never expires */
+    Add(&model, 6, 4);
+    Remove(&model, 6);
+    Remove(&model, 6);
+    Check(!TimerWheelIsPending(model.wheel, 6), "not pending after remove");
+    model.n_expired = 0;
+    for (i = 0; i < MAX_TICKS; ++i)
+    {
+        Tick(&model);
+    }
+    Check(0 == model.n_expired, "a removed timer never expires");
+
+    /* a timer that adds itself again from expire */
+    model.re_add_ticks = N_BUCKETS + 3;
+    Add(&model, 8, 1);
+    Tick(&model);
+    Check(1 == model.n_expired && TimerWheelIsPending(model.wheel, 8),
+          "a timer re-added in expire is pending again");
+    model.re_add_ticks = 0;
+    Check(N_BUCKETS + 3 == TicksUntilExpired(&model, 8, MAX_TICKS),
+          "a timer re-added in expire waits its new time");
+
+    Check(0 == model.n_wrong, "timers expire on time");
+
+    TimerWheelDestroy(model.wheel);
+}
+
+static void TestRandom(void)
+{
+    model_t model;
+    unsigned long seed = 3;
+    size_t expected = 0;
+    size_t id = 0;
+    size_t i = 0;
+    size_t j = 0;
+
+    if (!InitModel(&model))
+    {
+        Check(0, "create");
+        return;
+    }
+
+    for (i = 0; i < N_TICKS; ++i)
+    {
+        /* a few changes, then a tick */
+        for (j = Random(&seed) % 4; 0 < j; --j)
+        {
+            id = Random(&seed) % N_TIMERS;
+
+            if (0 == Random(&seed) % 4)
+            {
+                Remove(&model, id);
+            }
+            else
+            {
+                Add(&model, id, 1 + Random(&seed) % MAX_TICKS);
+            }
+        }
+
+        expected = 0;
+        for (id = 0; id < N_TIMERS; ++id)
+        {
+            expected += (model.now + 1 == model.deadlines[id]);
+        }
+
+        if (expected != Tick(&model) || !IsSame(&model))
+        {
+            Check(0, "the wheel matches after random changes");
+            break;
+        }
+    }
+
+    Check(0 == model.n_wrong, "random timers expire on time");
+
+    TimerWheelDestroy(model.wheel);
+}
+
+int main()
+{
+    TestRounds();
+    TestRestartRemove();
+    TestRandom();
+
+    if (0 != total_errors)
+    {
+        printf("timerwheel: %lu checks failed\n", (unsigned long)total_errors);
+        return (1);
+    }
+
+    printf("timerwheel: all tests passed\n");
+
+    return (0);
+}
@@ -0,0 +1,267 @@
+#define _POSIX_C_SOURCE 200112L /* fork */
+#include <pthread.h>   /* pthread_create */
+#include <stdio.h>     /* printf */
+#include <stdlib.h>    /* qsort */
+#include <time.h>      /* time */
+#include <sys/types.h> /* pid_t */
+#include <sys/wait.h>  /* waitpid */
+#include <unistd.h>    /* fork, pipe */
+
+#include "uid64.h"
+
+/*
+tests of the time-ordered 64-bit ids: every thread sees its ids go up, the
+ids of all the threads never repeat, and a forked child never makes the ids
+of its parent, whether its node was leased or set by the caller.
+*/
+
+#define N_THREADS (4)
+#define N_IDS (20000)
+#define N_FORK_IDS (1000)
+#define SET_NODE (5)
+#define CHILD_NODE (6)
+
+typedef struct Maker
+{
+    uid64_t ids[N_IDS];
+    size_t n_errors;
+} maker_t;
+
+static size_t total_errors = 0;
+
+static void Check(int is_ok, const char *what)
+{
+    if (!is_ok)
+    {
+        printf("FAIL: %s\n", what);
+        ++total_errors;
+    }
+}
+
+static int CompareIDs(const void *a, const void *b)
+{
+    uid64_t lhs = *(const uid64_t *)a;
+    uid64_t rhs = *(const uid64_t *)b;
+
+    return ((lhs > rhs) - (lhs < rhs));
+}
+
+/* sorts the ids, and says whether two of them are the same */
+static int HasRepeats(uid64_t *ids, size_t n)
+{
+    size_t i = 0;
+
+    qsort(ids, n, sizeof(uid64_t), &CompareIDs);
+
+    for (i = 1; i < n && ids[i - 1] != ids[i]; ++i)
+    {
+    }
+
+    return (1 < n && i < n);
+}
+
+static void *MakeIDs(void *param)
+{
+    maker_t *maker = (maker_t *)param;
+    size_t i = 0;
+
+    for (i = 0; i < N_IDS; ++i)
+    {
+        maker->ids[i] = UID64Create();
+
+        if (0 != i && maker->ids[i] <= maker->ids[i - 1])
+        {
+            ++maker->n_errors;
+        }
+    }
+
+    return (NULL);
+}
+
+static void TestThreads(void)
+{
+    static maker_t makers[N_THREADS];
+    static uid64_t all[N_THREADS * N_IDS];
+    pthread_t threads[N_THREADS];
+    uint64_t now_ms = (uint64_t)time(NULL) * 1000;
+    unsigned int node = UID64GetNode(UID64Create());
+    size_t n_other = 0;
+    size_t i = 0;
+    size_t j = 0;
+
+    for (i = 0; i < N_THREADS; ++i)
+    {
+        makers[i].n_errors = 0;
+        pthread_create(&threads[i], NULL, &MakeIDs, &makers[i]);
+    }
+
+    for (i = 0; i < N_THREADS; ++i)
+    {
+        pthread_join(threads[i], NULL);
+        Check(0 == makers[i].n_errors, "the ids of a thread go up");
+
+        for (j = 0; j < N_IDS; ++j)
+        {
+            all[i * N_IDS + j] = makers[i].ids[j];
+            n_other += (node != UID64GetNode(makers[i].ids[j]));
+        }
+    }
+
+    Check(0 == n_other, "the threads of a process share a node");
+    Check(!HasRepeats(all, N_THREADS * N_IDS), "the ids of many threads never repeat");
+
+    /* borrowed milliseconds keep them close to the clock */
+    Check(now_ms - 1000 <= UID64GetTime(all[0]) &&
+          UID64GetTime(all[N_THREADS * N_IDS - 1]) <= now_ms + 10000,
+          "ids carry the time they were made");
+}
+
+static void TestCreateN(void)
+{
+    uid64_t ids[N_FORK_IDS];
+    uid64_t before = UID64Create();
+    size_t i = 0;
+
+    UID64CreateN(ids, N_FORK_IDS);
+
+    for (i = 1; i < N_FORK_IDS && ids[i - 1] < ids[i]; ++i)
+    {
+    }
+
+    Check(N_FORK_IDS == i, "ids made together go up");
+    Check(before < ids[0] && ids[N_FORK_IDS - 1] < UID64Create(),
+          "ids made together are in order with the others");
+}
+
+/* the child sends the ids it makes to its parent */
+static void MakeChildIDs(int fd)
+{
+    uid64_t ids[N_FORK_IDS];
+    size_t n_written = 0;
+    ssize_t n = 0;
+    size_t i = 0;
+
+    for (i = 0; i < N_FORK_IDS; ++i)
+    {
+        ids[i] = UID64Create();
+    }
+
+    while (n_written < sizeof(ids))
+    {
+        n = write(fd, (char *)ids + n_written, sizeof(ids) - n_written);
+        if (0 >= n)
+        {
+            _exit(1);
+        }
+        n_written += (size_t)n;
+    }
+
+    _exit(0);
+}
+
+static void TestForkLeased(void)
+{
+    static uid64_t all[2 * N_FORK_IDS];
+    unsigned int node = UID64GetNode(UID64Create());
+    size_t n_read = 0;
+    ssize_t n = 0;
+    pid_t child = 0;
+    int fds[2] = {-1, -1};
+    int status = 0;
+    size_t i = 0;
+
+    if (0 != pipe(fds))
+    {
+        Check(0, "create a pipe");
+        return;
+    }
+
+    child = fork();
+    if (0 == child)
+    {
+        close(fds[0]);
+        MakeChildIDs(fds[1]);
+    }
+    close(fds[1]);
+
+    /* the parent goes on making ids from the same stamps as the child */
+    for (i = 0; i < N_FORK_IDS; ++i)
+    {
+        all[i] = UID64Create();
+    }
+
+    while (n_read < N_FORK_IDS * sizeof(uid64_t))
+    {
+        n = read(fds[0], (char *)(all + N_FORK_IDS) + n_read,
+                 N_FORK_IDS * sizeof(uid64_t) - n_read);
+        if (0 >= n)
+        {
+            break;
+        }
+        n_read += (size_t)n;
+    }
+    close(fds[0]);
+
+    Check(-1 != child && child == waitpid(child, &status, 0) &&
+          WIFEXITED(status) && 0 == WEXITSTATUS(status) &&
+          N_FORK_IDS * sizeof(uid64_t) == n_read, "make ids in a forked child");
+    Check(node != UID64GetNode(all[N_FORK_IDS]), "a forked child leases a node of its own");
+    Check(!HasRepeats(all, 2 * N_FORK_IDS), "a forked child never makes the ids of its parent");
+}
+
+static void TestForkSetNode(void)
+{
+    uid64_t ids[2] = {0};
+    uid64_t id = 0;
+    pid_t child = 0;
+    int status = 0;
+
+    UID64SetNode(SET_NODE);
+    Check(SET_NODE == UID64GetNode(UID64Create()), "ids carry the node that was set");
+
+    child = fork();
+    if (0 == child)
+    {
+        /* exits with the number of the first check that fails */
+        if (UID64_BAD_ID != UID64Create())
+        {
+            _exit(1);
+        }
+
+        UID64CreateN(ids, 2);
+        if (UID64_BAD_ID != ids[0] || UID64_BAD_ID != ids[1])
+        {
+            _exit(2);
+        }
+
+        UID64SetNode(CHILD_NODE);
+        id = UID64Create();
+        _exit(UID64_BAD_ID != id && CHILD_NODE == UID64GetNode(id) ? 0 : 3);
+    }
+
+    Check(-1 != child && child == waitpid(child, &status, 0) && WIFEXITED(status),
+          "fork after setting the node");
+    Check(1 != WEXITSTATUS(status), "a forked child makes no ids until it sets a node");
+    Check(2 != WEXITSTATUS(status), "a forked child makes no ids together until it sets a node");
+    Check(3 != WEXITSTATUS(status), "a forked child makes ids once it sets a node");
+
+    Check(SET_NODE == UID64GetNode(UID64Create()), "the parent keeps its node");
+}
+
+int main()
+{
+    TestThreads();
+    TestCreateN();
+    TestForkLeased();
+    TestForkSetNode();
+
+    if (0 != total_errors)
+    {
+        printf("uid64: %lu checks failed\n", (unsigned long)total_errors);
+        return (1);
+    }
+
+    printf("uid64: all tests passed\n");
+
+    return (0);
+}
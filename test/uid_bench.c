@@ -0,0 +1,109 @@
+#define _POSIX_C_SOURCE 200112L /* clock_gettime */
+#include <pthread.h> /* pthread_create */
+#include <stdio.h>   /* printf */
+#include <stdlib.h>  /* atoi */
+#include <time.h>    /* clock_gettime */
+
+#include "uid.h"
+
+/*
+time to create a uid, from one thread and from several threads that share
+the counter, and per id for ids created together.
+usage: uid_bench.out [n ids per thread]
+*/
+
+#define DEFAULT_IDS (10000000)
+#define N_THREADS (4)
+#define BATCH_SIZE (64)
+
+typedef struct Maker
+{
+    long n_ids;
+    unsigned long sum; /* keeps the ids from being optimized out */
+} maker_t;
+
+static long NowNs(void)
+{
+    struct timespec now = {0};
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec * 1000000000L + now.tv_nsec);
+}
+
+static void *MakeUIDs(void *param)
+{
+    maker_t *maker = (maker_t *)param;
+    long i = 0;
+
+    for (i = 0; i < maker->n_ids; ++i)
+    {
+        maker->sum += (unsigned long)UIDCreate().serial;
+    }
+
+    return (NULL);
+}
+
+static void *MakeBatches(void *param)
+{
+    maker_t *maker = (maker_t *)param;
+    ilrd_uid_t ids[BATCH_SIZE];
+    long i = 0;
+
+    for (i = 0; i < maker->n_ids; i += BATCH_SIZE)
+    {
+        UIDCreateN(ids, BATCH_SIZE);
+        maker->sum += (unsigned long)ids[BATCH_SIZE - 1].serial;
+    }
+
+    return (NULL);
+}
+
+/* ns per id, with n_threads threads that each make n_ids */
+static double Run(void *(*make)(void *), int n_threads, long n_ids)
+{
+    maker_t makers[N_THREADS];
+    pthread_t threads[N_THREADS];
+    long start = 0;
+    int i = 0;
+
+    for (i = 0; i < n_threads; ++i)
+    {
+        makers[i].n_ids = n_ids;
+        makers[i].sum = 0;
+    }
+
+    start = NowNs();
+    for (i = 0; i < n_threads; ++i)
+    {
+        pthread_create(&threads[i], NULL, make, &makers[i]);
+    }
+    for (i = 0; i < n_threads; ++i)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    return ((double)(NowNs() - start) / ((double)n_ids * n_threads));
+}
+
+int main(int argc, char *argv[])
+{
+    long n_ids = (1 < argc ? atoi(argv[1]) : DEFAULT_IDS);
+
+    if (0 >= n_ids)
+    {
+        fprintf(stderr, "usage: %s [n ids per thread]\n", argv[0]);
+        return (1);
+    }
+
+    /* the first id looks the identity up */
+    UIDCreate();
+
+    printf("uid create ns per id: 1 thread %.1f, %d threads %.1f\n",
+           Run(&MakeUIDs, 1, n_ids), N_THREADS, Run(&MakeUIDs, N_THREADS, n_ids));
+    printf("uid create %d together ns per id: 1 thread %.1f, %d threads %.1f\n",
+           BATCH_SIZE, Run(&MakeBatches, 1, n_ids), N_THREADS,
+           Run(&MakeBatches, N_THREADS, n_ids));
+
+    return (0);
+}
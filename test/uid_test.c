@@ -0,0 +1,223 @@
+#define _POSIX_C_SOURCE 200112L /* fork */
+#include <pthread.h>   /* pthread_create */
+#include <stdio.h>     /* printf */
+#include <stdlib.h>    /* qsort */
+#include <sys/types.h> /* pid_t */
+#include <sys/wait.h>  /* waitpid */
+#include <unistd.h>    /* fork, getpid, pipe */
+
+#include "uid.h"
+
+/*
+tests of the 128-bit uids: the ids of many threads never repeat, ids made
+together follow each other, and a forked child looks its identity up again,
+so it never makes the ids of its parent.
+*/
+
+#define N_THREADS (4)
+#define N_IDS (20000)
+#define N_FORK_IDS (1000)
+
+typedef struct Maker
+{
+    ilrd_uid_t ids[N_IDS];
+} maker_t;
+
+static size_t total_errors = 0;
+
+static void Check(int is_ok, const char *what)
+{
+    if (!is_ok)
+    {
+        printf("FAIL: %s\n", what);
+        ++total_errors;
+    }
+}
+
+static int CompareUIDs(const void *a, const void *b)
+{
+    const ilrd_uid_t *lhs = (const ilrd_uid_t *)a;
+    const ilrd_uid_t *rhs = (const ilrd_uid_t *)b;
+
+    if (lhs->host != rhs->host)
+    {
+        return (lhs->host > rhs->host ? 1 : -1);
+    }
+
+    return ((lhs->serial > rhs->serial) - (lhs->serial < rhs->serial));
+}
+
+/* sorts the ids, and says whether two of them are the same */
+static int HasRepeats(ilrd_uid_t *ids, size_t n)
+{
+    size_t i = 0;
+
+    qsort(ids, n, sizeof(ilrd_uid_t), &CompareUIDs);
+
+    for (i = 1; i < n && !UIDIsSame(ids[i - 1], ids[i]); ++i)
+    {
+    }
+
+    return (1 < n && i < n);
+}
+
+static void *MakeUIDs(void *param)
+{
+    maker_t *maker = (maker_t *)param;
+    size_t i = 0;
+
+    for (i = 0; i < N_IDS; ++i)
+    {
+        maker->ids[i] = UIDCreate();
+    }
+
+    return (NULL);
+}
+
+static void TestThreads(void)
+{
+    static maker_t makers[N_THREADS];
+    static ilrd_uid_t all[N_THREADS * N_IDS];
+    pthread_t threads[N_THREADS];
+    ilrd_uid_t first = UIDCreate();
+    size_t n_other = 0;
+    size_t i = 0;
+    size_t j = 0;
+
+    Check(!UIDIsSame(first, UIDBadUID), "an id is not the bad id");
+    Check(UIDIsSame(first, first) && !UIDIsSame(first, UIDCreate()), "is same");
+    Check((uint32_t)getpid() == (uint32_t)first.host, "the host holds the pid");
+
+    for (i = 0; i < N_THREADS; ++i)
+    {
+        pthread_create(&threads[i], NULL, &MakeUIDs, &makers[i]);
+    }
+
+    for (i = 0; i < N_THREADS; ++i)
+    {
+        pthread_join(threads[i], NULL);
+
+        for (j = 0; j < N_IDS; ++j)
+        {
+            all[i * N_IDS + j] = makers[i].ids[j];
+            n_other += (first.host != makers[i].ids[j].host);
+        }
+    }
+
+    Check(0 == n_other, "the threads of a process share a host");
+    Check(!HasRepeats(all, N_THREADS * N_IDS), "the ids of many threads never repeat");
+}
+
+static void TestCreateN(void)
+{
+    ilrd_uid_t ids[N_FORK_IDS];
+    ilrd_uid_t before = UIDCreate();
+    size_t i = 0;
+
+    UIDCreateN(ids, N_FORK_IDS);
+
+    for (i = 1; i < N_FORK_IDS && ids[i - 1].serial + 1 == ids[i].serial &&
+                ids[i - 1].host == ids[i].host; ++i)
+    {
+    }
+
+    Check(N_FORK_IDS == i, "ids made together follow each other");
+    Check(before.serial < ids[0].serial && ids[N_FORK_IDS - 1].serial < UIDCreate().serial,
+          "ids made together are in order with the others");
+}
+
+/* the child sends the ids it makes to its parent */
+static void MakeChildUIDs(int fd)
+{
+    ilrd_uid_t ids[N_FORK_IDS];
+    size_t n_written = 0;
+    ssize_t n = 0;
+    size_t i = 0;
+
+    for (i = 0; i < N_FORK_IDS; ++i)
+    {
+        ids[i] = UIDCreate();
+    }
+
+    while (n_written < sizeof(ids))
+    {
+        n = write(fd, (char *)ids + n_written, sizeof(ids) - n_written);
+        if (0 >= n)
+        {
+            _exit(1);
+        }
+        n_written += (size_t)n;
+    }
+
+    _exit(0);
+}
+
+static void TestFork(void)
+{
+    static ilrd_uid_t all[2 * N_FORK_IDS];
+    ilrd_uid_t parent = UIDCreate();
+    size_t n_read = 0;
+    ssize_t n = 0;
+    pid_t child = 0;
+    int fds[2] = {-1, -1};
+    int status = 0;
+    size_t i = 0;
+
+    if (0 != pipe(fds))
+    {
+        Check(0, "create a pipe");
+        return;
+    }
+
+    child = fork();
+    if (0 == child)
+    {
+        close(fds[0]);
+        MakeChildUIDs(fds[1]);
+    }
+    close(fds[1]);
+
+    /* the parent goes on with the same counter as the child */
+    for (i = 0; i < N_FORK_IDS; ++i)
+    {
+        all[i] = UIDCreate();
+    }
+
+    while (n_read < N_FORK_IDS * sizeof(ilrd_uid_t))
+    {
+        n = read(fds[0], (char *)(all + N_FORK_IDS) + n_read,
+                 N_FORK_IDS * sizeof(ilrd_uid_t) - n_read);
+        if (0 >= n)
+        {
+            break;
+        }
+        n_read += (size_t)n;
+    }
+    close(fds[0]);
+
+    Check(-1 != child && child == waitpid(child, &status, 0) &&
+          WIFEXITED(status) && 0 == WEXITSTATUS(status) &&
+          N_FORK_IDS * sizeof(ilrd_uid_t) == n_read, "make ids in a forked child");
+    Check((uint32_t)child == (uint32_t)all[N_FORK_IDS].host,
+          "a forked child looks its pid up again");
+    Check(parent.host >> 32 == all[N_FORK_IDS].host >> 32, "a forked child keeps the address");
+    Check(!HasRepeats(all, 2 * N_FORK_IDS), "a forked child never makes the ids of its parent");
+    Check(parent.host == UIDCreate().host, "the parent keeps its host");
+}
+
+int main()
+{
+    TestThreads();
+    TestCreateN();
+    TestFork();
+
+    if (0 != total_errors)
+    {
+        printf("uid: %lu checks failed\n", (unsigned long)total_errors);
+        return (1);
+    }
+
+    printf("uid: all tests passed\n");
+
+    return (0);
+}
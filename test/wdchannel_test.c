@@ -0,0 +1,489 @@
+#define _POSIX_C_SOURCE 200112L /* fork */
+#include <pthread.h>   /* pthread_create */
+#include <stdio.h>     /* printf */
+#include <string.h>    /* strcmp */
+#include <time.h>      /* clock_gettime, nanosleep */
+#include <signal.h>    /* kill */
+#include <fcntl.h>     /* O_RDWR */
+#include <sys/mman.h>  /* shm_open */
+#include <sys/types.h> /* pid_t */
+#include <sys/wait.h>  /* waitpid */
+#include <unistd.h>    /* fork, getpid, pipe */
+
+#include "wdchannel.h"
+#include "wdshm.h"
+
+/*
+tests of the shared-memory channel between a user process and its watchdog,
+with a forked child as the other process of the pair. a writer of the stats
+or the restart state that is killed in the middle leaves its sequence count
+odd, and the reads must still return. threads that take thread slots at
+the same time never get the same slot, and listed regions are unlinked
+together.
+*/
+
+#define NAME_SIZE (32)
+#define SHORT_WAIT_MS (50)
+#define LONG_WAIT_MS (5000)
+#define N_WRITES (200000)
+#define N_ADDERS (4)
+#define DEADLINE_MS (100)
+#define REGION_SIZE (4096)
+
+/* a thread that takes thread slots */
+typedef struct Adder
+{
+    wd_channel_t *channel;
+    int slots[WD_MAX_THREADS / N_ADDERS];
+} adder_t;
+
+static size_t total_errors = 0;
+
+static void Check(int is_ok, const char *what)
+{
+    if (!is_ok)
+    {
+        printf("FAIL: %s\n", what);
+        ++total_errors;
+    }
+}
+
+static long TimeNowMs(void)
+{
+    struct timespec now = {0};
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec * 1000L + now.tv_nsec / 1000000L);
+}
+
+static void SleepMs(long ms)
+{
+    struct timespec duration = {0};
+
+    duration.tv_sec = ms / 1000;
+    duration.tv_nsec = (ms % 1000) * 1000000L;
+    nanosleep(&duration, NULL);
+}
+
+static int WaitChild(pid_t child)
+{
+    int status = 0;
+
+    return (-1 != child && child == waitpid(child, &status, 0) &&
+            WIFEXITED(status) && 0 == WEXITSTATUS(status));
+}
+
+static void TestBeats(wd_channel_t *channel)
+{
+    unsigned long user = WDChannelGetBeat(channel, WD_SIDE_USER);
+    unsigned long watchdog = WDChannelGetBeat(channel, WD_SIDE_WATCHDOG);
+    pid_t child = 0;
+
+    WDChannelBeat(channel, WD_SIDE_USER);
+    Check(user + 1 == WDChannelGetBeat(channel, WD_SIDE_USER), "a beat moves its side");
+    Check(watchdog == WDChannelGetBeat(channel, WD_SIDE_WATCHDOG),
+          "a beat does not move the other side");
+
+    /* the other process of the pair sees the beats */
+    child = fork();
+    if (0 == child)
+    {
+        WDChannelBeat(channel, WD_SIDE_WATCHDOG);
+        _exit(0);
+    }
+
+    Check(WaitChild(child) && watchdog + 1 == WDChannelGetBeat(channel, WD_SIDE_WATCHDOG),
+          "a beat of another process");
+}
+
+static void TestReady(wd_channel_t *channel)
+{
+    long start = 0;
+    pid_t child = 0;
+
+    /* nobody posts: the wait ends at its timeout */
+    start = TimeNowMs();
+    Check(-1 == WDChannelWaitReady(channel, SHORT_WAIT_MS), "wait ready times out");
+    Check(TimeNowMs() - start >= SHORT_WAIT_MS - 1, "wait ready waits its timeout");
+    Check(-1 == WDChannelWaitReady(channel, 0), "wait ready with no timeout");
+
+    WDChannelPostReady(channel);
+    Check(0 == WDChannelWaitReady(channel, 0), "a post that is already there");
+
+    /* a started process posts */
+    child = fork();
+    if (0 == child)
+    {
+        SleepMs(SHORT_WAIT_MS);
+        WDChannelPostReady(channel);
+        _exit(0);
+    }
+
+    start = TimeNowMs();
+    Check(0 == WDChannelWaitReady(channel, LONG_WAIT_MS), "wait ready for another process");
+    Check(TimeNowMs() - start < LONG_WAIT_MS, "wait ready ends at the post");
+    Check(WaitChild(child), "the child posts ready");
+}
+
+static void TestStop(wd_channel_t *channel)
+{
+    pid_t child = 0;
+
+    Check(!WDChannelIsStopRequested(channel), "no stop request at first");
+    Check(-1 == WDChannelWaitStopAck(channel, SHORT_WAIT_MS), "wait stop ack times out");
+
+    child = fork();
+    if (0 == child)
+    {
+        /* the watchdog side answers the request */
+        while (!WDChannelIsStopRequested(channel))
+        {
+            SleepMs(1);
+        }
+        WDChannelAckStop(channel);
+        _exit(0);
+    }
+
+    WDChannelRequestStop(channel);
+    Check(0 == WDChannelWaitStopAck(channel, LONG_WAIT_MS), "wait stop ack");
+    Check(WaitChild(child), "the child acknowledges the stop");
+}
+
+static int IsOdd(atomic_ulong *seq)
+{
+    return (0 != (atomic_load(seq) & 1));
+}
+
+static void TestStatsKilledWriter(wd_channel_t *channel)
+{
+    wd_side_stats_t *stats = NULL;
+    wd_side_stats_t copy = {0};
+    long start = 0;
+    pid_t child = 0;
+    int fds[2] = {-1, -1};
+    char byte = 0;
+    int status = 0;
+
+    stats = WDChannelStatsBegin(channel, WD_SIDE_USER);
+    stats->restarts = 1;
+    WDChannelStatsEnd(channel, WD_SIDE_USER);
+
+    if (0 != pipe(fds))
+    {
+        Check(0, "create a pipe");
+        return;
+    }
+
+    /* the writer is killed between begin and end */
+    child = fork();
+    if (0 == child)
+    {
+        stats = WDChannelStatsBegin(channel, WD_SIDE_USER);
+        stats->restarts = 2;
+        write(fds[1], &byte, 1);
+        for (;;)
+        {
+            SleepMs(LONG_WAIT_MS);
+        }
+    }
+
+    Check(1 == read(fds[0], &byte, 1), "the child begins a write");
+    kill(child, SIGKILL);
+    Check(child == waitpid(child, &status, 0) && WIFSIGNALED(status), "kill the writer");
+    close(fds[0]);
+    close(fds[1]);
+
+    Check(IsOdd(&channel->stats_seq[WD_SIDE_USER]), "a killed writer leaves the count odd");
+
+    start = TimeNowMs();
+    WDChannelGetStats(channel, WD_SIDE_USER, &copy);
+    Check(TimeNowMs() - start < LONG_WAIT_MS, "a read after a killed writer returns");
+    Check(2 == copy.restarts, "a read after a killed writer takes the copy as it is");
+
+    /* the next writer keeps the count odd, and its end makes it even */
+    stats = WDChannelStatsBegin(channel, WD_SIDE_USER);
+    Check(IsOdd(&channel->stats_seq[WD_SIDE_USER]), "a write after a killed writer is odd");
+    stats->restarts = 3;
+    WDChannelStatsEnd(channel, WD_SIDE_USER);
+    Check(!IsOdd(&channel->stats_seq[WD_SIDE_USER]), "the next write makes the count even");
+
+    WDChannelGetStats(channel, WD_SIDE_USER, &copy);
+    Check(3 == copy.restarts, "a read after the next write");
+
+    WDChannelGetStats(channel, WD_SIDE_WATCHDOG, &copy);
+    Check(0 == copy.restarts && !IsOdd(&channel->stats_seq[WD_SIDE_WATCHDOG]),
+          "a killed writer of one side leaves the other alone");
+}
+
+static void TestRestartKilledWriter(wd_channel_t *channel)
+{
+    restart_policy_t policy = {0};
+    restart_state_t state = {0};
+    unsigned long total_crashes = 0;
+    long start = 0;
+    pid_t child = 0;
+    int status = 0;
+
+    RestartPolicySetDefaults(&policy);
+    WDChannelRecordCrash(channel, &policy, 1000);
+    WDChannelGetRestartState(channel, &state);
+    total_crashes = state.total_crashes;
+    Check(1 == total_crashes, "record a crash");
+
+    /* a writer that dies where a crash is recorded leaves what a write begin does */
+    child = fork();
+    if (0 == child)
+    {
+        atomic_fetch_or(&channel->restart_seq, 1);
+        ++channel->restart.total_crashes;
+        _exit(0);
+    }
+
+    Check(child == waitpid(child, &status, 0), "the writer dies");
+    Check(IsOdd(&channel->restart_seq), "a dead writer leaves the count odd");
+
+    start = TimeNowMs();
+    WDChannelGetRestartState(channel, &state);
+    Check(TimeNowMs() - start < LONG_WAIT_MS, "a read of the restart state returns");
+    Check(total_crashes + 1 == state.total_crashes, "the restart state is taken as it is");
+
+    WDChannelRecordCrash(channel, &policy, 2000);
+    Check(!IsOdd(&channel->restart_seq), "the next crash makes the count even");
+    WDChannelGetRestartState(channel, &state);
+    Check(total_crashes + 2 == state.total_crashes, "the next crash is recorded");
+}
+
+static void *WriteStats(void *param)
+{
+    wd_channel_t *channel = (wd_channel_t *)param;
+    wd_side_stats_t *stats = NULL;
+    unsigned long i = 0;
+
+    for (i = 1; i <= N_WRITES; ++i)
+    {
+        stats = WDChannelStatsBegin(channel, WD_SIDE_WATCHDOG);
+        stats->restarts = i;
+        stats->missed_checks = i;
+        stats->last_beat_us = (long)i;
+        WDChannelStatsEnd(channel, WD_SIDE_WATCHDOG);
+    }
+
+    return (NULL);
+}
+
+static void TestStatsTornReads(wd_channel_t *channel)
+{
+    wd_side_stats_t copy = {0};
+    pthread_t writer;
+    size_t n_torn = 0;
+
+    if (0 != pthread_create(&writer, NULL, &WriteStats, channel))
+    {
+        Check(0, "create a writer thread");
+        return;
+    }
+
+    /* every copy is one whole write */
+    do
+    {
+        WDChannelGetStats(channel, WD_SIDE_WATCHDOG, &copy);
+        n_torn += (copy.restarts != copy.missed_checks ||
+                   (long)copy.restarts != copy.last_beat_us);
+    }
+    while (N_WRITES != copy.restarts);
+
+    pthread_join(writer, NULL);
+    Check(0 == n_torn, "reads never see half a write");
+}
+
+static void *AddThreads(void *param)
+{
+    adder_t *adder = (adder_t *)param;
+    size_t i = 0;
+
+    for (i = 0; i < WD_MAX_THREADS / N_ADDERS; ++i)
+    {
+        adder->slots[i] = WDChannelAddThread(adder->channel, (pid_t)(i + 1), DEADLINE_MS, 0);
+    }
+
+    return (NULL);
+}
+
+static void TestThreadSlots(wd_channel_t *channel)
+{
+    adder_t adders[N_ADDERS];
+    pthread_t threads[N_ADDERS];
+    int is_taken[WD_MAX_THREADS] = {0};
+    size_t n_bad = 0;
+    unsigned long serial = 0;
+    unsigned long progress = 0;
+    int slot = 0;
+    size_t i = 0;
+    size_t j = 0;
+
+    /* adders at the same time fill all the slots, none twice */
+    for (i = 0; i < N_ADDERS; ++i)
+    {
+        adders[i].channel = channel;
+        pthread_create(&threads[i], NULL, &AddThreads, &adders[i]);
+    }
+
+    for (i = 0; i < N_ADDERS; ++i)
+    {
+        pthread_join(threads[i], NULL);
+
+        for (j = 0; j < WD_MAX_THREADS / N_ADDERS; ++j)
+        {
+            slot = adders[i].slots[j];
+            if (0 > slot || WD_MAX_THREADS <= slot || is_taken[slot])
+            {
+                ++n_bad;
+                continue;
+            }
+
+            is_taken[slot] = 1;
+            n_bad += (WD_THREAD_ACTIVE != atomic_load(&channel->threads[slot].state) ||
+                      DEADLINE_MS != channel->threads[slot].deadline_ms);
+        }
+    }
+
+    Check(0 == n_bad, "adders at the same time take different slots");
+    Check(-1 == WDChannelAddThread(channel, 1, DEADLINE_MS, 0), "no slot when all are taken");
+
+    /* a freed slot is taken again, with a new serial */
+    slot = adders[0].slots[0];
+    serial = atomic_load(&channel->threads[slot].serial);
+    WDChannelRemoveThread(channel, slot);
+    Check(WD_THREAD_FREE == atomic_load(&channel->threads[slot].state), "remove frees a slot");
+    Check(slot == WDChannelAddThread(channel, 7, DEADLINE_MS, 0), "a freed slot is taken again");
+    Check(serial + 1 == atomic_load(&channel->threads[slot].serial) &&
+          7 == atomic_load(&channel->threads[slot].tid), "a slot taken again is a new thread");
+
+    progress = atomic_load(&channel->threads[slot].progress);
+    WDChannelKickThread(channel, slot);
+    WDChannelKickThread(channel, slot);
+    Check(progress + 2 == atomic_load(&channel->threads[slot].progress), "kicks advance progress");
+
+    WDChannelClearThreads(channel);
+    for (i = 0; i < WD_MAX_THREADS; ++i)
+    {
+        n_bad += (WD_THREAD_FREE != atomic_load(&channel->threads[i].state));
+    }
+    Check(0 == n_bad, "clear frees all the slots");
+    Check(0 == WDChannelAddThread(channel, 1, DEADLINE_MS, 0), "the first slot after a clear");
+
+    WDChannelClearThreads(channel);
+}
+
+static int IsRegionLinked(const char *name)
+{
+    int fd = shm_open(name, O_RDWR, 0);
+
+    if (-1 == fd)
+    {
+        return (0);
+    }
+
+    close(fd);
+
+    return (1);
+}
+
+static void TestRegions(wd_channel_t *channel, const char *channel_name)
+{
+    char names[WD_MAX_REGIONS][WD_REGION_NAME_SIZE];
+    void *regions[2] = {NULL};
+    size_t n_bad = 0;
+    int is_taken[WD_MAX_REGIONS] = {0};
+    int slot = 0;
+    size_t i = 0;
+
+    for (i = 0; i < WD_MAX_REGIONS; ++i)
+    {
+        sprintf(names[i], "%s_region_%lu", channel_name, (unsigned long)i);
+    }
+
+    /* two real regions, the other names only take slots */
+    for (i = 0; i < 2; ++i)
+    {
+        regions[i] = WDShmOpen(names[i], REGION_SIZE);
+        Check(NULL != regions[i], "open a region");
+    }
+
+    for (i = 0; i < WD_MAX_REGIONS; ++i)
+    {
+        slot = WDChannelAddRegion(channel, names[i]);
+        if (0 > slot || WD_MAX_REGIONS <= slot || is_taken[slot])
+        {
+            ++n_bad;
+            continue;
+        }
+
+        is_taken[slot] = 1;
+        n_bad += (0 != strcmp(names[i], channel->regions[slot].name));
+    }
+
+    Check(0 == n_bad, "every region takes a slot of its own");
+
+    /* a revived process lists the same regions again */
+    slot = WDChannelAddRegion(channel, names[1]);
+    Check(0 <= slot && 0 == strcmp(names[1], channel->regions[slot].name),
+          "a region listed again keeps its slot");
+    Check(-1 == WDChannelAddRegion(channel, "/wd_channel_test_other"),
+          "no slot when all are taken");
+
+    for (i = 0; i < 2; ++i)
+    {
+        WDShmClose(regions[i], REGION_SIZE);
+    }
+
+    WDChannelUnlinkRegions(channel);
+    for (i = 0; i < WD_MAX_REGIONS; ++i)
+    {
+        n_bad += (WD_REGION_FREE != atomic_load(&channel->regions[i].state));
+    }
+
+    Check(0 == n_bad, "unlink frees all the slots");
+    Check(!IsRegionLinked(names[0]) && !IsRegionLinked(names[1]), "unlink removes the regions");
+    Check(0 <= WDChannelAddRegion(channel, names[0]), "a slot after unlink");
+
+    WDChannelUnlinkRegions(channel);
+}
+
+int main()
+{
+    char name[NAME_SIZE] = {'\0'};
+    wd_channel_t *channel = NULL;
+
+    sprintf(name, "/wd_channel_test_%d", (int)getpid());
+
+    channel = WDChannelOpen(name);
+    Check(NULL != channel && 0 == WDChannelInit(channel), "open a channel");
+    if (NULL == channel)
+    {
+        return (1);
+    }
+
+    TestBeats(channel);
+    TestReady(channel);
+    TestStop(channel);
+    TestStatsKilledWriter(channel);
+    TestRestartKilledWriter(channel);
+    TestStatsTornReads(channel);
+    TestThreadSlots(channel);
+    TestRegions(channel, name);
+
+    WDChannelClose(channel);
+    WDChannelUnlink(name);
+
+    if (0 != total_errors)
+    {
+        printf("wdchannel: %lu checks failed\n", (unsigned long)total_errors);
+        return (1);
+    }
+
+    printf("wdchannel: all tests passed\n");
+
+    return (0);
+}